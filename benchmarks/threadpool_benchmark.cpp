@@ -0,0 +1,240 @@
+/*
+* Compares vks::ThreadPool with the per-thread queue pool it replaced
+*
+* Built on its own, outside the engine:
+*   g++ -O2 -std=c++17 -pthread benchmarks/threadpool_benchmark.cpp -o threadpool_benchmark
+*   threadpool_benchmark [frames]
+*
+* Each workload is run as a number of frames. A frame hands out its jobs and waits for all of them,
+* the way multithreading_draw does. The old pool is used the way the engine used it, jobs are dealt
+* to threads[i] round robin and the submitting thread only waits
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../engine/threadpool.hpp"
+
+namespace legacy
+{
+	// vks::Thread and vks::ThreadPool as they were before the work-stealing pool
+	class Thread
+	{
+	private:
+		bool destroying = false;
+		std::thread worker;
+		std::queue<std::function<void()>> jobQueue;
+		std::mutex queueMutex;
+		std::condition_variable condition;
+
+		void queueLoop()
+		{
+			while (true)
+			{
+				std::function<void()> job;
+				{
+					std::unique_lock<std::mutex> lock(queueMutex);
+					condition.wait(lock, [this] { return !jobQueue.empty() || destroying; });
+					if (destroying)
+					{
+						break;
+					}
+					job = jobQueue.front();
+				}
+
+				job();
+
+				{
+					std::lock_guard<std::mutex> lock(queueMutex);
+					jobQueue.pop();
+					condition.notify_one();
+				}
+			}
+		}
+
+	public:
+		Thread()
+		{
+			worker = std::thread(&Thread::queueLoop, this);
+		}
+
+		~Thread()
+		{
+			if (worker.joinable())
+			{
+				wait();
+				queueMutex.lock();
+				destroying = true;
+				condition.notify_one();
+				queueMutex.unlock();
+				worker.join();
+			}
+		}
+
+		void addJob(std::function<void()> function)
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			jobQueue.push(std::move(function));
+			condition.notify_one();
+		}
+
+		void wait()
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			condition.wait(lock, [this]() { return jobQueue.empty(); });
+		}
+	};
+
+	class ThreadPool
+	{
+	public:
+		std::vector<std::unique_ptr<Thread>> threads;
+
+		void setThreadCount(uint32_t count)
+		{
+			threads.clear();
+			for (uint32_t i = 0; i < count; i++)
+			{
+				threads.push_back(std::unique_ptr<Thread>(new Thread()));
+			}
+		}
+
+		void wait()
+		{
+			for (auto& thread : threads)
+			{
+				thread->wait();
+			}
+		}
+	};
+}
+
+struct Workload
+{
+	const char* name;
+	uint32_t jobsPerFrame;
+	// iterations of spin(), about 1ns each on a desktop core
+	uint32_t jobCost;
+};
+
+// the first is dominated by per-job overhead, the second is close to the shadow cascades and
+// main pass slices recorded each frame
+const Workload WORKLOADS[] =
+{
+	{ "4096 jobs of ~1us", 4096, 1000 },
+	{ "16 jobs of ~200us", 16, 200000 },
+};
+
+static uint64_t spin(uint32_t iterations, uint64_t seed)
+{
+	uint64_t value = seed;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		value = value * 6364136223846793005ull + 1442695040888963407ull;
+	}
+	return value;
+}
+
+// one result per job so the work cannot be optimised out, padded to keep jobs off each other's lines
+struct alignas(vks::CacheLineSize) JobResult
+{
+	uint64_t value;
+};
+
+template<typename F>
+static double time_frames(uint32_t frames, F&& frame)
+{
+	// one untimed frame starts the workers and faults in the queues
+	frame();
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		frame();
+	}
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / frames;
+}
+
+static double run_serial(const Workload& workload, uint32_t frames, std::vector<JobResult>& results)
+{
+	return time_frames(frames, [&] {
+		for (uint32_t i = 0; i < workload.jobsPerFrame; i++)
+		{
+			results[i].value = spin(workload.jobCost, i);
+		}
+	});
+}
+
+static double run_legacy(const Workload& workload, uint32_t frames, uint32_t threadCount, std::vector<JobResult>& results)
+{
+	legacy::ThreadPool pool;
+	pool.setThreadCount(threadCount);
+
+	return time_frames(frames, [&] {
+		for (uint32_t i = 0; i < workload.jobsPerFrame; i++)
+		{
+			JobResult* result = &results[i];
+			uint32_t cost = workload.jobCost;
+			pool.threads[i % threadCount]->addJob([result, cost, i] { result->value = spin(cost, i); });
+		}
+		pool.wait();
+	});
+}
+
+static double run_stealing(const Workload& workload, uint32_t frames, uint32_t threadCount, std::vector<JobResult>& results)
+{
+	vks::ThreadPool pool;
+	pool.setThreadCount(threadCount);
+
+	return time_frames(frames, [&] {
+		for (uint32_t i = 0; i < workload.jobsPerFrame; i++)
+		{
+			JobResult* result = &results[i];
+			uint32_t cost = workload.jobCost;
+			pool.submit([result, cost, i] { result->value = spin(cost, i); });
+		}
+		pool.wait();
+	});
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t frames = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 200;
+
+	// the engine starts hardware_concurrency() - 1 workers, a few smaller counts show the scaling up to it
+	uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<uint32_t> threadCounts = { 1, 2, 4, 8, 16 };
+	threadCounts.push_back(hardwareThreads > 1 ? hardwareThreads - 1 : 1);
+	std::sort(threadCounts.begin(), threadCounts.end());
+	threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()), threadCounts.end());
+
+	std::printf("%u hardware threads, %u frames per run, milliseconds per frame\n", hardwareThreads, frames);
+
+	for (const Workload& workload : WORKLOADS)
+	{
+		std::vector<JobResult> results(workload.jobsPerFrame);
+
+		std::printf("\n%s\n", workload.name);
+		std::printf("  serial                %8.3f\n", run_serial(workload, frames, results));
+		std::printf("  workers      old pool  stealing  speedup\n");
+		for (uint32_t threadCount : threadCounts)
+		{
+			double legacyTime = run_legacy(workload, frames, threadCount, results);
+			double stealingTime = run_stealing(workload, frames, threadCount, results);
+			std::printf("  %7u  %10.3f  %8.3f  %6.2fx%s\n", threadCount, legacyTime, stealingTime, legacyTime / stealingTime,
+				threadCount + 1 > hardwareThreads ? "  (more threads than cores)" : "");
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,115 @@
+#include "Scene.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <random>
+
+static glm::mat4 instance_transform(const glm::vec3& translation, float yaw, float scale)
+{
+	glm::mat4 transform = glm::translate(glm::mat4(1.0f), translation);
+	transform = glm::rotate(transform, glm::radians(yaw), glm::vec3(0.0f, 1.0f, 0.0f));
+	return glm::scale(transform, glm::vec3(scale));
+}
+
+bool Scene::load_from_file(const char* filename)
+{
+	std::ifstream file(filename);
+
+	if (!file.is_open()) {
+		std::cerr << "Failed to open scene file " << filename << std::endl;
+		return false;
+	}
+
+	objects.clear();
+
+	// object "<mesh>" "<material>" starts an object, each following instance line adds a placement of it,
+	// an object without instance lines is placed once at the origin
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+
+		std::istringstream stream(line);
+		std::string keyword;
+		if (!(stream >> keyword) || keyword[0] == '#') {
+			continue;
+		}
+
+		if (keyword == "object") {
+			SceneObject object;
+			if (!(stream >> std::quoted(object.mesh) >> std::quoted(object.material))) {
+				std::cerr << filename << ":" << lineNumber << ": expected object \"mesh\" \"material\"" << std::endl;
+				return false;
+			}
+			objects.push_back(object);
+		}
+		else if (keyword == "instance") {
+			glm::vec3 translation;
+			float yaw, scale;
+			if (objects.empty() || !(stream >> translation.x >> translation.y >> translation.z >> yaw >> scale)) {
+				std::cerr << filename << ":" << lineNumber << ": expected instance x y z yaw scale after an object" << std::endl;
+				return false;
+			}
+			objects.back().transforms.push_back(instance_transform(translation, yaw, scale));
+		}
+		else {
+			std::cerr << filename << ":" << lineNumber << ": unknown keyword " << keyword << std::endl;
+			return false;
+		}
+	}
+
+	for (SceneObject& object : objects) {
+		if (object.transforms.empty()) {
+			object.transforms.push_back(glm::mat4(1.0f));
+		}
+	}
+
+	return true;
+}
+
+void Scene::tile_grid(const Scene& block, uint32_t gridSize, float spacing, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> quarterTurns(0, 3);
+	std::uniform_real_distribution<float> jitter(-0.05f * spacing, 0.05f * spacing);
+	std::uniform_real_distribution<float> scaleJitter(0.9f, 1.1f);
+
+	// one randomized transform per cell, shared by every object of the block so it stays in one piece
+	std::vector<glm::mat4> cells;
+	cells.reserve(size_t(gridSize) * gridSize);
+
+	float offset = (gridSize - 1) * spacing * 0.5f;
+	for (uint32_t z = 0; z < gridSize; z++) {
+		for (uint32_t x = 0; x < gridSize; x++) {
+			glm::vec3 translation = { x * spacing - offset + jitter(rng), 0.0f, z * spacing - offset + jitter(rng) };
+			cells.push_back(instance_transform(translation, 90.0f * quarterTurns(rng), scaleJitter(rng)));
+		}
+	}
+
+	// instances of a mesh stay contiguous so they keep batching into one indirect draw
+	objects.clear();
+	objects.reserve(block.objects.size());
+	for (const SceneObject& blockObject : block.objects) {
+		SceneObject object;
+		object.mesh = blockObject.mesh;
+		object.material = blockObject.material;
+		object.transforms.reserve(cells.size() * blockObject.transforms.size());
+
+		for (const glm::mat4& cell : cells) {
+			for (const glm::mat4& transform : blockObject.transforms) {
+				object.transforms.push_back(cell * transform);
+			}
+		}
+		objects.push_back(object);
+	}
+}
+
+size_t Scene::instance_count() const
+{
+	size_t count = 0;
+	for (const SceneObject& object : objects) {
+		count += object.transforms.size();
+	}
+	return count;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Mesh.h"
+#include <string>
+#include <vector>
+
+struct SceneObject {
+	std::string mesh;
+	std::string material;
+	std::vector<glm::mat4> transforms;
+};
+
+struct Scene {
+	std::vector<SceneObject> objects;
+
+	bool load_from_file(const char* filename);
+
+	void tile_grid(const Scene& block, uint32_t gridSize, float spacing, uint32_t seed);
+
+	size_t instance_count() const;
+};
@@ -1,188 +1,395 @@
-#include "Texture.h"
-#include <iostream>
-
-#include "vk_initializers.h"
-
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-
-
-bool vkutil::load_image_from_file(VulkanEngine& engine, std::string file, AllocatedImage& outImage)
-{
-	int texWidth, texHeight, texChannels;
-
-	stbi_uc* pixels = stbi_load(file.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-
-	if (!pixels) {
-		std::cout << "Failed to load texture file " << file << std::endl;
-		return false;
-	}
-
-	void* pixel_ptr = pixels;
-	VkDeviceSize imageSize = texWidth * texHeight * 4;
-
-	VkFormat image_format = VK_FORMAT_R8G8B8A8_SRGB;
-
-	AllocatedBuffer stagingBuffer = engine.create_buffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
-
-	void* data;
-	vmaMapMemory(engine._allocator, stagingBuffer._allocation, &data);
-
-	memcpy(data, pixel_ptr, static_cast<size_t>(imageSize));
-
-	vmaUnmapMemory(engine._allocator, stagingBuffer._allocation);
-
-	stbi_image_free(pixels);
-
-	VkExtent3D imageExtent;
-	imageExtent.width = static_cast<uint32_t>(texWidth);
-	imageExtent.height = static_cast<uint32_t>(texHeight);
-	imageExtent.depth = 1;
-
-	AllocatedImage newImage;
-	newImage._mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
-	VkImageCreateInfo dimg_info = vkinit::image_create_info(image_format,1, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageExtent, VK_SAMPLE_COUNT_1_BIT, newImage._mipLevels);
-
-
-	VmaAllocationCreateInfo dimg_allocinfo = {};
-	dimg_allocinfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-
-	vmaCreateImage(engine._allocator, &dimg_info, &dimg_allocinfo, &newImage._image, &newImage._allocation, nullptr);
-
-	engine.immediate_submit([&](VkCommandBuffer cmd) {
-		VkImageSubresourceRange range;
-		range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		range.baseMipLevel = 0;
-		range.levelCount = 1;
-		range.baseArrayLayer = 0;
-		range.layerCount = 1;
-
-		VkImageMemoryBarrier imageBarrier_toTransfer = {};
-		imageBarrier_toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-
-		imageBarrier_toTransfer.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		imageBarrier_toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		imageBarrier_toTransfer.image = newImage._image;
-		imageBarrier_toTransfer.subresourceRange = range;
-
-		imageBarrier_toTransfer.srcAccessMask = 0;
-		imageBarrier_toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier_toTransfer);
-
-		VkBufferImageCopy copyRegion = {};
-		copyRegion.bufferOffset = 0;
-		copyRegion.bufferRowLength = 0;
-		copyRegion.bufferImageHeight = 0;
-
-		copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		copyRegion.imageSubresource.mipLevel = 0;
-		copyRegion.imageSubresource.baseArrayLayer = 0;
-		copyRegion.imageSubresource.layerCount = 1;
-		copyRegion.imageExtent = imageExtent;
-
-		vkCmdCopyBufferToImage(cmd, stagingBuffer._buffer, newImage._image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
-
-		VkImageMemoryBarrier imageBarrier_toReadable = imageBarrier_toTransfer;
-
-		imageBarrier_toReadable.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		imageBarrier_toReadable.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-
-		imageBarrier_toReadable.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		imageBarrier_toReadable.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier_toReadable);
-
-		for (uint32_t i = 1; i < newImage._mipLevels; i++)
-		{
-			VkImageBlit imageBlit{};
-
-			imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			imageBlit.srcSubresource.layerCount = 1;
-			imageBlit.srcSubresource.mipLevel = i - 1;
-			imageBlit.srcOffsets[1].x = int32_t(texWidth >> (i - 1));
-			imageBlit.srcOffsets[1].y = int32_t(texHeight >> (i - 1));
-			imageBlit.srcOffsets[1].z = 1;
-
-			imageBlit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			imageBlit.dstSubresource.layerCount = 1;
-			imageBlit.dstSubresource.mipLevel = i;
-			imageBlit.dstOffsets[1].x = int32_t(texWidth >> i);
-			imageBlit.dstOffsets[1].y = int32_t(texHeight >> i);
-			imageBlit.dstOffsets[1].z = 1;
-
-			VkImageSubresourceRange mipSubRange = {};
-			mipSubRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			mipSubRange.baseMipLevel = i;
-			mipSubRange.levelCount = 1;
-			mipSubRange.layerCount = 1;
-
-			imageBarrier_toReadable.subresourceRange = mipSubRange;
-			imageBarrier_toReadable.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			imageBarrier_toReadable.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-
-			imageBarrier_toReadable.srcAccessMask = 0;
-			imageBarrier_toReadable.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-			vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier_toReadable);
-
-
-			vkCmdBlitImage(
-				cmd,
-				newImage._image,
-				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				newImage._image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				1,
-				&imageBlit,
-				VK_FILTER_LINEAR);
-			
-			imageBarrier_toReadable.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-			imageBarrier_toReadable.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-
-			imageBarrier_toReadable.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			imageBarrier_toReadable.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-			vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier_toReadable);
-
-		}
-		imageBarrier_toReadable.subresourceRange = range;
-		imageBarrier_toReadable.subresourceRange.levelCount = newImage._mipLevels;
-		imageBarrier_toReadable.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		imageBarrier_toReadable.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imageBarrier_toReadable.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-		imageBarrier_toReadable.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier_toReadable);
-		
-		});
-
-	VkPhysicalDeviceProperties properties{};
-	vkGetPhysicalDeviceProperties(engine._chosenGPU, &properties);
-
-	VkSamplerCreateInfo samplerInfo = vkinit::sampler_create_info(VK_FILTER_LINEAR);
-	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-	samplerInfo.mipLodBias = 0.0f;
-	samplerInfo.compareOp = VK_COMPARE_OP_NEVER;
-	samplerInfo.minLod = 0.0f;
-	samplerInfo.maxLod = (float)newImage._mipLevels;
-	samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-	samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
-	samplerInfo.anisotropyEnable = VK_TRUE;
-
-	vkCreateSampler(engine._device, &samplerInfo, nullptr, &newImage._sampler);
-
-	vmaDestroyBuffer(engine._allocator, stagingBuffer._buffer, stagingBuffer._allocation);
-	
-	engine._mainDeletionQueue.push_function([=]() {
-		vmaDestroyImage(engine._allocator, newImage._image, newImage._allocation);
-		vkDestroySampler(engine._device, newImage._sampler, nullptr);
-		});
-		
-	std::cout << "Texture loaded succesfully " << file << std::endl;
-
-	outImage = newImage;
-	return true;
-
-
-}
\ No newline at end of file
+#include "Texture.h"
+#include <iostream>
+
+#include "vk_initializers.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+
+void vkutil::create_texture_image(VulkanEngine& engine, VkExtent2D extent, AllocatedImage& outImage)
+{
+	VkExtent3D imageExtent = { extent.width, extent.height, 1 };
+
+	AllocatedImage newImage;
+	newImage._sampler = VK_NULL_HANDLE;
+	newImage._mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(extent.width, extent.height)))) + 1;
+	VkImageCreateInfo dimg_info = vkinit::image_create_info(VK_FORMAT_R8G8B8A8_SRGB,1, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageExtent, VK_SAMPLE_COUNT_1_BIT, newImage._mipLevels);
+
+
+	VmaAllocationCreateInfo dimg_allocinfo = {};
+	dimg_allocinfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+	vmaCreateImage(engine._allocator, &dimg_info, &dimg_allocinfo, &newImage._image, &newImage._allocation, nullptr);
+
+	outImage = newImage;
+}
+
+void vkutil::record_image_upload(VkCommandBuffer cmd, VkBuffer stagingBuffer, const AllocatedImage& image, VkExtent2D extent)
+{
+	int texWidth = static_cast<int>(extent.width);
+	int texHeight = static_cast<int>(extent.height);
+	VkExtent3D imageExtent = { extent.width, extent.height, 1 };
+
+	VkImageSubresourceRange range;
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.baseMipLevel = 0;
+	range.levelCount = 1;
+	range.baseArrayLayer = 0;
+	range.layerCount = 1;
+
+	VkImageMemoryBarrier imageBarrier_toTransfer = {};
+	imageBarrier_toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+
+	imageBarrier_toTransfer.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageBarrier_toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	imageBarrier_toTransfer.image = image._image;
+	imageBarrier_toTransfer.subresourceRange = range;
+
+	imageBarrier_toTransfer.srcAccessMask = 0;
+	imageBarrier_toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier_toTransfer);
+
+	VkBufferImageCopy copyRegion = {};
+	copyRegion.bufferOffset = 0;
+	copyRegion.bufferRowLength = 0;
+	copyRegion.bufferImageHeight = 0;
+
+	copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	copyRegion.imageSubresource.mipLevel = 0;
+	copyRegion.imageSubresource.baseArrayLayer = 0;
+	copyRegion.imageSubresource.layerCount = 1;
+	copyRegion.imageExtent = imageExtent;
+
+	vkCmdCopyBufferToImage(cmd, stagingBuffer, image._image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+	VkImageMemoryBarrier imageBarrier_toReadable = imageBarrier_toTransfer;
+
+	imageBarrier_toReadable.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	imageBarrier_toReadable.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+	imageBarrier_toReadable.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	imageBarrier_toReadable.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier_toReadable);
+
+	for (uint32_t i = 1; i < image._mipLevels; i++)
+	{
+		VkImageBlit imageBlit{};
+
+		imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		imageBlit.srcSubresource.layerCount = 1;
+		imageBlit.srcSubresource.mipLevel = i - 1;
+		imageBlit.srcOffsets[1].x = int32_t(texWidth >> (i - 1));
+		imageBlit.srcOffsets[1].y = int32_t(texHeight >> (i - 1));
+		imageBlit.srcOffsets[1].z = 1;
+
+		imageBlit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		imageBlit.dstSubresource.layerCount = 1;
+		imageBlit.dstSubresource.mipLevel = i;
+		imageBlit.dstOffsets[1].x = int32_t(texWidth >> i);
+		imageBlit.dstOffsets[1].y = int32_t(texHeight >> i);
+		imageBlit.dstOffsets[1].z = 1;
+
+		VkImageSubresourceRange mipSubRange = {};
+		mipSubRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		mipSubRange.baseMipLevel = i;
+		mipSubRange.levelCount = 1;
+		mipSubRange.layerCount = 1;
+
+		imageBarrier_toReadable.subresourceRange = mipSubRange;
+		imageBarrier_toReadable.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageBarrier_toReadable.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+		imageBarrier_toReadable.srcAccessMask = 0;
+		imageBarrier_toReadable.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier_toReadable);
+
+
+		vkCmdBlitImage(
+			cmd,
+			image._image,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			image._image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1,
+			&imageBlit,
+			VK_FILTER_LINEAR);
+		
+		imageBarrier_toReadable.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageBarrier_toReadable.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+		imageBarrier_toReadable.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageBarrier_toReadable.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier_toReadable);
+
+	}
+	imageBarrier_toReadable.subresourceRange = range;
+	imageBarrier_toReadable.subresourceRange.levelCount = image._mipLevels;
+	imageBarrier_toReadable.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	imageBarrier_toReadable.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageBarrier_toReadable.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	imageBarrier_toReadable.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier_toReadable);
+}
+
+static void upload_pixels(VulkanEngine& engine, const stbi_uc* pixels, int texWidth, int texHeight, AllocatedImage& outImage)
+{
+	const void* pixel_ptr = pixels;
+	VkDeviceSize imageSize = texWidth * texHeight * 4;
+
+	AllocatedBuffer stagingBuffer = engine.create_buffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+
+	memcpy(stagingBuffer._mapped, pixel_ptr, static_cast<size_t>(imageSize));
+
+	VkExtent2D extent = { static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight) };
+
+	AllocatedImage newImage;
+	vkutil::create_texture_image(engine, extent, newImage);
+
+	engine.immediate_submit([&](VkCommandBuffer cmd) {
+		vkutil::record_image_upload(cmd, stagingBuffer._buffer, newImage, extent);
+		});
+
+	vmaDestroyBuffer(engine._allocator, stagingBuffer._buffer, stagingBuffer._allocation);
+
+	outImage = newImage;
+}
+
+// halves the image in place mips times, or until it is a single texel
+static void box_filter(stbi_uc* pixels, int& texWidth, int& texHeight, uint32_t mips)
+{
+	for (uint32_t mip = 0; mip < mips && (texWidth > 1 || texHeight > 1); mip++) {
+		int dstWidth = std::max(texWidth / 2, 1);
+		int dstHeight = std::max(texHeight / 2, 1);
+
+		for (int y = 0; y < dstHeight; y++) {
+			for (int x = 0; x < dstWidth; x++) {
+				int x0 = std::min(x * 2, texWidth - 1);
+				int x1 = std::min(x * 2 + 1, texWidth - 1);
+				int y0 = std::min(y * 2, texHeight - 1);
+				int y1 = std::min(y * 2 + 1, texHeight - 1);
+
+				for (int c = 0; c < 4; c++) {
+					int sum = pixels[(y0 * texWidth + x0) * 4 + c] + pixels[(y0 * texWidth + x1) * 4 + c] +
+						pixels[(y1 * texWidth + x0) * 4 + c] + pixels[(y1 * texWidth + x1) * 4 + c];
+					pixels[(y * dstWidth + x) * 4 + c] = static_cast<stbi_uc>((sum + 2) / 4);
+				}
+			}
+		}
+
+		texWidth = dstWidth;
+		texHeight = dstHeight;
+	}
+}
+
+bool vkutil::load_image_from_file(VulkanEngine& engine, std::string file, AllocatedImage& outImage)
+{
+	int texWidth, texHeight, texChannels;
+
+	stbi_uc* pixels = stbi_load(file.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+
+	if (!pixels) {
+		std::cout << "Failed to load texture file " << file << std::endl;
+		return false;
+	}
+
+	AllocatedImage newImage;
+	upload_pixels(engine, pixels, texWidth, texHeight, newImage);
+
+	stbi_image_free(pixels);
+
+	newImage._sampler = vkutil::create_texture_sampler(engine, VK_LOD_CLAMP_NONE);
+
+	engine._mainDeletionQueue.push_function([=]() {
+		vmaDestroyImage(engine._allocator, newImage._image, newImage._allocation);
+		});
+		
+	std::cout << "Texture loaded succesfully " << file << std::endl;
+
+	outImage = newImage;
+	return true;
+
+
+}
+
+VkSampler vkutil::create_texture_sampler(VulkanEngine& engine, float maxLod)
+{
+	VkSamplerCreateInfo samplerInfo = vkinit::sampler_create_info(VK_FILTER_LINEAR);
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.mipLodBias = 0.0f;
+	samplerInfo.compareOp = VK_COMPARE_OP_NEVER;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = maxLod;
+	samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+	samplerInfo.maxAnisotropy = engine._gpuProperties.limits.maxSamplerAnisotropy;
+	samplerInfo.anisotropyEnable = VK_TRUE;
+
+	// samplers are owned by the engine's cache and shared between every texture created with the same state
+	return engine._samplerCache->create_sampler(&samplerInfo);
+}
+
+bool vkutil::query_image_info(const std::string& file, ImageFileInfo& outInfo)
+{
+	int texWidth, texHeight, texChannels;
+	if (!stbi_info(file.c_str(), &texWidth, &texHeight, &texChannels)) {
+		std::cout << "Failed to read texture header " << file << std::endl;
+		return false;
+	}
+
+	outInfo.width = static_cast<uint32_t>(texWidth);
+	outInfo.height = static_cast<uint32_t>(texHeight);
+	outInfo.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+	return true;
+}
+
+bool vkutil::load_image_mip_from_file(VulkanEngine& engine, const std::string& file, uint32_t baseMip, AllocatedImage& outImage)
+{
+	int texWidth, texHeight, texChannels;
+
+	stbi_uc* pixels = stbi_load(file.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+
+	if (!pixels) {
+		std::cout << "Failed to load texture file " << file << std::endl;
+		return false;
+	}
+
+	// box-filter down to the requested mip so only the resident part of the chain ever reaches the GPU
+	box_filter(pixels, texWidth, texHeight, baseMip);
+
+	upload_pixels(engine, pixels, texWidth, texHeight, outImage);
+
+	stbi_image_free(pixels);
+
+	return true;
+}
+
+bool vkutil::decode_image_mip(const std::string& file, uint32_t baseMip, VkExtent2D extent, void* dst)
+{
+	int texWidth, texHeight, texChannels;
+
+	stbi_uc* pixels = stbi_load(file.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+
+	if (!pixels) {
+		return false;
+	}
+
+	box_filter(pixels, texWidth, texHeight, baseMip);
+
+	// otherwise the file changed since its header was read
+	bool matches = static_cast<uint32_t>(texWidth) == extent.width && static_cast<uint32_t>(texHeight) == extent.height;
+	if (matches) {
+		memcpy(dst, pixels, size_t(texWidth) * texHeight * 4);
+	}
+
+	stbi_image_free(pixels);
+
+	return matches;
+}
+
+bool vkutil::load_cubemap_from_files(VulkanEngine& engine, const std::array<CubemapFace, 6>& faces, AllocatedImage& outImage)
+{
+	std::array<stbi_uc*, 6> pixels{};
+	int texWidth = 0, texHeight = 0;
+
+	for (size_t i = 0; i < faces.size(); i++) {
+		if (faces[i].file.empty()) {
+			continue;
+		}
+
+		int width, height, texChannels;
+		pixels[i] = stbi_load(faces[i].file.c_str(), &width, &height, &texChannels, STBI_rgb_alpha);
+
+		if (!pixels[i] || (texWidth != 0 && (width != texWidth || height != texHeight))) {
+			std::cout << "Failed to load cubemap face " << faces[i].file << std::endl;
+			for (stbi_uc* face : pixels) {
+				stbi_image_free(face);
+			}
+			return false;
+		}
+
+		texWidth = width;
+		texHeight = height;
+	}
+
+	if (texWidth == 0) {
+		return false;
+	}
+
+	VkDeviceSize faceSize = VkDeviceSize(texWidth) * texHeight * 4;
+	AllocatedBuffer stagingBuffer = engine.create_buffer(faceSize * 6, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+
+	void* data = stagingBuffer._mapped;
+
+	// faces without a file stay black, the way the clear colour showed through before
+	for (size_t i = 0; i < faces.size(); i++) {
+		stbi_uc* dst = (stbi_uc*)data + faceSize * i;
+		if (!pixels[i]) {
+			memset(dst, 0, faceSize);
+			continue;
+		}
+
+		if (faces[i].rotate180) {
+			const uint32_t* src = (const uint32_t*)pixels[i];
+			uint32_t* dstTexels = (uint32_t*)dst;
+			size_t texelCount = size_t(texWidth) * texHeight;
+			for (size_t t = 0; t < texelCount; t++) {
+				dstTexels[t] = src[texelCount - 1 - t];
+			}
+		}
+		else {
+			memcpy(dst, pixels[i], faceSize);
+		}
+		stbi_image_free(pixels[i]);
+	}
+
+	VkExtent3D imageExtent;
+	imageExtent.width = static_cast<uint32_t>(texWidth);
+	imageExtent.height = static_cast<uint32_t>(texHeight);
+	imageExtent.depth = 1;
+
+	AllocatedImage newImage;
+	newImage._sampler = VK_NULL_HANDLE;
+	newImage._mipLevels = 1;
+	VkImageCreateInfo dimg_info = vkinit::image_create_info(VK_FORMAT_R8G8B8A8_SRGB, 6, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageExtent, VK_SAMPLE_COUNT_1_BIT, 1);
+	dimg_info.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+
+	VmaAllocationCreateInfo dimg_allocinfo = {};
+	dimg_allocinfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+	vmaCreateImage(engine._allocator, &dimg_info, &dimg_allocinfo, &newImage._image, &newImage._allocation, nullptr);
+
+	engine.immediate_submit([&](VkCommandBuffer cmd) {
+		VkImageMemoryBarrier toTransfer = vkinit::image_barrier(newImage._image, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+		VkBufferImageCopy copyRegion = {};
+		copyRegion.bufferOffset = 0;
+		copyRegion.bufferRowLength = 0;
+		copyRegion.bufferImageHeight = 0;
+
+		copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copyRegion.imageSubresource.mipLevel = 0;
+		copyRegion.imageSubresource.baseArrayLayer = 0;
+		copyRegion.imageSubresource.layerCount = 6;
+		copyRegion.imageExtent = imageExtent;
+
+		vkCmdCopyBufferToImage(cmd, stagingBuffer._buffer, newImage._image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+		VkImageMemoryBarrier toReadable = vkinit::image_barrier(newImage._image, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toReadable);
+		});
+
+	vmaDestroyBuffer(engine._allocator, stagingBuffer._buffer, stagingBuffer._allocation);
+
+	outImage = newImage;
+	return true;
+}
@@ -1,9 +1,38 @@
-#pragma once
-#include "vk_types.h"
-#include "vk_engine.h"
-
-namespace vkutil {
-
-	bool load_image_from_file(VulkanEngine& engine, std::string file, AllocatedImage& outImage);
-
-}
+#pragma once
+#include "vk_types.h"
+#include "vk_engine.h"
+
+namespace vkutil {
+
+	struct ImageFileInfo {
+		uint32_t width;
+		uint32_t height;
+		uint32_t mipLevels;
+	};
+
+	struct CubemapFace {
+		std::string file;
+		bool rotate180{ false };
+	};
+
+	bool load_image_from_file(VulkanEngine& engine, std::string file, AllocatedImage& outImage);
+
+	VkSampler create_texture_sampler(VulkanEngine& engine, float maxLod);
+
+	bool query_image_info(const std::string& file, ImageFileInfo& outInfo);
+
+	bool load_image_mip_from_file(VulkanEngine& engine, const std::string& file, uint32_t baseMip, AllocatedImage& outImage);
+
+	// an image with a full mip chain below extent, contents undefined until an upload has been recorded into it
+	void create_texture_image(VulkanEngine& engine, VkExtent2D extent, AllocatedImage& outImage);
+
+	// copies the top mip from stagingBuffer, blits the rest of the chain from it and leaves the image shader readable
+	void record_image_upload(VkCommandBuffer cmd, VkBuffer stagingBuffer, const AllocatedImage& image, VkExtent2D extent);
+
+	// decodes file and box-filters it down to baseMip into dst, which holds extent sized RGBA texels. Only touches
+	// the file and dst, so it can run on any thread. Fails when the file cannot be read or baseMip is not extent sized
+	bool decode_image_mip(const std::string& file, uint32_t baseMip, VkExtent2D extent, void* dst);
+
+	bool load_cubemap_from_files(VulkanEngine& engine, const std::array<CubemapFace, 6>& faces, AllocatedImage& outImage);
+
+}
@@ -1,14 +1,108 @@
-#include "vk_engine.h"
-
-int main(int argc, char* argv[])
-{
-	VulkanEngine engine;
-
-	engine.init();
-
-	engine.run();
-
-	engine.cleanup();
-
-	return 0;
+#include "vk_engine.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+static void print_usage(const char* program)
+{
+	std::cout << "usage: " << program << " [options]\n"
+		<< "  --scene <path>\n"
+		<< "  --stress <grid size>\n"
+		<< "  --frames <frames in flight, 1-" << MAX_FRAME_OVERLAP << ">\n"
+		<< "  --present fifo|mailbox|immediate\n"
+		<< "  --latency low\n"
+		<< "  --fps-limit <frames per second, 0 for none>\n"
+		<< "  --sim-rate <simulation steps per second>\n"
+		<< "  --gpu-budget <milliseconds, 0 for full resolution>\n"
+		<< "  --recording once\n"
+		<< "  --mesh-residency keep|release\n"
+		<< "  --allocation-test <steady state frames, needs VKE_COUNT_FRAME_ALLOCATIONS>" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	VulkanEngine engine;
+
+	try {
+		for (int i = 1; i + 1 < argc; i++) {
+			std::string arg = argv[i];
+			if (arg == "--scene") {
+				engine._scenePath = argv[++i];
+			}
+			else if (arg == "--stress") {
+				engine._stressGridSize = std::stoul(argv[++i]);
+			}
+			else if (arg == "--frames") {
+				engine._frameOverlap = std::clamp<uint32_t>(std::stoul(argv[++i]), 1, MAX_FRAME_OVERLAP);
+			}
+			else if (arg == "--present") {
+				std::string mode = argv[++i];
+				if (mode == "fifo") {
+					engine._presentMode = VK_PRESENT_MODE_FIFO_KHR;
+				}
+				else if (mode == "mailbox") {
+					engine._presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+				}
+				else if (mode == "immediate") {
+					engine._presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+				}
+				else {
+					std::cout << "Unknown present mode " << mode << std::endl;
+					print_usage(argv[0]);
+					return 1;
+				}
+			}
+			else if (arg == "--latency") {
+				engine._lowLatency = std::string(argv[++i]) == "low";
+			}
+			else if (arg == "--fps-limit") {
+				engine._frameRateLimit = std::stoul(argv[++i]);
+			}
+			else if (arg == "--sim-rate") {
+				engine._simulationRate = std::max<uint32_t>(std::stoul(argv[++i]), 1);
+			}
+			else if (arg == "--gpu-budget") {
+				engine._gpuFrameBudget = std::max(std::stof(argv[++i]), 0.0f);
+			}
+			else if (arg == "--recording") {
+				engine._recordOnce = std::string(argv[++i]) == "once";
+			}
+			else if (arg == "--mesh-residency") {
+				std::string policy = argv[++i];
+				if (policy == "keep") {
+					engine._meshResidency = MeshResidency::Keep;
+				}
+				else if (policy == "release") {
+					engine._meshResidency = MeshResidency::Release;
+				}
+				else {
+					std::cout << "Unknown mesh residency policy " << policy << std::endl;
+					print_usage(argv[0]);
+					return 1;
+				}
+			}
+			else if (arg == "--allocation-test") {
+#ifdef VKE_COUNT_FRAME_ALLOCATIONS
+				engine._allocationTestFrames = std::max<uint32_t>(std::stoul(argv[++i]), 1);
+#else
+				std::cout << "--allocation-test needs a build with VKE_COUNT_FRAME_ALLOCATIONS defined" << std::endl;
+				return 1;
+#endif
+			}
+		}
+	}
+	catch (const std::logic_error&) {
+		// std::stoul and std::stof throw invalid_argument or out_of_range on values that are not numbers
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	engine.init();
+
+	engine.run();
+
+	engine.cleanup();
+
+	// only the allocation test sets this, a frame past warm-up allocated on the heap
+	return engine._allocatingFrames > 0 ? 1 : 0;
 }
\ No newline at end of file
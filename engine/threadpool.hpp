@@ -1,121 +1,620 @@
 /*
-* Basic C++11 based thread pool with per-thread job queues
+* Work-stealing thread pool
 *
-* Copyright (C) 2016 by Sascha Willems - www.saschawillems.de
+* Based on the basic C++11 thread pool by Sascha Willems (www.saschawillems.de)
 *
 * This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 
+#pragma once
+
 #include <vector>
+#include <deque>
+#include <memory>
 #include <thread>
-#include <queue>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
 #include <functional>
-
-// make_unique is not available in C++11
-// Taken from Herb Sutter's blog (https://herbsutter.com/gotw/_102/)
-template<typename T, typename ...Args>
-std::unique_ptr<T> make_unique(Args&& ...args)
-{
-	return std::unique_ptr<T>(new T(std::forward<Args>(args)...));
-}
+#include <initializer_list>
+#include <algorithm>
+#include <numeric>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
 
 namespace vks
 {
-	class Thread
+	constexpr size_t CacheLineSize = 64;
+
+	// Smallest element count that covers a whole number of cache lines in an array of every T,
+	// chunks split on multiples of it never write to the same line from two threads
+	template<typename... T>
+	constexpr size_t cacheLineGranule()
 	{
+		size_t granule = 1;
+		for (size_t size : { sizeof(T)... })
+		{
+			granule = std::lcm(granule, CacheLineSize / std::gcd(CacheLineSize, size));
+		}
+		return granule;
+	}
+
+	// A type erased callable stored inline, so submitting a job never allocates
+	class Job
+	{
+	public:
+		static constexpr size_t StorageSize = 48;
+
+		template<typename F>
+		void set(F&& function)
+		{
+			using Fn = typename std::decay<F>::type;
+			static_assert(sizeof(Fn) <= StorageSize, "job captures too much state, capture a pointer instead");
+			static_assert(alignof(Fn) <= alignof(std::max_align_t), "job callable is over-aligned");
+
+			new (storage) Fn(std::forward<F>(function));
+			invoke = [](void* fn)
+			{
+				Fn& f = *static_cast<Fn*>(fn);
+				f();
+				f.~Fn();
+			};
+			finished.store(false, std::memory_order_relaxed);
+		}
+
+		// Runs the callable once and destroys it
+		void run()
+		{
+			invoke(storage);
+			finished.store(true, std::memory_order_release);
+		}
+
+		bool isFinished() const
+		{
+			return finished.load(std::memory_order_acquire);
+		}
+
+		// set for jobs submitted from threads outside the pool, which are freed after running
+		bool heapAllocated = false;
+
 	private:
-		bool destroying = false;
-		std::thread worker;
-		std::queue<std::function<void()>> jobQueue;
-		std::mutex queueMutex;
-		std::condition_variable condition;
+		alignas(std::max_align_t) unsigned char storage[StorageSize];
+		void (*invoke)(void*) = nullptr;
+		std::atomic<bool> finished{ true };
+	};
 
-		// Loop through all remaining jobs
-		void queueLoop()
+	// Chase-Lev deque: the owning thread pushes and pops at the bottom, other threads steal from the top
+	class WorkStealingQueue
+	{
+	public:
+		static constexpr int64_t Capacity = 4096;
+
+		bool push(Job* job)
 		{
-			while (true)
+			int64_t b = bottom.load(std::memory_order_relaxed);
+			int64_t t = top.load(std::memory_order_acquire);
+			if (b - t >= Capacity)
 			{
-				std::function<void()> job;
-				{
-					std::unique_lock<std::mutex> lock(queueMutex);
-					condition.wait(lock, [this] { return !jobQueue.empty() || destroying; });
-					if (destroying)
-					{
-						break;
-					}
-					job = jobQueue.front();
-				}
+				return false;
+			}
+			jobs[b & Mask].store(job, std::memory_order_relaxed);
+			bottom.store(b + 1, std::memory_order_release);
+			return true;
+		}
+
+		Job* pop()
+		{
+			int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+			bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = top.load(std::memory_order_relaxed);
 
-				job();
+			if (t > b)
+			{
+				bottom.store(b + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
 
+			Job* job = jobs[b & Mask].load(std::memory_order_relaxed);
+			if (t == b)
+			{
+				// last job, race any thief for it
+				if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
 				{
-					std::lock_guard<std::mutex> lock(queueMutex);
-					jobQueue.pop();
-					condition.notify_one();
+					job = nullptr;
 				}
+				bottom.store(b + 1, std::memory_order_relaxed);
 			}
+			return job;
 		}
 
+		Job* steal()
+		{
+			int64_t t = top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t b = bottom.load(std::memory_order_acquire);
+
+			if (t >= b)
+			{
+				return nullptr;
+			}
+
+			Job* job = jobs[t & Mask].load(std::memory_order_relaxed);
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				return nullptr;
+			}
+			return job;
+		}
+
+	private:
+		static constexpr int64_t Mask = Capacity - 1;
+
+		alignas(64) std::atomic<int64_t> top{ 0 };
+		alignas(64) std::atomic<int64_t> bottom{ 0 };
+		std::atomic<Job*> jobs[Capacity];
+	};
+
+	class ThreadPool
+	{
 	public:
-		Thread()
+		ThreadPool() = default;
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		~ThreadPool()
 		{
-			worker = std::thread(&Thread::queueLoop, this);
+			shutdown();
 		}
 
-		~Thread()
+		// Starts count worker threads. The calling thread becomes queue 0 and helps out while it waits
+		void setThreadCount(uint32_t count)
 		{
-			if (worker.joinable())
+			shutdown();
+
+			queues.clear();
+			for (uint32_t i = 0; i < count + 1; i++)
 			{
-				wait();
-				queueMutex.lock();
-				destroying = true;
-				condition.notify_one();
-				queueMutex.unlock();
-				worker.join();
+				queues.push_back(std::unique_ptr<Queue>(new Queue()));
+			}
+
+			stopping = false;
+			bind(0);
+
+			for (uint32_t i = 1; i < count + 1; i++)
+			{
+				workers.emplace_back(&ThreadPool::workerLoop, this, i);
 			}
 		}
 
-		// Add a new job to the thread's queue
-		void addJob(std::function<void()> function)
+		uint32_t threadCount() const
+		{
+			return static_cast<uint32_t>(workers.size());
+		}
+
+		// Slot of the calling thread in [0, threadCount()], for per-thread resources. ~0u outside the pool
+		uint32_t workerIndex() const
 		{
-			std::lock_guard<std::mutex> lock(queueMutex);
-			jobQueue.push(std::move(function));
-			condition.notify_one();
+			if (boundPool() != this || boundIndex() >= queues.size())
+			{
+				return ~0u;
+			}
+			return boundIndex();
 		}
 
-		// Wait until all work items have been finished
+		// Queues a job on the calling thread's deque, idle workers steal it from there
+		template<typename F>
+		void submit(F&& function)
+		{
+			pendingJobs.fetch_add(1, std::memory_order_relaxed);
+			// seq_cst pairs with the sleeping check below so a worker going to sleep cannot miss this job
+			queuedJobs.fetch_add(1);
+
+			Queue* queue = currentQueue();
+			if (queue)
+			{
+				Job* job = allocate(*queue);
+				job->set(std::forward<F>(function));
+				while (!queue->deque.push(job))
+				{
+					// the deque is full, run something ourselves to make room
+					runPending(queue);
+				}
+			}
+			else
+			{
+				// threads that do not belong to the pool hand their jobs over through a locked queue
+				Job* job = new Job();
+				job->heapAllocated = true;
+				job->set(std::forward<F>(function));
+				std::lock_guard<std::mutex> lock(injectMutex);
+				injected.push_back(job);
+				injectedCount.fetch_add(1, std::memory_order_release);
+			}
+
+			if (sleepingWorkers.load() > 0)
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex);
+				wake.notify_one();
+			}
+		}
+
+		// Queues a long job, such as file loading, that only worker threads pick up once they run out of
+		// other work. Threads waiting in wait() or waitUntil() never run it, so it cannot hold up whoever
+		// queued it, and wait() does not wait for it. Every background job runs before the pool shuts down
+		template<typename F>
+		void submitBackground(F&& function)
+		{
+			Job* job = new Job();
+			job->heapAllocated = true;
+			job->set(std::forward<F>(function));
+			{
+				std::lock_guard<std::mutex> lock(backgroundMutex);
+				background.push_back(job);
+			}
+			// seq_cst for the same reason as queuedJobs in submit()
+			backgroundJobs.fetch_add(1);
+
+			if (sleepingWorkers.load() > 0)
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex);
+				wake.notify_one();
+			}
+		}
+
+		// Runs queued jobs on the calling thread until every submitted job has finished
 		void wait()
 		{
-			std::unique_lock<std::mutex> lock(queueMutex);
-			condition.wait(lock, [this]() { return jobQueue.empty(); });
+			waitUntil([this] { return pendingJobs.load(std::memory_order_acquire) == 0; });
+		}
+
+		// Splits [0, count) into chunks starting on multiples of granule and calls function(begin, end)
+		// for each of them across the pool. The calling thread takes the first chunk and returns once all are done
+		template<typename F>
+		void parallelFor(size_t count, size_t granule, F&& function)
+		{
+			static constexpr size_t MinChunk = 256;
+
+			size_t participants = workers.size() + 1;
+			// a few chunks per thread so stealing can even out uneven chunks
+			size_t chunk = std::max((count + participants * 4 - 1) / (participants * 4), MinChunk);
+			chunk = (chunk + granule - 1) / granule * granule;
+
+			if (count <= chunk)
+			{
+				if (count > 0)
+				{
+					function(size_t(0), count);
+				}
+				return;
+			}
+
+			std::atomic<size_t> remaining{ (count + chunk - 1) / chunk - 1 };
+			for (size_t begin = chunk; begin < count; begin += chunk)
+			{
+				size_t end = std::min(begin + chunk, count);
+				submit([&function, &remaining, begin, end]
+				{
+					function(begin, end);
+					remaining.fetch_sub(1, std::memory_order_release);
+				});
+			}
+
+			function(size_t(0), chunk);
+			waitUntil([&remaining] { return remaining.load(std::memory_order_acquire) == 0; });
+		}
+
+		// Runs queued jobs on the calling thread until done() returns true
+		template<typename P>
+		void waitUntil(P&& done)
+		{
+			Queue* queue = currentQueue();
+			while (!done())
+			{
+				if (!runPending(queue))
+				{
+					std::this_thread::yield();
+				}
+			}
+		}
+
+	private:
+		struct Queue
+		{
+			WorkStealingQueue deque;
+			// jobs are handed out round robin, a slot comes back around only after Capacity newer submissions
+			Job jobs[WorkStealingQueue::Capacity];
+			uint32_t nextJob = 0;
+		};
+
+		std::vector<std::unique_ptr<Queue>> queues;
+		std::vector<std::thread> workers;
+
+		std::mutex injectMutex;
+		std::deque<Job*> injected;
+		std::atomic<uint32_t> injectedCount{ 0 };
+
+		std::mutex backgroundMutex;
+		std::deque<Job*> background;
+		std::atomic<uint32_t> backgroundJobs{ 0 };
+
+		// submitted and not yet finished, what wait() waits on
+		std::atomic<uint32_t> pendingJobs{ 0 };
+		// submitted and not yet picked up, what wakes sleeping workers
+		std::atomic<uint32_t> queuedJobs{ 0 };
+		std::atomic<uint32_t> sleepingWorkers{ 0 };
+		std::mutex sleepMutex;
+		std::condition_variable wake;
+		bool stopping = false;
+
+		static ThreadPool*& boundPool()
+		{
+			static thread_local ThreadPool* pool = nullptr;
+			return pool;
+		}
+
+		static uint32_t& boundIndex()
+		{
+			static thread_local uint32_t index = 0;
+			return index;
+		}
+
+		void bind(uint32_t index)
+		{
+			boundPool() = this;
+			boundIndex() = index;
+		}
+
+		Queue* currentQueue()
+		{
+			if (boundPool() != this || boundIndex() >= queues.size())
+			{
+				return nullptr;
+			}
+			return queues[boundIndex()].get();
+		}
+
+		Job* allocate(Queue& queue)
+		{
+			Job* job = &queue.jobs[queue.nextJob++ % WorkStealingQueue::Capacity];
+			while (!job->isFinished())
+			{
+				runPending(&queue);
+			}
+			return job;
+		}
+
+		Job* findJob(Queue* own)
+		{
+			if (own)
+			{
+				if (Job* job = own->deque.pop())
+				{
+					return job;
+				}
+			}
+
+			if (injectedCount.load(std::memory_order_acquire) > 0)
+			{
+				std::lock_guard<std::mutex> lock(injectMutex);
+				if (!injected.empty())
+				{
+					Job* job = injected.front();
+					injected.pop_front();
+					injectedCount.fetch_sub(1, std::memory_order_relaxed);
+					return job;
+				}
+			}
+
+			// start at a different victim per thread so thieves do not pile onto the same deque
+			size_t start = own ? static_cast<size_t>(own - queues[0].get()) : 0;
+			for (size_t i = 1; i <= queues.size(); i++)
+			{
+				Queue* victim = queues[(start + i) % queues.size()].get();
+				if (victim == own)
+				{
+					continue;
+				}
+				if (Job* job = victim->deque.steal())
+				{
+					return job;
+				}
+			}
+			return nullptr;
+		}
+
+		bool runPending(Queue* own)
+		{
+			Job* job = findJob(own);
+			if (!job)
+			{
+				return false;
+			}
+			queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+
+			// a pool job can be handed out again as soon as it has run
+			bool heapJob = job->heapAllocated;
+
+			job->run();
+			if (heapJob)
+			{
+				delete job;
+			}
+			pendingJobs.fetch_sub(1, std::memory_order_acq_rel);
+			return true;
+		}
+
+		bool runBackground()
+		{
+			if (backgroundJobs.load(std::memory_order_acquire) == 0)
+			{
+				return false;
+			}
+
+			Job* job;
+			{
+				std::lock_guard<std::mutex> lock(backgroundMutex);
+				if (background.empty())
+				{
+					return false;
+				}
+				job = background.front();
+				background.pop_front();
+				backgroundJobs.fetch_sub(1, std::memory_order_relaxed);
+			}
+
+			job->run();
+			delete job;
+			return true;
+		}
+
+		void workerLoop(uint32_t index)
+		{
+			bind(index);
+			Queue* own = queues[index].get();
+
+			uint32_t idleSpins = 0;
+			while (true)
+			{
+				if (runPending(own) || runBackground())
+				{
+					idleSpins = 0;
+					continue;
+				}
+
+				if (++idleSpins < 64)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				std::unique_lock<std::mutex> lock(sleepMutex);
+				sleepingWorkers.fetch_add(1);
+				wake.wait(lock, [this] { return stopping || queuedJobs.load() > 0 || backgroundJobs.load() > 0; });
+				sleepingWorkers.fetch_sub(1);
+				if (stopping)
+				{
+					break;
+				}
+				idleSpins = 0;
+			}
+		}
+
+		void shutdown()
+		{
+			if (!workers.empty())
+			{
+				wait();
+				{
+					std::lock_guard<std::mutex> lock(sleepMutex);
+					stopping = true;
+					wake.notify_all();
+				}
+				for (auto& worker : workers)
+				{
+					worker.join();
+				}
+				workers.clear();
+			}
+
+			// background jobs the workers never got to, or that were queued without any workers
+			while (runBackground())
+			{
+			}
 		}
 	};
-	
-	class ThreadPool
+
+	// A set of tasks with dependencies between them. The graph is built once and can be run
+	// again each time the previous run has finished; a task starts as soon as all of its
+	// predecessors are done, on whichever thread finished the last of them
+	class TaskGraph
 	{
 	public:
-		std::vector<Thread*> threads;
+		using Task = uint32_t;
 
-		// Sets the number of threads to be allocated in this pool
-		void setThreadCount(uint32_t count)
+		template<typename F>
+		Task add(F&& function)
 		{
-			threads.clear();
-			for (auto i = 0; i < count; i++)
+			nodes.push_back(std::unique_ptr<Node>(new Node()));
+			nodes.back()->work = std::forward<F>(function);
+			return static_cast<Task>(nodes.size() - 1);
+		}
+
+		// after only starts once before has finished
+		void precede(Task before, Task after)
+		{
+			nodes[before]->successors.push_back(after);
+			nodes[after]->dependencies++;
+		}
+
+		// Adds a continuation that starts once every task in parents has finished
+		template<typename F>
+		Task then(std::initializer_list<Task> parents, F&& function)
+		{
+			Task task = add(std::forward<F>(function));
+			for (Task parent : parents)
 			{
-				Thread* t = new Thread();
-				threads.push_back(t);
+				precede(parent, task);
 			}
+			return task;
 		}
 
-		// Wait until all threads have finished their work items
-		void wait()
+		// Schedules every task without predecessors and returns without waiting
+		void run(ThreadPool& pool)
+		{
+			unfinished.store(static_cast<uint32_t>(nodes.size()), std::memory_order_relaxed);
+			for (auto& node : nodes)
+			{
+				node->remaining.store(node->dependencies, std::memory_order_relaxed);
+			}
+			for (Task task = 0; task < nodes.size(); task++)
+			{
+				if (nodes[task]->dependencies == 0)
+				{
+					schedule(pool, task);
+				}
+			}
+		}
+
+		// Helps the pool until this graph has finished, unrelated jobs are not waited for
+		void wait(ThreadPool& pool)
+		{
+			pool.waitUntil([this] { return unfinished.load(std::memory_order_acquire) == 0; });
+		}
+
+	private:
+		struct Node
+		{
+			std::function<void()> work;
+			std::vector<Task> successors;
+			uint32_t dependencies = 0;
+			std::atomic<uint32_t> remaining{ 0 };
+		};
+
+		std::vector<std::unique_ptr<Node>> nodes;
+		std::atomic<uint32_t> unfinished{ 0 };
+
+		void schedule(ThreadPool& pool, Task task)
 		{
-			for (auto &thread : threads)
+			ThreadPool* owner = &pool;
+			pool.submit([this, owner, task] { execute(*owner, task); });
+		}
+
+		void execute(ThreadPool& pool, Task task)
+		{
+			Node& node = *nodes[task];
+			node.work();
+			for (Task next : node.successors)
 			{
-				thread->wait();
+				if (nodes[next]->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{
+					schedule(pool, next);
+				}
 			}
+			unfinished.fetch_sub(1, std::memory_order_release);
 		}
 	};
 
@@ -1,103 +1,137 @@
-#pragma once
-
-#include "vk_types.h"
-#include <vector>
-#include <array>
-#include <unordered_map>
-
-namespace vkutil {
-
-
-	class DescriptorAllocator {
-	public:
-
-		struct PoolSizes {
-			std::vector<std::pair<VkDescriptorType, float>> sizes =
-			{
-				{ VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f },
-				{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.f },
-				{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 4.f },
-				{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.f },
-				{ VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1.f },
-				{ VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1.f },
-				{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.f },
-				{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.f },
-				{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f },
-				{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.f },
-				{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 0.5f }
-			};
-		};
-
-		void reset_pools();
-		bool allocate(VkDescriptorSet* set, VkDescriptorSetLayout layout);
-
-		void init(VkDevice newDevice);
-
-		void cleanup();
-
-		VkDevice device;
-	private:
-		VkDescriptorPool grab_pool();
-
-		VkDescriptorPool currentPool{ VK_NULL_HANDLE };
-		PoolSizes descriptorSizes;
-		std::vector<VkDescriptorPool> usedPools;
-		std::vector<VkDescriptorPool> freePools;
-	};
-
-
-	class DescriptorLayoutCache {
-	public:
-		void init(VkDevice newDevice);
-		void cleanup();
-
-		VkDescriptorSetLayout create_descriptor_layout(VkDescriptorSetLayoutCreateInfo* info);
-
-		struct DescriptorLayoutInfo {
-
-			std::vector<VkDescriptorSetLayoutBinding> bindings;
-
-			bool operator==(const DescriptorLayoutInfo& other) const;
-
-			size_t hash() const;
-		};
-
-
-
-	private:
-
-		struct DescriptorLayoutHash
-		{
-
-			std::size_t operator()(const DescriptorLayoutInfo& k) const
-			{
-				return k.hash();
-			}
-		};
-
-		std::unordered_map<DescriptorLayoutInfo, VkDescriptorSetLayout, DescriptorLayoutHash> layoutCache;
-		VkDevice device;
-	};
-
-
-	class DescriptorBuilder {
-	public:
-
-		static DescriptorBuilder begin(DescriptorLayoutCache* layoutCache, DescriptorAllocator* allocator);
-
-		DescriptorBuilder& bind_buffer(uint32_t binding, VkDescriptorBufferInfo* bufferInfo, VkDescriptorType type, VkShaderStageFlags stageFlags);
-
-		DescriptorBuilder& bind_image(uint32_t binding, int imgCount, VkDescriptorImageInfo* imageInfo, VkDescriptorType type, VkShaderStageFlags stageFlags);
-
-		bool build(VkDescriptorSet& set, VkDescriptorSetLayout& layout);
-		bool build(VkDescriptorSet& set);
-	private:
-
-		std::vector<VkWriteDescriptorSet> writes;
-		std::vector<VkDescriptorSetLayoutBinding> bindings;
-
-
-		DescriptorLayoutCache* cache;
-		DescriptorAllocator* alloc;
-	};
-}
+#pragma once
+
+#include "vk_types.h"
+#include <vector>
+#include <array>
+#include <unordered_map>
+
+namespace vkutil {
+
+
+	class DescriptorAllocator {
+	public:
+
+		struct PoolSizes {
+			std::vector<std::pair<VkDescriptorType, float>> sizes =
+			{
+				{ VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f },
+				{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.f },
+				{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 4.f },
+				{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.f },
+				{ VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1.f },
+				{ VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1.f },
+				{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.f },
+				{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.f },
+				{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f },
+				{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.f },
+				{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 0.5f }
+			};
+		};
+
+		void reset_pools();
+		bool allocate(VkDescriptorSet* set, VkDescriptorSetLayout layout);
+
+		void init(VkDevice newDevice);
+
+		void cleanup();
+
+		VkDevice device;
+	private:
+		VkDescriptorPool grab_pool();
+
+		VkDescriptorPool currentPool{ VK_NULL_HANDLE };
+		PoolSizes descriptorSizes;
+		std::vector<VkDescriptorPool> usedPools;
+		std::vector<VkDescriptorPool> freePools;
+	};
+
+
+	class DescriptorLayoutCache {
+	public:
+		void init(VkDevice newDevice);
+		void cleanup();
+
+		VkDescriptorSetLayout create_descriptor_layout(VkDescriptorSetLayoutCreateInfo* info);
+
+		struct DescriptorLayoutInfo {
+
+			std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+			bool operator==(const DescriptorLayoutInfo& other) const;
+
+			size_t hash() const;
+		};
+
+
+
+	private:
+
+		struct DescriptorLayoutHash
+		{
+
+			std::size_t operator()(const DescriptorLayoutInfo& k) const
+			{
+				return k.hash();
+			}
+		};
+
+		std::unordered_map<DescriptorLayoutInfo, VkDescriptorSetLayout, DescriptorLayoutHash> layoutCache;
+		VkDevice device;
+	};
+
+
+	class SamplerCache {
+	public:
+		void init(VkDevice newDevice);
+		void cleanup();
+
+		VkSampler create_sampler(VkSamplerCreateInfo* info);
+
+		struct SamplerInfo {
+
+			VkSamplerCreateInfo info;
+
+			bool operator==(const SamplerInfo& other) const;
+
+			size_t hash() const;
+		};
+
+
+
+	private:
+
+		struct SamplerHash
+		{
+
+			std::size_t operator()(const SamplerInfo& k) const
+			{
+				return k.hash();
+			}
+		};
+
+		std::unordered_map<SamplerInfo, VkSampler, SamplerHash> samplerCache;
+		VkDevice device;
+	};
+
+
+	class DescriptorBuilder {
+	public:
+
+		static DescriptorBuilder begin(DescriptorLayoutCache* layoutCache, DescriptorAllocator* allocator);
+
+		DescriptorBuilder& bind_buffer(uint32_t binding, VkDescriptorBufferInfo* bufferInfo, VkDescriptorType type, VkShaderStageFlags stageFlags);
+
+		DescriptorBuilder& bind_image(uint32_t binding, int imgCount, VkDescriptorImageInfo* imageInfo, VkDescriptorType type, VkShaderStageFlags stageFlags);
+
+		bool build(VkDescriptorSet& set, VkDescriptorSetLayout& layout);
+		bool build(VkDescriptorSet& set);
+	private:
+
+		std::vector<VkWriteDescriptorSet> writes;
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+
+		DescriptorLayoutCache* cache;
+		DescriptorAllocator* alloc;
+	};
+}
@@ -1,2647 +1,3255 @@
-#include "vk_types.h"
-#include "vk_initializers.h"
-#include "vk_descriptors.h"
-#include "VkBootstrap.h"
-#include "vk_engine.h"
-#include <glm/glm.hpp>
-#include <glm/gtx/transform.hpp>
-#include <iostream>
-#include <fstream>
-
-#include "Texture.h"
-
-#define VMA_STATIC_VULKAN_FUNCTIONS 0 
-#define VMA_DYNAMIC_VULKAN_FUNCTIONS 1
-#define VMA_IMPLEMENTATION
-#include <vma/vk_mem_alloc.h>
-
-
-#define VK_CHECK(x)                                                 \
-	do                                                              \
-	{                                                               \
-		VkResult err = x;                                           \
-		if (err)                                                    \
-		{                                                           \
-			std::cout <<"Detected Vulkan error: " << err << std::endl; \
-			abort();                                                \
-		}                                                           \
-	} while (0)
-
-#ifdef NDEBUG
-constexpr bool bUseValidationLayers = false;
-#else
-constexpr bool bUseValidationLayers = true;
-#endif
-
-const std::vector<std::string> TEXTURE_PATHS =
-{
-	"assets/NY_City/City Block OBJ/Building textures/Building 1/Brownstone red_Color.png",
-	"assets/NY_City/City Block OBJ/Building textures/Building 2/Building brick cornor_Color.png",
-	 "assets/NY_City/City Block OBJ/Building textures/Building 3/Townhouse 001_color.png",
-	 "assets/NY_City/City Block OBJ/Building textures/Building 4/Townhouse6_Color.png",
-	"assets/NY_City/City Block OBJ/Building textures/Building 5/Brownstone tall_Color.png",
-	 "assets/NY_City/City Block OBJ/Building textures/Building 6/Brick Building_Color.png",
-	 "assets/NY_City/City Block OBJ/Building textures/Building 7/Building center_Color.png",
-	 "assets/NY_City/City Block OBJ/Building textures/Building 9/Townhousecornor_color.png",
-	"assets/NY_City/City Block OBJ/Building textures/Building 10/Townhouse Brownstone_Color.png",
-	 "assets/NY_City/City Block OBJ/Maple tree/Bark.png",
-	 "assets/NY_City/City Block OBJ/Maple tree/leaf2_Color.png",
-	 "assets/NY_City/City Block OBJ/Road textures/Center road.png",
-	 "assets/NY_City/City Block OBJ/Road textures/Road.png",
-	 "assets/NY_City/City Block OBJ/Road textures/Side walk.png",
-	"assets/front.png",
-	"assets/left.png",
-	"assets/right.png",
-	"assets/back.png",
-	"assets/top.png",
-};
-
-const std::vector<std::string> TEXTURE_NAMES =
-{
-	"Building 1",
-	"Building 2",
-	 "Building 3",
-	 "Building 4",
-	"Building 5",
-	 "Building 6",
-	 "Building 7",
-	 "Building 9",
-	 "Building 10",
-	"Bark",
-	"Leaf 2",
-	"Center road",
-	"Road",
-	"Side walk",
-	"Front",
-	"Left",
-	"Right",
-	"Back",
-	"Top"
-};
-
-
-
-void VulkanEngine::init()
-{
-	glfwInit();
-	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-
-	_window = glfwCreateWindow(_windowExtent.width,
-		_windowExtent.height, "Vulkan", nullptr, nullptr);
-
-	glfwSetWindowUserPointer(_window, this);
-	glfwSetFramebufferSizeCallback(_window, framebufferResizeCallback);
-
-	glfwSetWindowUserPointer(_window, this);
-
-	glfwSetKeyCallback(_window, key_callback);
-	glfwSetMouseButtonCallback(_window, mouse_button_callback);
-	glfwSetCursorPosCallback(_window, cursor_position_callback);
-	glfwSetCursorEnterCallback(_window, cursor_enter_callback);
-
-	init_vulkan();
-
-	init_swapchain();
-
-
-	init_gbuffer_renderpass();
-
-	init_default_renderpass();
-
-	prepare_depthpass();
-
-	init_framebuffers();
-
-	init_commands();
-
-	init_sync_structures();
-
-	init_descriptors();
-
-	init_pipelines();
-
-	load_images();
-
-	load_meshes();
-
-	init_scene();
-
-	_isInitialized = true;
-}
-void VulkanEngine::cleanup()
-{
-	if (_isInitialized) {
-
-		vkDeviceWaitIdle(_device);
-
-		_mainDeletionQueue.flush();
-
-		for (int i = 0; i < FRAME_OVERLAP; i++)
-		{
-			_frames[i]._frameDeletionQueue.flush();
-		}
-		
-		vkDestroySurfaceKHR(_instance, _surface, nullptr);
-
-		_descriptorAllocator->cleanup();
-		_descriptorLayoutCache->cleanup();
-
-		vkDestroyDevice(_device, nullptr);
-		vkb::destroy_debug_utils_messenger(_instance, _debug_messenger);
-		vkDestroyInstance(_instance, nullptr);
-
-		glfwDestroyWindow(_window);
-
-		glfwTerminate();
-	}
-}
-
-void VulkanEngine::draw()
-{
-	uint32_t swapchainImageIndex;
-	VK_CHECK(vkAcquireNextImageKHR(_device, _swapchain, UINT64_MAX, get_current_frame()._presentSemaphore, nullptr, &swapchainImageIndex));
-
-	wait_for_drawing();
-
-	update_descriptors(_renderables.data(), _renderables.size());
-
-	prepare_light_culling();
-
-	prepare_culling();
-
-
-	VkCommandBuffer shadow_cmd = get_current_frame()._shadowCommandBuffer;
-	VkCommandBuffer cmd = get_current_frame()._mainCommandBuffer;
-
-	prepare_shadowmap();
-
-	VkSubmitInfo shadowSubmit = vkinit::submit_info(&shadow_cmd);
-
-	VK_CHECK(vkQueueSubmit(_graphicsQueue, 1, &shadowSubmit, nullptr));
-
-	render_scene(swapchainImageIndex);
-
-	VkSubmitInfo submit = vkinit::submit_info(&cmd);
-	VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-
-	submit.pWaitDstStageMask = &waitStage;
-
-	submit.waitSemaphoreCount = 1;
-	submit.pWaitSemaphores = &get_current_frame()._presentSemaphore;
-
-	submit.signalSemaphoreCount = 1;
-	submit.pSignalSemaphores = &get_current_frame()._renderSemaphore;
-
-	VK_CHECK(vkQueueSubmit(_graphicsQueue, 1, &submit, get_current_frame()._renderFence));
-
-
-	VkPresentInfoKHR presentInfo = vkinit::present_info();
-
-	presentInfo.pSwapchains = &_swapchain;
-	presentInfo.swapchainCount = 1;
-
-	presentInfo.pWaitSemaphores = &get_current_frame()._renderSemaphore;
-	presentInfo.waitSemaphoreCount = 1;
-
-	presentInfo.pImageIndices = &swapchainImageIndex;
-
-	VK_CHECK(vkQueuePresentKHR(_graphicsQueue, &presentInfo));
-	_frameNumber++;
-}
-
-void VulkanEngine::multithreading_draw()
-{
-	
-	VkCommandBuffer shadow_cmd = get_current_frame()._shadowCommandBuffer;
-	VkCommandBuffer cmd = get_current_frame()._mainCommandBuffer;
-	uint32_t swapchainImageIndex;
-	
-	VK_CHECK(vkAcquireNextImageKHR(_device, _swapchain, UINT64_MAX, get_current_frame()._presentSemaphore, nullptr, &swapchainImageIndex));
-
-	wait_for_drawing();
-
-	prepare_culling();
-	prepare_light_culling();
-
-	update_descriptors(_renderables.data(), _renderables.size());
-
-
-	_threadpool.threads[0]->addJob([=] {
-
-		prepare_shadowmap();
-
-		});
-
-	render_scene(swapchainImageIndex);
-
-	_threadpool.wait();
-
-	VkSubmitInfo shadowSubmit = vkinit::submit_info(&shadow_cmd);
-
-	VK_CHECK(vkQueueSubmit(_graphicsQueue, 1, &shadowSubmit, nullptr));
-
-	VkSubmitInfo submit = vkinit::submit_info(&cmd);
-	VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-
-	submit.pWaitDstStageMask = &waitStage;
-
-	submit.waitSemaphoreCount = 1;
-	submit.pWaitSemaphores = &get_current_frame()._presentSemaphore;
-
-	submit.signalSemaphoreCount = 1;
-	submit.pSignalSemaphores = &get_current_frame()._renderSemaphore;
-
-	VK_CHECK(vkQueueSubmit(_graphicsQueue, 1, &submit, get_current_frame()._renderFence));
-	
-	VkPresentInfoKHR presentInfo = vkinit::present_info();
-
-	presentInfo.pSwapchains = &_swapchain;
-	presentInfo.swapchainCount = 1;
-
-	presentInfo.pWaitSemaphores = &get_current_frame()._renderSemaphore;
-	presentInfo.waitSemaphoreCount = 1;
-
-	presentInfo.pImageIndices = &swapchainImageIndex;
-
-	VK_CHECK(vkQueuePresentKHR(_graphicsQueue, &presentInfo));
-
-	_frameNumber++;
-}
-
-
-void VulkanEngine::run()
-{
-	while (!glfwWindowShouldClose(_window)) {
-		glfwPollEvents();
-		//draw();
-		multithreading_draw();
-	}
-
-}
-
-void VulkanEngine::wait_for_drawing() {
-	VK_CHECK(vkWaitForFences(_device, 1, &get_current_frame()._renderFence, true, UINT64_MAX));
-	VK_CHECK(vkResetFences(_device, 1, &get_current_frame()._renderFence));
-
-	VK_CHECK(vkResetCommandBuffer(get_current_frame()._cullShadowCommandBuffer, 0));
-	VK_CHECK(vkResetCommandBuffer(get_current_frame()._cullCommandBuffer, 0));
-	VK_CHECK(vkResetCommandBuffer(get_current_frame()._mainCommandBuffer, 0));
-	VK_CHECK(vkResetCommandBuffer(get_current_frame()._shadowCommandBuffer, 0));
-}
-
-void VulkanEngine::prepare_culling() {
-	VkCommandBuffer cmd = get_current_frame()._cullShadowCommandBuffer;
-
-	cmd = get_current_frame()._cullCommandBuffer;
-	execute_culling(cmd, _renderables.data(), _renderables.size());
-
-	VkSubmitInfo cullSubmit;
-	cullSubmit = vkinit::submit_info(&cmd);
-	VK_CHECK(vkQueueSubmit(_graphicsQueue, 1, &cullSubmit, nullptr));
-}
-
-void VulkanEngine::prepare_light_culling() {
-	VkCommandBuffer cmd = get_current_frame()._cullShadowCommandBuffer;
-	for (uint32_t i = 0; i < SHADOW_MAP_CASCADE_COUNT; i++) {
-		execute_shadow_culling(cmd, _renderables.data(), _renderables.size(), i);
-	}
-	VkSubmitInfo cullSubmit;
-	cullSubmit = vkinit::submit_info(&cmd);
-	VK_CHECK(vkQueueSubmit(_graphicsQueue, 1, &cullSubmit, nullptr));
-
-}
-
-void  VulkanEngine::prepare_shadowmap() {
-
-	VkCommandBuffer cmd = get_current_frame()._shadowCommandBuffer;
-
-	VkClearValue clearValue;
-	clearValue.color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
-
-	VkClearValue depthClear;
-	depthClear.depthStencil.depth = 1.f;
-
-	VkClearValue clearValues[] = { clearValue, depthClear };
-
-	VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
-	VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
-
-
-	for (size_t i = 0; i < SHADOW_MAP_CASCADE_COUNT; i++) {
-		VkRenderPassBeginInfo sdrpInfo = vkinit::renderpass_begin_info(_depthPass, _shadowExtent, get_current_frame().cascades[i].frameBuffer);
-
-		VkClearValue clearValues[1];
-		clearValues[0].depthStencil = { 1.0f, 0 };
-
-		sdrpInfo.clearValueCount = 1;
-		sdrpInfo.pClearValues = clearValues;
-
-		vkCmdBeginRenderPass(cmd, &sdrpInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-		update_csm(cmd, _renderables.data(), _renderables.size(), i);
-
-		vkCmdEndRenderPass(cmd);
-
-	}
-	VK_CHECK(vkEndCommandBuffer(cmd));
-}
-
-
-
-void  VulkanEngine::render_scene(uint32_t swapchainImageIndex) {
-
-	VkCommandBuffer cmd = get_current_frame()._mainCommandBuffer;
-
-	VkClearValue clearValue;
-	clearValue.color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
-
-	VkClearValue depthClear;
-	depthClear.depthStencil.depth = 1.f;
-
-	VkClearValue clearValues[] = { clearValue, depthClear };
-
-	VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
-	VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
-	VkRenderPassBeginInfo rpInfo = vkinit::renderpass_begin_info(_renderPass, _windowExtent, _framebuffers[swapchainImageIndex]);
-
-	rpInfo.clearValueCount = 2;
-
-	rpInfo.pClearValues = &clearValues[0];
-
-	vkCmdBeginRenderPass(cmd, &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-	draw_objects(cmd, _renderables.data(), _renderables.size());
-	vkCmdEndRenderPass(cmd);
-	VK_CHECK(vkEndCommandBuffer(cmd));
-
-}
-
-FrameData& VulkanEngine::get_current_frame()
-{
-	return _frames[_frameNumber % FRAME_OVERLAP];
-}
-
-
-FrameData& VulkanEngine::get_last_frame()
-{
-	return _frames[(_frameNumber - 1) % FRAME_OVERLAP];
-}
-
-FrameData& VulkanEngine::get_next_frame()
-{
-	return _frames[(_frameNumber + 1) % FRAME_OVERLAP];
-}
-
-void VulkanEngine::init_vulkan()
-{
-	vkb::InstanceBuilder builder;
-
-	auto inst_ret = builder.set_app_name("Example Vulkan Application")
-		.request_validation_layers(bUseValidationLayers)
-		.use_default_debug_messenger()
-		.require_api_version(1, 1, 0)
-		.build();
-
-	vkb::Instance vkb_inst = inst_ret.value();
-
-	_instance = vkb_inst.instance;
-	_debug_messenger = vkb_inst.debug_messenger;
-
-	glfwCreateWindowSurface(_instance, _window, NULL, &_surface);
-
-	vkb::PhysicalDeviceSelector selector{ vkb_inst };
-	VkPhysicalDeviceFeatures feats{};
-
-	feats.pipelineStatisticsQuery = true;
-	feats.multiDrawIndirect = true;
-	feats.drawIndirectFirstInstance = true;
-	feats.samplerAnisotropy = true;
-	selector.set_required_features(feats);
-
-	vkb::PhysicalDevice physicalDevice = selector
-		.set_minimum_version(1, 1)
-		.set_surface(_surface)
-		.select()
-		.value();
-
-	vkb::DeviceBuilder deviceBuilder{ physicalDevice };
-	VkPhysicalDeviceShaderDrawParametersFeatures shader_draw_parameters_features = {};
-	shader_draw_parameters_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_DRAW_PARAMETERS_FEATURES;
-	shader_draw_parameters_features.pNext = nullptr;
-	shader_draw_parameters_features.shaderDrawParameters = true;
-	vkb::Device vkbDevice = deviceBuilder.add_pNext(&shader_draw_parameters_features).build().value();
-
-	_device = vkbDevice.device;
-	_chosenGPU = physicalDevice.physical_device;
-
-	_graphicsQueue = vkbDevice.get_queue(vkb::QueueType::graphics).value();
-
-	_graphicsQueueFamily = vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
-
-	VmaVulkanFunctions vulkanFunctions = {};
-	vulkanFunctions.vkGetInstanceProcAddr = &vkGetInstanceProcAddr;
-	vulkanFunctions.vkGetDeviceProcAddr = &vkGetDeviceProcAddr;
-
-	VmaAllocatorCreateInfo allocatorInfo = {};
-	allocatorInfo.physicalDevice = _chosenGPU;
-	allocatorInfo.device = _device;
-	allocatorInfo.instance = _instance;
-	allocatorInfo.pVulkanFunctions = &vulkanFunctions;
-	vmaCreateAllocator(&allocatorInfo, &_allocator);
-
-	_mainDeletionQueue.push_function([&]() {
-		vmaDestroyAllocator(_allocator);
-		});
-
-	vkGetPhysicalDeviceProperties(_chosenGPU, &_gpuProperties);
-
-}
-
-void VulkanEngine::init_swapchain()
-{
-	vkb::SwapchainBuilder swapchainBuilder{_chosenGPU, _device, _surface };
-
-	vkb::Swapchain vkbSwapchain = swapchainBuilder
-		.use_default_format_selection()
-		.set_desired_present_mode(VK_PRESENT_MODE_MAILBOX_KHR)
-		.set_desired_extent(_windowExtent.width, _windowExtent.height)
-		.build()
-		.value();
-
-	_swapchain = vkbSwapchain.swapchain;
-	_swapchainImages = vkbSwapchain.get_images().value();
-	_swapchainImageViews = vkbSwapchain.get_image_views().value();
-
-	_swachainImageFormat = vkbSwapchain.image_format;
-
-	_mainDeletionQueue.push_function([=]() {
-		vkDestroySwapchainKHR(_device, _swapchain, nullptr);
-		});
-
-	VkExtent3D windowImageExtent = {
-		_windowExtent.width,
-		_windowExtent.height,
-		1
-	};
-
-	_depthFormat = VK_FORMAT_D32_SFLOAT;
-	_shadowMapFormat = VK_FORMAT_R8G8B8A8_SRGB;
-
-	VkImageCreateInfo dimg_info = vkinit::image_create_info(_depthFormat,1, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, windowImageExtent, _msaaSamples,1);
-
-	VmaAllocationCreateInfo dimg_allocinfo = {};
-	dimg_allocinfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-	dimg_allocinfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-	vmaCreateImage(_allocator, &dimg_info, &dimg_allocinfo, &_depthImage._image, &_depthImage._allocation, nullptr);
-
-	VkImageViewCreateInfo dview_info = vkinit::imageview_create_info(_depthFormat, _depthImage._image, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
-
-	VK_CHECK(vkCreateImageView(_device, &dview_info, nullptr, &_depthImageView));
-
-	
-
-	VmaAllocationCreateInfo cimg_allocinfo = {};
-	cimg_allocinfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-	cimg_allocinfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-	VkImageCreateInfo cimg_info = vkinit::image_create_info(_swachainImageFormat,1, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, windowImageExtent, _msaaSamples,1);
-
-	vmaCreateImage(_allocator, &cimg_info, &cimg_allocinfo, &_colorImage._image, &_colorImage._allocation, nullptr);
-
-	VkImageViewCreateInfo cview_info = vkinit::imageview_create_info(_swachainImageFormat, _colorImage._image, VK_IMAGE_ASPECT_COLOR_BIT,1);
-
-	VK_CHECK(vkCreateImageView(_device, &cview_info, nullptr, &_colorImageView));
-
-
-	_mainDeletionQueue.push_function([=]() {
-		vkDestroyImageView(_device, _depthImageView, nullptr);
-		vmaDestroyImage(_allocator, _depthImage._image, _depthImage._allocation);
-
-		vkDestroyImageView(_device, _colorImageView, nullptr);
-		vmaDestroyImage(_allocator, _colorImage._image, _colorImage._allocation);
-
-		});
-}
-
-
-void VulkanEngine::init_gbuffer_renderpass()
-{
-
-	VkAttachmentDescription color_attachment = {};
-	color_attachment.format = VK_FORMAT_R8G8B8A8_SRGB;
-	color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	color_attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-	VkAttachmentReference color_attachment_ref[5]{};
-	color_attachment_ref[0].attachment = 0;
-	color_attachment_ref[0].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	color_attachment_ref[1].attachment = 1;
-	color_attachment_ref[1].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	color_attachment_ref[2].attachment = 2;
-	color_attachment_ref[2].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	color_attachment_ref[3].attachment = 3;
-	color_attachment_ref[3].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	color_attachment_ref[4].attachment = 4;
-	color_attachment_ref[4].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentDescription depth_attachment = {};
-	depth_attachment.flags = 0;
-	depth_attachment.format = _depthFormat;
-	depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depth_attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-	VkAttachmentReference depth_attachment_ref = {};
-	depth_attachment_ref.attachment = 5;
-	depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpass = {};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 5;
-	subpass.pColorAttachments = &color_attachment_ref[0];
-	subpass.pDepthStencilAttachment = &depth_attachment_ref;
-
-	VkSubpassDependency dependency = {};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-	VkSubpassDependency depth_dependency = {};
-	depth_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	depth_dependency.dstSubpass = 0;
-	depth_dependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-	depth_dependency.srcAccessMask = 0;
-	depth_dependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-	depth_dependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-	VkSubpassDependency dependencies[2] = { dependency, depth_dependency };
-
-	VkAttachmentDescription attachments[6] = { color_attachment, color_attachment ,color_attachment, color_attachment,color_attachment, depth_attachment };
-
-	VkRenderPassCreateInfo render_pass_info = {};
-	render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	render_pass_info.attachmentCount = 6;
-	render_pass_info.pAttachments = &attachments[0];
-	render_pass_info.subpassCount = 1;
-	render_pass_info.pSubpasses = &subpass;
-	render_pass_info.dependencyCount = 2;
-	render_pass_info.pDependencies = &dependencies[0];
-
-	VK_CHECK(vkCreateRenderPass(_device, &render_pass_info, nullptr, &_gBufferPass));
-
-	_mainDeletionQueue.push_function([=]() {
-		vkDestroyRenderPass(_device, _gBufferPass, nullptr);
-		});
-
-}
-
-void VulkanEngine::init_default_renderpass()
-{
-
-	VkAttachmentDescription color_attachment = {};
-	color_attachment.format = _swachainImageFormat;
-	color_attachment.samples = _msaaSamples;
-	color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	color_attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference color_attachment_ref = {};
-	color_attachment_ref.attachment = 0;
-	color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentDescription depth_attachment = {};
-	depth_attachment.flags = 0;
-	depth_attachment.format = _depthFormat;
-	depth_attachment.samples = _msaaSamples;
-	depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference depth_attachment_ref = {};
-	depth_attachment_ref.attachment = 1;
-	depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentDescription color_attachment_res = {};
-	color_attachment_res.format = _swachainImageFormat;
-	color_attachment_res.samples = VK_SAMPLE_COUNT_1_BIT;
-	color_attachment_res.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	color_attachment_res.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	color_attachment_res.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	color_attachment_res.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	color_attachment_res.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	color_attachment_res.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	VkAttachmentReference color_attachment_res_ref = {};
-	color_attachment_res_ref.attachment = 2;
-	color_attachment_res_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpass = {};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &color_attachment_ref;
-	subpass.pDepthStencilAttachment = &depth_attachment_ref;
-	subpass.pResolveAttachments = &color_attachment_res_ref;
-
-	VkSubpassDependency dependency = {};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-	VkSubpassDependency depth_dependency = {};
-	depth_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	depth_dependency.dstSubpass = 0;
-	depth_dependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-	depth_dependency.srcAccessMask = 0;
-	depth_dependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-	depth_dependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-	VkSubpassDependency dependencies[2] = { dependency, depth_dependency };
-
-	VkAttachmentDescription attachments[3] = { color_attachment, depth_attachment, color_attachment_res };
-
-	VkRenderPassCreateInfo render_pass_info = {};
-	render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	render_pass_info.attachmentCount = 3;
-	render_pass_info.pAttachments = &attachments[0];
-	render_pass_info.subpassCount = 1;
-	render_pass_info.pSubpasses = &subpass;
-	render_pass_info.dependencyCount = 2;
-	render_pass_info.pDependencies = &dependencies[0];
-
-	VK_CHECK(vkCreateRenderPass(_device, &render_pass_info, nullptr, &_renderPass));
-
-	_mainDeletionQueue.push_function([=]() {
-		vkDestroyRenderPass(_device, _renderPass, nullptr);
-		});
-
-}
-
-void VulkanEngine::init_framebuffers()
-{
-
-	VkFramebufferCreateInfo fb_info = vkinit::framebuffer_create_info(_renderPass, _windowExtent);
-
-	const uint32_t swapchain_imagecount = _swapchainImages.size();
-	_framebuffers = std::vector<VkFramebuffer>(swapchain_imagecount);
-
-
-	for (int i = 0; i < swapchain_imagecount; i++) {
-		VkImageView attachments[3];
-		attachments[0] = _colorImageView;
-		attachments[1] = _depthImageView;
-		attachments[2] = _swapchainImageViews[i];
-
-		fb_info.pAttachments = attachments;
-		fb_info.attachmentCount = 3;
-
-		VK_CHECK(vkCreateFramebuffer(_device, &fb_info, nullptr, &_framebuffers[i]));
-
-		_mainDeletionQueue.push_function([=]() {
-			vkDestroyFramebuffer(_device, _framebuffers[i], nullptr);
-			vkDestroyImageView(_device, _swapchainImageViews[i], nullptr);
-			});
-	}
-
-}
-
-void VulkanEngine::init_commands()
-{
-	_threadpool.setThreadCount(1);
-	VkCommandPoolCreateInfo commandPoolInfo = vkinit::command_pool_create_info(_graphicsQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
-
-
-	for (int i = 0; i < FRAME_OVERLAP; i++) {
-
-		VK_CHECK(vkCreateCommandPool(_device, &commandPoolInfo, nullptr, &_frames[i]._cullCommandPool));
-		VK_CHECK(vkCreateCommandPool(_device, &commandPoolInfo, nullptr, &_frames[i]._cullShadowCommandPool));
-		VK_CHECK(vkCreateCommandPool(_device, &commandPoolInfo, nullptr, &_frames[i]._commandPool));
-		VK_CHECK(vkCreateCommandPool(_device, &commandPoolInfo, nullptr, &_frames[i]._shadowCommandPool));
-
-
-		VkCommandBufferAllocateInfo cmdAllocInfo; 
-		cmdAllocInfo = vkinit::command_buffer_allocate_info(_frames[i]._cullCommandPool, 1);
-		VK_CHECK(vkAllocateCommandBuffers(_device, &cmdAllocInfo, &_frames[i]._cullCommandBuffer));
-
-		cmdAllocInfo = vkinit::command_buffer_allocate_info(_frames[i]._cullShadowCommandPool, 1);
-		VK_CHECK(vkAllocateCommandBuffers(_device, &cmdAllocInfo, &_frames[i]._cullShadowCommandBuffer));
-
-		cmdAllocInfo = vkinit::command_buffer_allocate_info(_frames[i]._commandPool, 1);
-		VK_CHECK(vkAllocateCommandBuffers(_device, &cmdAllocInfo, &_frames[i]._mainCommandBuffer));
-
-		cmdAllocInfo = vkinit::command_buffer_allocate_info(_frames[i]._shadowCommandPool, 1);
-		VK_CHECK(vkAllocateCommandBuffers(_device, &cmdAllocInfo, &_frames[i]._shadowCommandBuffer));
-
-
-	}
-
-
-	VkCommandPoolCreateInfo uploadCommandPoolInfo = vkinit::command_pool_create_info(_graphicsQueueFamily);
-	VK_CHECK(vkCreateCommandPool(_device, &uploadCommandPoolInfo, nullptr, &_uploadContext._commandPool));
-
-	_mainDeletionQueue.push_function([=]() {
-		vkDestroyCommandPool(_device, _uploadContext._commandPool, nullptr);
-		for (int i = 0; i < FRAME_OVERLAP; i++) {
-		vkDestroyCommandPool(_device, _frames[i]._cullCommandPool, nullptr);
-		vkDestroyCommandPool(_device, _frames[i]._cullShadowCommandPool, nullptr);
-		vkDestroyCommandPool(_device, _frames[i]._commandPool, nullptr);
-		vkDestroyCommandPool(_device, _frames[i]._shadowCommandPool, nullptr);
-		}
-	});
-
-	VkCommandBufferAllocateInfo cmdAllocInfo = vkinit::command_buffer_allocate_info(_uploadContext._commandPool, 1);
-
-	VK_CHECK(vkAllocateCommandBuffers(_device, &cmdAllocInfo, &_uploadContext._commandBuffer));
-}
-
-void VulkanEngine::init_sync_structures()
-{
-	VkFenceCreateInfo fenceCreateInfo = vkinit::fence_create_info(VK_FENCE_CREATE_SIGNALED_BIT);
-
-	VkSemaphoreCreateInfo semaphoreCreateInfo = vkinit::semaphore_create_info();
-
-	for (int i = 0; i < FRAME_OVERLAP; i++) {
-
-		VK_CHECK(vkCreateFence(_device, &fenceCreateInfo, nullptr, &_frames[i]._renderFence));
-
-		_mainDeletionQueue.push_function([=]() {
-			vkDestroyFence(_device, _frames[i]._renderFence, nullptr);
-			});
-
-
-		VK_CHECK(vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &_frames[i]._presentSemaphore));
-		VK_CHECK(vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &_frames[i]._renderSemaphore));
-
-		_mainDeletionQueue.push_function([=]() {
-			vkDestroySemaphore(_device, _frames[i]._presentSemaphore, nullptr);
-			vkDestroySemaphore(_device, _frames[i]._renderSemaphore, nullptr);
-			});
-	}
-
-
-	VkFenceCreateInfo uploadFenceCreateInfo = vkinit::fence_create_info();
-
-	VK_CHECK(vkCreateFence(_device, &uploadFenceCreateInfo, nullptr, &_uploadContext._uploadFence));
-	_mainDeletionQueue.push_function([=]() {
-		vkDestroyFence(_device, _uploadContext._uploadFence, nullptr);
-		});
-}
-
-void VulkanEngine::init_pipelines()
-{
-
-
-	PipelineBuilder pipelineBuilder;
-
-	VkPipelineLayoutCreateInfo mesh_pipeline_layout_info = vkinit::pipeline_layout_create_info();
-
-	VkPipelineLayoutCreateInfo scene_pipeline_layout_info = mesh_pipeline_layout_info;
-	VkDescriptorSetLayout sceneLayouts[] = { _globalSetLayout, _cascadesSetLayout, _objectSetLayout, _csmSetLayout, _singleTextureSetLayout };
-
-	scene_pipeline_layout_info.setLayoutCount = 5;
-	scene_pipeline_layout_info.pSetLayouts = sceneLayouts;
-
-	VkPipelineLayout scenePipeLayout;
-	VK_CHECK(vkCreatePipelineLayout(_device, &scene_pipeline_layout_info, nullptr, &scenePipeLayout));
-
-	VkPipelineLayoutCreateInfo textured_specular_pipeline_layout_info = mesh_pipeline_layout_info;
-
-	VkPipelineLayoutCreateInfo shadow_pipeline_layout_info = mesh_pipeline_layout_info;
-	VkDescriptorSetLayout shadowSetLayouts[] = { _lightSetLayout, _objectSetLayout };
-
-	shadow_pipeline_layout_info.setLayoutCount = 2;
-	shadow_pipeline_layout_info.pSetLayouts = shadowSetLayouts;
-
-	VkPipelineLayout shadowPipeLayout;
-	VK_CHECK(vkCreatePipelineLayout(_device, &shadow_pipeline_layout_info, nullptr, &shadowPipeLayout));
-
-	pipelineBuilder._vertexInputInfo = vkinit::vertex_input_state_create_info();
-
-
-	pipelineBuilder._inputAssembly = vkinit::input_assembly_create_info(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
-
-	pipelineBuilder._viewport.x = 0.0f;
-	pipelineBuilder._viewport.y = 0.0f;
-	pipelineBuilder._viewport.width = (float)_windowExtent.width;
-	pipelineBuilder._viewport.height = (float)_windowExtent.height;
-	pipelineBuilder._viewport.minDepth = 0.0f;
-	pipelineBuilder._viewport.maxDepth = 1.0f;
-
-	pipelineBuilder._scissor.offset = { 0, 0 };
-	pipelineBuilder._scissor.extent = _windowExtent;
-
-	pipelineBuilder._rasterizer = vkinit::rasterization_state_create_info(VK_POLYGON_MODE_FILL);
-	pipelineBuilder._rasterizer.cullMode = VK_CULL_MODE_NONE;
-
-	pipelineBuilder._multisampling = vkinit::multisampling_state_create_info(_msaaSamples);
-
-	pipelineBuilder._colorBlendAttachment.push_back(vkinit::color_blend_attachment_state());
-
-	pipelineBuilder._depthStencil = vkinit::depth_stencil_create_info(true, true, VK_COMPARE_OP_LESS_OR_EQUAL);
-
-
-	VertexInputDescription vertexDescription = Vertex::get_vertex_description();
-
-	pipelineBuilder._vertexInputInfo.pVertexAttributeDescriptions = vertexDescription.attributes.data();
-	pipelineBuilder._vertexInputInfo.vertexAttributeDescriptionCount = vertexDescription.attributes.size();
-
-	pipelineBuilder._vertexInputInfo.pVertexBindingDescriptions = vertexDescription.bindings.data();
-	pipelineBuilder._vertexInputInfo.vertexBindingDescriptionCount = vertexDescription.bindings.size();
-
-	VkShaderModule meshVertShader;
-	if (!load_shader_module("shaders/shader.vert.spv", &meshVertShader))
-	{
-		std::cout << "Error when building the mesh vertex shader module" << std::endl;
-	}
-
-	VkShaderModule sceneShader;
-	if (!load_shader_module("shaders/scene_shader.frag.spv", &sceneShader))
-	{
-		std::cout << "Error when building the scene shader module" << std::endl;
-	}
-	
-	pipelineBuilder._shaderStages.clear();
-	pipelineBuilder._shaderStages.push_back(
-		vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_VERTEX_BIT, meshVertShader));
-
-	pipelineBuilder._shaderStages.push_back(
-		vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT, sceneShader));
-	pipelineBuilder._pipelineLayout = scenePipeLayout;
-	VkPipeline scenePipeline = pipelineBuilder.build_pipeline(_device, _renderPass);
-	for (auto name : TEXTURE_NAMES) {
-		create_material(scenePipeline, scenePipeLayout, name);
-	}
-	
-	VkShaderModule skyboxVertShader;
-	if (!load_shader_module("shaders/skybox_shader.vert.spv", &skyboxVertShader))
-	{
-		std::cout << "Error when building the skybox vertex shader module" << std::endl;
-	}
-
-	VkShaderModule skyboxShader;
-	if (!load_shader_module("shaders/skybox_shader.frag.spv", &skyboxShader))
-	{
-		std::cout << "Error when building the skyboxshader module" << std::endl;
-	}
-
-	pipelineBuilder._shaderStages.clear();
-	pipelineBuilder._shaderStages.push_back(
-		vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_VERTEX_BIT, skyboxVertShader));
-
-	pipelineBuilder._shaderStages.push_back(
-		vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT, skyboxShader));
-	pipelineBuilder._pipelineLayout = scenePipeLayout;
-	VkPipeline skyboxPipeline = pipelineBuilder.build_pipeline(_device, _renderPass);
-	create_material(skyboxPipeline, scenePipeLayout, "Front");
-	create_material(skyboxPipeline, scenePipeLayout, "Left");
-	create_material(skyboxPipeline, scenePipeLayout, "Right");
-	create_material(skyboxPipeline, scenePipeLayout, "Back");
-	create_material(skyboxPipeline, scenePipeLayout, "Top");
-
-
-	pipelineBuilder._multisampling = vkinit::multisampling_state_create_info(VK_SAMPLE_COUNT_1_BIT);
-
-	pipelineBuilder._viewport.width = (float)_shadowExtent.width;
-	pipelineBuilder._viewport.height = (float)_shadowExtent.height;
-	pipelineBuilder._scissor.extent = _shadowExtent;
-
-	VkShaderModule directDepthShader;
-	if (!load_shader_module("shaders/depth_shader.vert.spv", &directDepthShader))
-	{
-		std::cout << "Error when building the depthshader module" << std::endl;
-	}
-	pipelineBuilder._shaderStages.clear();
-	pipelineBuilder._shaderStages.push_back(
-		vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_VERTEX_BIT, directDepthShader));
-
-
-	pipelineBuilder._pipelineLayout = shadowPipeLayout;
-	pipelineBuilder._rasterizer.cullMode = VK_CULL_MODE_NONE;
-	VkPipeline depthPipeline = pipelineBuilder.build_pipeline(_device, _depthPass);
-	create_material(depthPipeline, shadowPipeLayout, "directDepth");
-
-
-	vkDestroyShaderModule(_device, meshVertShader, nullptr);
-	vkDestroyShaderModule(_device, skyboxVertShader, nullptr);
-	vkDestroyShaderModule(_device, skyboxShader, nullptr);
-	vkDestroyShaderModule(_device, sceneShader, nullptr);
-	vkDestroyShaderModule(_device, directDepthShader, nullptr);
-
-
-	_mainDeletionQueue.push_function([=]() {
-		vkDestroyPipeline(_device, skyboxPipeline, nullptr);
-		vkDestroyPipeline(_device, depthPipeline, nullptr);
-		vkDestroyPipeline(_device, scenePipeline, nullptr);
-
-
-		vkDestroyPipelineLayout(_device, shadowPipeLayout, nullptr);
-		vkDestroyPipelineLayout(_device, scenePipeLayout, nullptr);
-		});
-
-	if (!load_compute_shader("shaders/compute_culling.comp.spv"))
-	{
-		std::cout << "Error when building the culling shader module" << std::endl;
-	}
-}
-
-bool VulkanEngine::load_compute_shader(const char* shaderPath)
-{
-	VkShaderModule computeModule;
-	if (!load_shader_module(shaderPath, &computeModule))
-
-	{
-		std::cout << "Error when building compute shader shader module" << std::endl;
-		return false;
-	}
-
-	VkPipelineLayoutCreateInfo compute_pipeline_layout_info = vkinit::pipeline_layout_create_info();
-
-	VkPushConstantRange push_constant;
-	push_constant.offset = 0;
-	push_constant.size = sizeof(CullConstants);
-	push_constant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-	VkDescriptorSetLayout setLayouts[] = { _cullSetLayout };
-	compute_pipeline_layout_info.setLayoutCount = 1;
-	compute_pipeline_layout_info.pSetLayouts = setLayouts;
-	compute_pipeline_layout_info.pPushConstantRanges = &push_constant;
-	compute_pipeline_layout_info.pushConstantRangeCount = 1;
-
-	VkPipelineLayout computePipeLayout;
-	VK_CHECK(vkCreatePipelineLayout(_device, &compute_pipeline_layout_info, nullptr, &computePipeLayout));
-
-	ComputePipelineBuilder computeBuilder;
-
-	computeBuilder._pipelineLayout = computePipeLayout;
-	computeBuilder._shaderStage = vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_COMPUTE_BIT, computeModule);
-
-	VkPipeline computePipeline = computeBuilder.build_pipeline(_device);
-
-	create_material(computePipeline, computePipeLayout, "culling");
-
-	vkDestroyShaderModule(_device, computeModule, nullptr);
-
-	_mainDeletionQueue.push_function([=]() {
-		vkDestroyPipeline(_device, computePipeline, nullptr);
-
-		vkDestroyPipelineLayout(_device, computePipeLayout, nullptr);
-		});
-
-	return true;
-}
-
-bool VulkanEngine::load_shader_module(const char* filePath, VkShaderModule* outShaderModule)
-{
-	std::ifstream file(filePath, std::ios::ate | std::ios::binary);
-
-	if (!file.is_open()) {
-		return false;
-	}
-
-	size_t fileSize = (size_t)file.tellg();
-
-	std::vector<uint32_t> buffer(fileSize / sizeof(uint32_t));
-
-	file.seekg(0);
-
-	file.read((char*)buffer.data(), fileSize);
-
-	file.close();
-
-	VkShaderModuleCreateInfo createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.pNext = nullptr;
-
-	createInfo.codeSize = buffer.size() * sizeof(uint32_t);
-	createInfo.pCode = buffer.data();
-
-	VkShaderModule shaderModule;
-	if (vkCreateShaderModule(_device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-		return false;
-	}
-	*outShaderModule = shaderModule;
-	return true;
-}
-
-VkPipeline ComputePipelineBuilder::build_pipeline(VkDevice device)
-{
-
-	VkComputePipelineCreateInfo pipelineInfo{};
-	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-	pipelineInfo.layout = _pipelineLayout;
-	pipelineInfo.stage = _shaderStage;
-
-	VkPipeline newPipeline;
-	if (vkCreateComputePipelines(
-		device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &newPipeline) != VK_SUCCESS) {
-		std::cout << "failed to create pipline\n";
-		return VK_NULL_HANDLE;
-	}
-	else
-	{
-		return newPipeline;
-	}
-}
-
-VkPipeline PipelineBuilder::build_pipeline(VkDevice device, VkRenderPass pass)
-{
-
-	VkPipelineViewportStateCreateInfo viewportState = {};
-	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportState.pNext = nullptr;
-
-	viewportState.viewportCount = 1;
-	viewportState.pViewports = &_viewport;
-	viewportState.scissorCount = 1;
-	viewportState.pScissors = &_scissor;
-
-	VkPipelineColorBlendStateCreateInfo colorBlending = {};
-	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	colorBlending.pNext = nullptr;
-
-	colorBlending.logicOpEnable = VK_FALSE;
-	colorBlending.logicOp = VK_LOGIC_OP_COPY;
-	colorBlending.attachmentCount = 1;
-	colorBlending.pAttachments = &_colorBlendAttachment[0];
-
-	VkGraphicsPipelineCreateInfo pipelineInfo = {};
-	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.pNext = nullptr;
-
-	pipelineInfo.stageCount = _shaderStages.size();
-	pipelineInfo.pStages = _shaderStages.data();
-	pipelineInfo.pVertexInputState = &_vertexInputInfo;
-	pipelineInfo.pInputAssemblyState = &_inputAssembly;
-	pipelineInfo.pViewportState = &viewportState;
-	pipelineInfo.pRasterizationState = &_rasterizer;
-	pipelineInfo.pMultisampleState = &_multisampling;
-	pipelineInfo.pColorBlendState = &colorBlending;
-	pipelineInfo.pDepthStencilState = &_depthStencil;
-	pipelineInfo.layout = _pipelineLayout;
-	pipelineInfo.renderPass = pass;
-	pipelineInfo.subpass = 0;
-	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-
-	VkPipeline newPipeline;
-	if (vkCreateGraphicsPipelines(
-		device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &newPipeline) != VK_SUCCESS) {
-		std::cout << "failed to create pipline\n";
-		return VK_NULL_HANDLE; 
-	}
-	else
-	{
-		return newPipeline;
-	}
-}
-
-VkPipeline PipelineBuilder::build_pipeline(VkDevice device, VkRenderPass pass, int size)
-{
-
-	VkPipelineViewportStateCreateInfo viewportState = {};
-	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportState.pNext = nullptr;
-
-	viewportState.viewportCount = 1;
-	viewportState.pViewports = &_viewport;
-	viewportState.scissorCount = 1;
-	viewportState.pScissors = &_scissor;
-
-	VkPipelineColorBlendStateCreateInfo colorBlending = {};
-	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	colorBlending.pNext = nullptr;
-
-	colorBlending.logicOpEnable = VK_FALSE;
-	colorBlending.logicOp = VK_LOGIC_OP_COPY;
-	colorBlending.attachmentCount = size;
-	colorBlending.pAttachments = &_colorBlendAttachment[0];
-
-	VkGraphicsPipelineCreateInfo pipelineInfo = {};
-	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.pNext = nullptr;
-
-	pipelineInfo.stageCount = _shaderStages.size();
-	pipelineInfo.pStages = _shaderStages.data();
-	pipelineInfo.pVertexInputState = &_vertexInputInfo;
-	pipelineInfo.pInputAssemblyState = &_inputAssembly;
-	pipelineInfo.pViewportState = &viewportState;
-	pipelineInfo.pRasterizationState = &_rasterizer;
-	pipelineInfo.pMultisampleState = &_multisampling;
-	pipelineInfo.pColorBlendState = &colorBlending;
-	pipelineInfo.pDepthStencilState = &_depthStencil;
-	pipelineInfo.layout = _pipelineLayout;
-	pipelineInfo.renderPass = pass;
-	pipelineInfo.subpass = 0;
-	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-
-	VkPipeline newPipeline;
-	if (vkCreateGraphicsPipelines(
-		device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &newPipeline) != VK_SUCCESS) {
-		std::cout << "failed to create pipline\n";
-		return VK_NULL_HANDLE;
-	}
-	else
-	{
-		return newPipeline;
-	}
-}
-
-void VulkanEngine::load_meshes()
-{
-	Mesh skyboxFront{};
-
-	skyboxFront._vertices.resize(6);
-	skyboxFront._vertices[0].position = { -200.f, -200.f, -200.0f };
-	skyboxFront._vertices[1].position = { 200.f,-200.f, -200.0f };
-	skyboxFront._vertices[2].position = { -200.f, 200.f, -200.0f };
-
-	skyboxFront._vertices[0].uv = { 1.0f, 1.0f };
-	skyboxFront._vertices[1].uv = { 0.0f, 1.0f };
-	skyboxFront._vertices[2].uv = { 1.0f, 0.0f };
-
-	skyboxFront._vertices[0].color = { 1.f,1.f, 1.0f };
-	skyboxFront._vertices[1].color = { 1.f,1.f, 1.0f };
-	skyboxFront._vertices[2].color = { 1.f,1.f, 1.0f };
-
-	skyboxFront._vertices[3].position = { -200.f, 200.f, -200.0f };
-	skyboxFront._vertices[4].position = { 200.f,-200.f, -200.0f };
-	skyboxFront._vertices[5].position = { 200.f, 200.f, -200.0f };
-
-	skyboxFront._vertices[3].uv = { 1.0f, 0.0f };
-	skyboxFront._vertices[4].uv = { 0.0f, 1.0f };
-	skyboxFront._vertices[5].uv = { 0.0f, 0.0f };
-
-	skyboxFront._vertices[3].color = { 1.0f,1.0f, 1.0f };
-	skyboxFront._vertices[4].color = { 1.0f,1.0f, 1.0f };
-	skyboxFront._vertices[5].color = { 1.0f,1.0f, 1.0f };
-
-	skyboxFront.sphereBound = { glm::vec3{0.0,0.0,200.0},glm::sqrt(200.0f * 200.0f * 2.0f) };
-	for (uint32_t i = 0; i < 6; i++) {
-		glm::mat4 rotationMat = glm::rotate(glm::mat4(1.0f), glm::radians(210.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		skyboxFront._vertices[i].position = glm::vec3(rotationMat * glm::vec4(skyboxFront._vertices[i].position, 1.0f));
-		skyboxFront.sphereBound = { glm::vec3(rotationMat * glm::vec4(0.0,0.0,200.0,0.0f)),glm::sqrt(200.0f * 200.0f * 2.0f) };
-
-		skyboxFront._vertices[i].color = { 1.0f,1.0f, 1.0f };
-		skyboxFront._vertices[i].uv = skyboxFront._vertices[i].uv;
-	}
-
-	//left
-	Mesh skyboxLeft{};
-	skyboxLeft._vertices.resize(6);
-	for (uint32_t i = 0; i < 6; i++) {
-		glm::mat4 rotationMat = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		skyboxLeft._vertices[i].position = glm::vec3(rotationMat * glm::vec4(skyboxFront._vertices[i].position,1.0f));
-		skyboxLeft.sphereBound = { glm::vec3(rotationMat * glm::vec4(glm::vec3(skyboxFront.sphereBound),1.0f)),glm::sqrt(200.0f * 200.0f * 2.0f) };
-
-		skyboxLeft._vertices[i].color = { 1.0f,1.0f, 1.0f };
-		skyboxLeft._vertices[i].uv = skyboxFront._vertices[i].uv;
-	}
-	//right
-	Mesh skyboxRight{};
-	skyboxRight._vertices.resize(6);
-	for (uint32_t i = 0; i < 6; i++) {
-		glm::mat4 rotationMat = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		skyboxRight._vertices[i].position = glm::vec3(rotationMat * glm::vec4(skyboxFront._vertices[i].position, 1.0f));
-		skyboxRight.sphereBound = { glm::vec3(rotationMat * glm::vec4(glm::vec3(skyboxFront.sphereBound),1.0f)),glm::sqrt(200.0f * 200.0f * 2.0f) };
-
-		skyboxRight._vertices[i].color = { 1.0f,1.0f, 1.0f };
-		skyboxRight._vertices[i].uv = skyboxFront._vertices[i].uv;
-	}
-	//back
-	Mesh skyboxBack{};
-	skyboxBack._vertices.resize(6);
-	for (uint32_t i = 0; i < 6; i++) {
-		glm::mat4 rotationMat = glm::rotate(glm::mat4(1.0f), glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		skyboxBack._vertices[i].position = glm::vec3(rotationMat * glm::vec4(skyboxFront._vertices[i].position, 1.0f));
-		skyboxBack.sphereBound = { glm::vec3(rotationMat * glm::vec4(glm::vec3(skyboxFront.sphereBound),1.0f)),glm::sqrt(200.0f * 200.0f * 2.0f) };
-
-		skyboxBack._vertices[i].color = { 1.0f,1.0f, 1.0f };
-		skyboxBack._vertices[i].uv = skyboxFront._vertices[i].uv;
-	}
-	//top
-	Mesh skyboxTop{};
-	skyboxTop._vertices.resize(6);
-	for (uint32_t i = 0; i < 6; i++) {
-		glm::vec4 axis = glm::rotate(glm::mat4(1.0f), glm::radians(210.0f), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
-		glm::mat4 rotationMat = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(axis));
-		skyboxTop._vertices[i].position = glm::vec3(rotationMat * glm::vec4(skyboxFront._vertices[i].position, 1.0f));
-		skyboxTop.sphereBound = { glm::vec3(rotationMat * glm::vec4(glm::vec3(skyboxFront.sphereBound),1.0f)),glm::sqrt(200.0f * 200.0f * 2.0f) };
-
-		skyboxTop._vertices[i].color = { 1.0f,1.0f, 1.0f };
-		skyboxTop._vertices[i].uv = skyboxFront._vertices[i].uv;
-	}
-
-	
-	upload_mesh(skyboxFront);
-	_meshes["front"] = skyboxFront;
-	upload_mesh(skyboxLeft);
-	_meshes["left"] = skyboxLeft;
-	upload_mesh(skyboxRight);
-	_meshes["right"] = skyboxRight;
-	upload_mesh(skyboxBack);
-	_meshes["back"] = skyboxBack;
-	upload_mesh(skyboxTop);
-	_meshes["top"] = skyboxTop;
-
-	Mesh floor{};
-	floor._vertices.resize(6);
-
-	floor._vertices[0].position = { 50.f, -0.1f, -50.0f };
-	floor._vertices[1].position = { -50.f, -0.1f, -50.0f };
-	floor._vertices[2].position = { 50.f, -0.1f, 50.0f };
-
-	floor._vertices[0].uv = { 0.0f, 0.05f };
-	floor._vertices[1].uv = { 0.05f, 0.05f };
-	floor._vertices[2].uv = { 0.0f, 0.0f };
-
-	floor._vertices[0].normal = { 0.f,1.f, 0.0f };
-	floor._vertices[1].normal = { 0.f,1.f, 0.0f };
-	floor._vertices[2].normal = { 0.f,1.f, 0.0f };
-
-	floor._vertices[0].color = { 1.f,1.f, 1.0f };
-	floor._vertices[1].color = { 1.f,1.f, 1.0f };
-	floor._vertices[2].color = { 1.f,1.f, 1.0f };
-
-	floor._vertices[3].position = { 50.f, -0.1f, 50.0f };
-	floor._vertices[4].position = { -50.f,-0.1f, -50.0f };
-	floor._vertices[5].position = { -50.f, -0.1f, 50.0f };
-
-	floor._vertices[3].uv = { 0.0f, 0.0f };
-	floor._vertices[4].uv = { 0.05f, 0.05f };
-	floor._vertices[5].uv = { 0.05f, 0.0f };
-
-	floor._vertices[3].normal = { 0.f,1.f, 0.0f };
-	floor._vertices[4].normal = { 0.f,1.f, 0.0f };
-	floor._vertices[5].normal = { 0.f,1.f, 0.0f };
-
-	floor._vertices[3].color = { 1.0f,1.0f, 1.0f };
-	floor._vertices[4].color = { 1.0f,1.0f, 1.0f };
-	floor._vertices[5].color = { 1.0f,1.0f, 1.0f };
-
-	floor.sphereBound = { glm::vec3{0.0f,-0.1f,0.0f},glm::sqrt(100.0f * 100.0f * 2.0f) };
-
-	upload_mesh(floor);
-	_meshes["floor"] = floor;
-	
-	Meshes nyCity{};
-	nyCity.load_from_obj("./assets/NY_City/City Block OBJ/City block.obj");
-
-	for (auto m : nyCity._meshes) {
-		upload_mesh(m);
-		_meshes[m.name] = m;
-	}
-}
-
-void VulkanEngine::load_images()
-{
-
-	
-	for (int i = 0; i < TEXTURE_PATHS.size(); i++) {
-
-		Texture tex;
-
-		vkutil::load_image_from_file(*this, TEXTURE_PATHS[i], tex.image);
-
-		VkImageViewCreateInfo imageinfo = vkinit::imageview_create_info(VK_FORMAT_R8G8B8A8_SRGB, tex.image._image, VK_IMAGE_ASPECT_COLOR_BIT, tex.image._mipLevels);
-		vkCreateImageView(_device, &imageinfo, nullptr, &tex.imageView);
-
-		_mainDeletionQueue.push_function([=]() {
-			vkDestroyImageView(_device, tex.imageView, nullptr);
-			});
-
-		_loadedTextures[TEXTURE_NAMES[i]] = tex;
-	}
-}
-
-void VulkanEngine::upload_mesh(Mesh& mesh)
-{
-	const size_t bufferSize = mesh._vertices.size() * sizeof(Vertex);
-	VkBufferCreateInfo stagingBufferInfo = {};
-	stagingBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	stagingBufferInfo.pNext = nullptr;
-	stagingBufferInfo.size = bufferSize;
-
-	stagingBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-
-	VmaAllocationCreateInfo vmaallocInfo = {};
-	vmaallocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
-
-	AllocatedBuffer stagingBuffer;
-
-	VK_CHECK(vmaCreateBuffer(_allocator, &stagingBufferInfo, &vmaallocInfo,
-		&stagingBuffer._buffer,
-		&stagingBuffer._allocation,
-		nullptr));
-
-	void* data;
-	vmaMapMemory(_allocator, stagingBuffer._allocation, &data);
-
-	memcpy(data, mesh._vertices.data(), mesh._vertices.size() * sizeof(Vertex));
-
-	vmaUnmapMemory(_allocator, stagingBuffer._allocation);
-
-	VkBufferCreateInfo vertexBufferInfo = {};
-	vertexBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	vertexBufferInfo.pNext = nullptr;
-	vertexBufferInfo.size = bufferSize;
-	vertexBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-
-	vmaallocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-
-	VK_CHECK(vmaCreateBuffer(_allocator, &vertexBufferInfo, &vmaallocInfo,
-		&mesh._vertexBuffer._buffer,
-		&mesh._vertexBuffer._allocation,
-		nullptr));
-	_mainDeletionQueue.push_function([=]() {
-
-		vmaDestroyBuffer(_allocator, mesh._vertexBuffer._buffer, mesh._vertexBuffer._allocation);
-		});
-
-	immediate_submit([=](VkCommandBuffer cmd) {
-		VkBufferCopy copy;
-		copy.dstOffset = 0;
-		copy.srcOffset = 0;
-		copy.size = bufferSize;
-		vkCmdCopyBuffer(cmd, stagingBuffer._buffer, mesh._vertexBuffer._buffer, 1, &copy);
-		});
-
-	vmaDestroyBuffer(_allocator, stagingBuffer._buffer, stagingBuffer._allocation);
-}
-
-Material* VulkanEngine::create_material(VkPipeline pipeline, VkPipelineLayout layout, const std::string& name)
-{
-	Material mat;
-	mat.pipeline = pipeline;
-	mat.pipelineLayout = layout;
-	_materials[name] = mat;
-	return &_materials[name];
-}
-
-Material* VulkanEngine::get_material(const std::string& name)
-{
-	auto it = _materials.find(name);
-	if (it == _materials.end()) {
-		return nullptr;
-	}
-	else {
-		return &(*it).second;
-	}
-}
-
-
-Mesh* VulkanEngine::get_mesh(const std::string& name)
-{
-	auto it = _meshes.find(name);
-	if (it == _meshes.end()) {
-		return nullptr;
-	}
-	else {
-		return &(*it).second;
-	}
-}
-
-std::vector<IndirectBatch> VulkanEngine::compact_draws(RenderObject* objects, int count)
-{
-	std::vector<IndirectBatch> draws;
-
-	IndirectBatch firstDraw;
-	firstDraw.mesh = objects[0].mesh;
-	firstDraw.material = objects[0].material;
-	firstDraw.first = 0;
-	firstDraw.count = 1;
-
-	draws.push_back(firstDraw);
-
-	for (int i = 0; i < count; i++)
-	{
-		bool sameMesh = objects[i].mesh == draws.back().mesh;
-		bool sameMaterial = objects[i].material == draws.back().material;
-
-		if (sameMesh && sameMaterial)
-		{
-			draws.back().count++;
-		}
-		else
-		{
-			IndirectBatch newDraw;
-			newDraw.mesh = objects[i].mesh;
-			newDraw.material = objects[i].material;
-			newDraw.first = i;
-			newDraw.count = 1;
-
-			draws.push_back(newDraw);
-		}
-	}
-	return draws;
-};
-
-void VulkanEngine::execute_shadow_culling(VkCommandBuffer cmd, RenderObject* first, int count, int cascadesIndex)
-{
-	VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
-	VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
-
-	std::vector<IndirectBatch> draws = compact_draws(first, count);
-	int frameIndex = _frameNumber % FRAME_OVERLAP;
-
-	void* objectData;
-	vmaMapMemory(_allocator, get_current_frame().objectBuffer._allocation, &objectData);
-
-	GPUObjectData* objectSSBO = (GPUObjectData*)objectData;
-
-	for (int i = 0; i < count; i++)
-	{
-		RenderObject& object = first[i];
-		objectSSBO[i].modelMatrix = object.transformMatrix;
-		objectSSBO[i].sphereBound = object.mesh->sphereBound;
-	}
-
-	vmaUnmapMemory(_allocator, get_current_frame().objectBuffer._allocation);
-
-	void* instanceData;
-	vmaMapMemory(_allocator, get_current_frame().instanceBuffer._allocation, &instanceData);
-
-	GPUInstance* instanceSSBO = (GPUInstance*)instanceData;
-
-	for (int i = 0; i < count; i++)
-	{
-		instanceSSBO[i].objectID = i;
-	}
-	
-	vmaUnmapMemory(_allocator, get_current_frame().instanceBuffer._allocation);
-
-	void* indirectShadowData;
-	vmaMapMemory(_allocator, get_current_frame().indirectShadowBuffers[cascadesIndex]._allocation, &indirectShadowData);
-
-	VkDrawIndirectCommand* drawShadowCommands = (VkDrawIndirectCommand*)indirectShadowData;
-
-	for (int i = 0; i < count; i++)
-	{
-		RenderObject& object = first[i];
-		drawShadowCommands[i].vertexCount = object.mesh->_vertices.size();
-		drawShadowCommands[i].instanceCount = 1;
-		drawShadowCommands[i].firstVertex = 0;
-		drawShadowCommands[i].firstInstance = i;
-	}
-
-	vmaUnmapMemory(_allocator, get_current_frame().indirectShadowBuffers[cascadesIndex]._allocation);
-
-	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, get_material("culling")->pipeline);
-
-	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, get_material("culling")->pipelineLayout, 0, 1, &get_current_frame().cullCascadeDescriptors[cascadesIndex], 0, nullptr);
-
-	glm::vec3 verticalNormal = { 0.0f, 1.0f, 0.0f };
-	glm::vec3 horizontalNormal = { 1.0f, 0.0f, 0.0f };
-	float yTopBottom = verticalNormal.y;
-	float zTopBottom = verticalNormal.z;
-	float xLeftRight = horizontalNormal.x;
-	float zLeftRight = horizontalNormal.z;
-
-	CullConstants constants;
-	constants.view = glm::lookAt(_lightPos, _lightFoc, glm::vec3(0.0f, 1.0f, 0.0f));
-	constants.frustum = { zLeftRight, xLeftRight, zTopBottom, yTopBottom };
-	constants.distance = get_current_frame().cascades[cascadesIndex].radius;
-	constants.zfar = 200.0f;
-	constants.znear = 0.5f;
-
-	vkCmdPushConstants(cmd, get_material("culling")->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
-
-	int groupcount = ((count) / 256) + 1;
-
-	vkCmdDispatch(cmd, groupcount, 1, 1);
-
-	VK_CHECK(vkEndCommandBuffer(cmd));
-}
-
-void VulkanEngine::execute_culling(VkCommandBuffer cmd, RenderObject* first, int count)
-{
-	VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
-	VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
-
-	void* indirectData;
-	vmaMapMemory(_allocator, get_current_frame().indirectBuffer._allocation, &indirectData);
-
-	VkDrawIndirectCommand* drawCommands = (VkDrawIndirectCommand*)indirectData;
-
-	for (int i = 0; i < count; i++)
-	{
-		RenderObject& object = first[i];
-		drawCommands[i].vertexCount = object.mesh->_vertices.size();
-		drawCommands[i].instanceCount = 1;
-		drawCommands[i].firstVertex = 0;
-		drawCommands[i].firstInstance = i;
-	}
-
-	vmaUnmapMemory(_allocator, get_current_frame().indirectBuffer._allocation);
-
-	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, get_material("culling")->pipeline);
-
-	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, get_material("culling")->pipelineLayout, 0, 1, &get_current_frame().cullDescriptor, 0, nullptr);
-
-	glm::vec3 verticalNormal = { 0.0f, glm::cos(glm::radians(45.0f)), glm::sin(glm::radians(45.0f)) };
-	glm::vec3 horizontalNormal = glm::normalize(glm::vec3{ glm::cos(glm::radians(45.0f)),
-														   0.0f, 
-														   glm::sin(glm::radians(45.0f)) * _windowExtent.width / (float)_windowExtent.height });
-	float yTopBottom = verticalNormal.y;
-	float zTopBottom = verticalNormal.z;
-	float xLeftRight = horizontalNormal.x;
-	float zLeftRight = horizontalNormal.z;
-
-	CullConstants constants;
-	constants.view = glm::lookAt(_camera._camPos, _camera._foc, glm::vec3(0.0f, 1.0f, 0.0f));
-	constants.frustum = { zLeftRight, xLeftRight, zTopBottom, yTopBottom };
-	constants.distance = 0.0f;
-	constants.zfar = _camera.zFar;
-	constants.znear = _camera.zNear;
-
-	vkCmdPushConstants(cmd, get_material("culling")->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
-
-	int groupcount = ((count) / 256) + 1;
-
-	vkCmdDispatch(cmd, groupcount, 1, 1);
-
-	std::vector<VkBufferMemoryBarrier> barriers;
-	VkBufferMemoryBarrier barrier = vkinit::buffer_barrier(get_current_frame().indirectBuffer._buffer, _graphicsQueueFamily);
-	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-	barriers.push_back(barrier);
-
-	for (uint32_t i = 0; i < SHADOW_MAP_CASCADE_COUNT; i++) {
-		VkBufferMemoryBarrier barrier2 = vkinit::buffer_barrier(get_current_frame().indirectShadowBuffers[i]._buffer, _graphicsQueueFamily);
-		barrier2.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		barrier2.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-		barriers.push_back(barrier2);
-	}
-	
-
-	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 0, nullptr, barriers.size(), barriers.data(), 0, nullptr);
-
-	VK_CHECK(vkEndCommandBuffer(cmd));
-}
-
-void VulkanEngine::prepare_depthpass()
-{
-
-	VkAttachmentDescription depth_attachment = {};
-	depth_attachment.flags = 0;
-	depth_attachment.format = _depthFormat;
-	depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-
-	VkAttachmentReference depth_attachment_ref = {};
-	depth_attachment_ref.attachment = 0;
-	depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpass = {};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 0;
-	subpass.pDepthStencilAttachment = &depth_attachment_ref;
-
-	std::array<VkSubpassDependency, 2> dependencies;
-
-	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependencies[0].dstSubpass = 0;
-	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-	dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-	dependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependencies[1].dstSubpass = 0;
-	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-	dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-	VkRenderPassCreateInfo render_pass_info = {};
-	render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	render_pass_info.attachmentCount = 1;
-	render_pass_info.pAttachments = &depth_attachment;
-	render_pass_info.subpassCount = 1;
-	render_pass_info.pSubpasses = &subpass;
-	render_pass_info.dependencyCount = static_cast<uint32_t>(dependencies.size());
-	render_pass_info.pDependencies = &dependencies[0];
-
-	VK_CHECK(vkCreateRenderPass(_device, &render_pass_info, nullptr, &_depthPass));
-
-	_mainDeletionQueue.push_function([=]() {
-		vkDestroyRenderPass(_device, _depthPass, nullptr);
-		});
-
-	VkExtent3D shadowExtent = {
-		_shadowExtent.width,
-		_shadowExtent.height,
-		1
-	};
-
-	VmaAllocationCreateInfo img_allocinfo = {};
-	img_allocinfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-	img_allocinfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	VkImageCreateInfo img_shadow_info = vkinit::image_create_info(_depthFormat, SHADOW_MAP_CASCADE_COUNT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, shadowExtent, VK_SAMPLE_COUNT_1_BIT,1);
-
-	vmaCreateImage(_allocator, &img_shadow_info, &img_allocinfo, &_depth._image, &_depth._allocation, nullptr);
-
-	VkImageViewCreateInfo viewInfo = vkinit::imageview_create_info(_depthFormat, _depth._image, VK_IMAGE_ASPECT_DEPTH_BIT,1);
-	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
-	viewInfo.subresourceRange.baseMipLevel = 0;
-	viewInfo.subresourceRange.levelCount = 1;
-	viewInfo.subresourceRange.baseArrayLayer = 0;
-	viewInfo.subresourceRange.layerCount = SHADOW_MAP_CASCADE_COUNT;
-
-	VK_CHECK(vkCreateImageView(_device, &viewInfo, nullptr, &_depthView));
-
-	for (int i = 0; i < FRAME_OVERLAP; i++)
-	{
-		for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
-
-			VkImageViewCreateInfo viewInfo = vkinit::imageview_create_info(_depthFormat, _depth._image, VK_IMAGE_ASPECT_DEPTH_BIT,1);
-			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
-			viewInfo.subresourceRange.baseMipLevel = 0;
-			viewInfo.subresourceRange.levelCount = 1;
-			viewInfo.subresourceRange.baseArrayLayer = j;
-			viewInfo.subresourceRange.layerCount = 1;
-
-			VK_CHECK(vkCreateImageView(_device, &viewInfo, nullptr, &_frames[i].cascades[j].view));
-
-			VkFramebufferCreateInfo framebufferInfo = vkinit::framebuffer_create_info(_depthPass, _shadowExtent);
-			framebufferInfo.renderPass = _depthPass;
-			framebufferInfo.attachmentCount = 1;
-			framebufferInfo.pAttachments = &_frames[i].cascades[j].view;
-			framebufferInfo.layers = 1;
-			VK_CHECK(vkCreateFramebuffer(_device, &framebufferInfo, nullptr, &_frames[i].cascades[j].frameBuffer));
-		
-
-			_mainDeletionQueue.push_function([=]() {
-				
-				vkDestroyImageView(_device, _frames[i].cascades[j].view, nullptr);
-				vkDestroyFramebuffer(_device, _frames[i].cascades[j].frameBuffer, nullptr);
-				
-				});
-		}
-
-	}
-	_mainDeletionQueue.push_function([=]() {
-
-		vkDestroyImageView(_device, _depthView, nullptr);
-		vmaDestroyImage(_allocator, _depth._image, _depth._allocation);
-
-		});	
-
-}
-
-void VulkanEngine::update_descriptors( RenderObject* first, int count)
-{
-
-	float cascadeSplits[SHADOW_MAP_CASCADE_COUNT];
-
-	void* objectData;
-	vmaMapMemory(_allocator, get_current_frame().objectBuffer._allocation, &objectData);
-
-	GPUObjectData* objectSSBO = (GPUObjectData*)objectData;
-
-	for (int i = 0; i < count; i++)
-	{
-		RenderObject& object = first[i];
-		objectSSBO[i].modelMatrix = object.transformMatrix;
-		objectSSBO[i].sphereBound = object.mesh->sphereBound;
-	}
-
-	vmaUnmapMemory(_allocator, get_current_frame().objectBuffer._allocation);
-	static auto startTime = std::chrono::high_resolution_clock::now();
-
-	auto currentTime = std::chrono::high_resolution_clock::now();
-	float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
-
-	_sceneParameters.lightColor = { 3.0,3.0,3.0 };
-	_sceneParameters.lightDir = glm::normalize(glm::vec4{ -0.3, 1.0, 1.0, 0.0 });
-	_sceneParameters.zNear = 0.1f;
-	_sceneParameters.zFar = 200.0f;
-
-	_camera.zNear = 0.5f;
-	_camera.zFar = 120.0f;
-
-	char* sceneData;
-	vmaMapMemory(_allocator, _sceneParameterBuffer._allocation, (void**)&sceneData);
-
-	int frameIndex = _frameNumber % FRAME_OVERLAP;
-
-	sceneData += pad_uniform_buffer_size(sizeof(GPUSceneData)) * frameIndex;
-
-	memcpy(sceneData, &_sceneParameters, sizeof(GPUSceneData));
-
-	vmaUnmapMemory(_allocator, _sceneParameterBuffer._allocation);
-
-	glm::mat4 clip = glm::mat4(1.0f, 0.0f, 0.0f, 0.0f,
-		0.0f, -1.0f, 0.0f, 0.0f,
-		0.0f, 0.0f, 0.5f, 0.0f,
-		0.0f, 0.0f, 0.5f, 1.0f);
-
-	glm::mat4 view = glm::lookAt(_camera._camPos, _camera._foc, glm::vec3(0.0f, 1.0f, 0.0f));
-	glm::mat4 projection = glm::perspective(glm::radians(45.0f), _windowExtent.width / (float)_windowExtent.height, 0.5f, 120.0f);
-	projection[1][1] *= -1;
-	glm::mat4 viewProjMat = projection * view;
-	
-	void* data;
-
-	GPUCameraData camData;
-	camData.pos = _camera._camPos;
-	camData.viewproj = viewProjMat;
-	camData.view = view;
-
-	vmaMapMemory(_allocator, get_current_frame().cameraBuffer._allocation, &data);
-
-	memcpy(data, &camData, sizeof(GPUCameraData));
-
-	vmaUnmapMemory(_allocator, get_current_frame().cameraBuffer._allocation);
-
-	void* skyboxData;
-
-	glm::mat4 skyboxView = glm::mat4(glm::mat3(view)); 
-	glm::mat4 skyboxProj = glm::perspective(glm::radians(45.0f), _windowExtent.width / (float)_windowExtent.height, 0.5f, 120.0f);
-	skyboxProj[1][1] *= -1;
-	GPUCameraData skybox;
-	skybox.pos = _camera._camPos;
-	skybox.viewproj = skyboxProj * skyboxView;
-	skybox.view = skyboxView;
-
-	vmaMapMemory(_allocator, get_current_frame().skyboxBuffer._allocation, &skyboxData);
-
-	memcpy(skyboxData, &skybox, sizeof(GPUCameraData));
-
-	vmaUnmapMemory(_allocator, get_current_frame().skyboxBuffer._allocation);
-
-	float nearClip = _camera.zNear;
-	float farClip = _camera.zFar;
-	float clipRange = farClip - nearClip;
-
-	float minZ = nearClip;
-	float maxZ = nearClip + clipRange;
-	float range = maxZ - minZ;
-	float ratio = maxZ / minZ;
-
-	float cascadeSplitLambda = 0.8f;
-	for (uint32_t i = 0; i < SHADOW_MAP_CASCADE_COUNT; i++) {
-		float p = (i + 1) / static_cast<float>(SHADOW_MAP_CASCADE_COUNT);
-		float log = minZ * std::pow(ratio, p);
-		float uniform = minZ + range * p;
-		float d = cascadeSplitLambda * (log - uniform) + uniform;
-		cascadeSplits[i] = (d - nearClip) / clipRange;
-	}
-
-	float lastSplitDist = 0.0;
-	for (uint32_t i = 0; i < SHADOW_MAP_CASCADE_COUNT; i++) {
-		float splitDist = cascadeSplits[i];
-
-		glm::vec3 frustumCorners[8] = {
-			glm::vec3(-1.0f,  1.0f, 0.0f),
-			glm::vec3(1.0f,  1.0f, 0.0f),
-			glm::vec3(1.0f, -1.0f, 0.0f),
-			glm::vec3(-1.0f, -1.0f, 0.0f),
-			glm::vec3(-1.0f,  1.0f,  1.0f),
-			glm::vec3(1.0f,  1.0f,  1.0f),
-			glm::vec3(1.0f, -1.0f,  1.0f),
-			glm::vec3(-1.0f, -1.0f,  1.0f),
-		};
-
-
-		glm::mat4 invCam = glm::inverse(projection * view);
-		for (uint32_t j = 0; j < 8; j++) {
-			glm::vec4 invCorner = invCam * glm::vec4(frustumCorners[j], 1.0f);
-			frustumCorners[j] = invCorner / invCorner.w;
-		}
-
-		for (uint32_t j = 0; j < 4; j++) {
-			glm::vec3 dist = frustumCorners[j + 4] - frustumCorners[j];
-			frustumCorners[j + 4] = frustumCorners[j] + (dist * splitDist);
-			frustumCorners[j] = frustumCorners[j] + (dist * lastSplitDist);
-		}
-
-		glm::vec3 frustumCenter = glm::vec3(0.0f);
-		for (uint32_t j = 0; j < 8; j++) {
-			frustumCenter += frustumCorners[j];
-		}
-		frustumCenter /= 8.0f;
-
-		float radius = 0.0f;
-		for (uint32_t j = 0; j < 8; j++) {
-			float distance = glm::length(frustumCorners[j] - frustumCenter);
-			radius = glm::max(radius, distance);
-		}
-
-
-		glm::vec3 maxExtents = glm::vec3(radius);
-		glm::vec3 minExtents = -maxExtents;
-
-		glm::mat4 lightViewMatrix = glm::lookAt(frustumCenter + _sceneParameters.lightDir * (maxExtents + 40.0f), frustumCenter, glm::vec3(0.0f, 1.0f, 0.0f));
-		glm::mat4 lightOrthoMatrix = glm::ortho(minExtents.x, maxExtents.x,  maxExtents.y, minExtents.y, 0.0f, maxExtents.z*2.0f+80.0f);
-
-		glm::mat4 shadowMatrix = lightOrthoMatrix * lightViewMatrix;
-		glm::vec4 shadowOrigin = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-		shadowOrigin = shadowMatrix * shadowOrigin;
-		shadowOrigin = shadowOrigin * (float)_shadowExtent.height / 2.0f;
-
-		glm::vec4 roundedOrigin = glm::round(shadowOrigin);
-		glm::vec4 roundOffset = roundedOrigin - shadowOrigin;
-		roundOffset = roundOffset * 2.0f / (float)_shadowExtent.height;
-		roundOffset.z = 0.0f;
-		roundOffset.w = 0.0f;
-
-		glm::mat4 shadowProj = lightOrthoMatrix;
-		shadowProj[3] += roundOffset;
-		lightOrthoMatrix = shadowProj;
-
-		get_current_frame().cascades[i].radius = radius;
-		get_current_frame().cascades[i].splitDepth = (_camera.zNear + splitDist * clipRange) * -1.0f;
-		get_current_frame().cascades[i].viewProjMatrix = lightOrthoMatrix * lightViewMatrix;
-
-		lastSplitDist = cascadeSplits[i];
-
-		void* cascadeData;
-		GPUCameraData lightData;
-		lightData.pos = frustumCenter - _sceneParameters.lightDir * minExtents.z;
-		lightData.viewproj = lightOrthoMatrix * lightViewMatrix;
-		lightData.view = lightViewMatrix;
-
-		vmaMapMemory(_allocator, get_current_frame().cascadesBuffers[i]._allocation, &cascadeData);
-
-		memcpy(cascadeData, &lightData, sizeof(GPUCameraData));
-
-		vmaUnmapMemory(_allocator, get_current_frame().cascadesBuffers[i]._allocation);
-	}
-
-	void* cascadesSetData;
-	CascadesSet cascadesSet;
-	for (uint32_t i = 0; i < SHADOW_MAP_CASCADE_COUNT; i++) {
-		uint32_t rowIndex = i / 4;
-		uint32_t colIndex = i % 4;
-		cascadesSet.cascadeSplits[rowIndex][colIndex] = get_current_frame().cascades[i].splitDepth;
-		cascadesSet.cascadeViewProjMat[i] = get_current_frame().cascades[i].viewProjMatrix;
-		cascadesSet.cascadeSizes[rowIndex][colIndex] = std::pow(2.0f * get_current_frame().cascades[i].radius, 2.0f);
-	}
-	
-	vmaMapMemory(_allocator, get_current_frame().cascadesSetBuffer._allocation, &cascadesSetData);
-
-	memcpy(cascadesSetData, &cascadesSet, sizeof(CascadesSet));
-
-	vmaUnmapMemory(_allocator, get_current_frame().cascadesSetBuffer._allocation);
-}
-
-
-void VulkanEngine::update_csm(VkCommandBuffer cmd, RenderObject* first, int count, int cascadesIndex)
-{
-
-	int frameIndex = _frameNumber % FRAME_OVERLAP;
-
-	std::vector<IndirectBatch> draws = compact_draws(first, count);
-
-	VkPipeline pipeline = get_material("directDepth")->pipeline;
-	VkPipelineLayout pipeline_layout = get_material("directDepth")->pipelineLayout;
-
-	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-
-	uint32_t uniform_offset = pad_uniform_buffer_size(sizeof(GPUSceneData)) * frameIndex;
-
-	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &get_current_frame().cascades[cascadesIndex].descriptorSet, 1, &uniform_offset);
-
-	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 1, 1, &get_current_frame().objectDescriptor, 0, nullptr);
-
-	for (IndirectBatch& draw : draws)
-	{
-		VkDeviceSize offset = 0;
-		vkCmdBindVertexBuffers(cmd, 0, 1, &draw.mesh->_vertexBuffer._buffer, &offset);
-
-		VkDeviceSize indirect_offset = draw.first * sizeof(VkDrawIndirectCommand);
-		uint32_t draw_stride = sizeof(VkDrawIndirectCommand);
-
-		vkCmdDrawIndirect(cmd, get_current_frame().indirectShadowBuffers[cascadesIndex]._buffer, indirect_offset, draw.count, draw_stride);
-	}
-}
-
-void VulkanEngine::draw_gbuffer(VkCommandBuffer cmd, RenderObject* first, int count)
-{
-	int frameIndex = _frameNumber % FRAME_OVERLAP;
-
-	std::vector<IndirectBatch> draws = compact_draws(first, count);
-
-	for (IndirectBatch& draw : draws)
-	{
-		VkPipelineLayout layout;
-		VkPipeline pipeline;
-		if (draw.material->textureSet != VK_NULL_HANDLE) {
-			layout = get_material("gbuffer")->pipelineLayout;
-			pipeline = get_material("gbuffer")->pipeline;
-		}
-		else {
-			layout = get_material("gbufferTextured")->pipelineLayout;
-			pipeline = get_material("gbufferTextured")->pipeline;
-		}
-
-		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-
-		uint32_t uniform_offset = pad_uniform_buffer_size(sizeof(GPUSceneData)) * frameIndex;
-
-		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &get_current_frame().globalDescriptor, 0, nullptr);
-
-		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 1, 1, &get_current_frame().lightDescriptor, 1, &uniform_offset);
-
-		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 2, 1, &get_current_frame().objectDescriptor, 0, nullptr);
-
-		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 3, 1, &get_current_frame()._csmSet, 0, nullptr);
-
-		if (draw.material->textureSet != VK_NULL_HANDLE) {
-			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 4, 1, &draw.material->textureSet, 0, nullptr);
-		}
-
-		VkDeviceSize offset = 0;
-		vkCmdBindVertexBuffers(cmd, 0, 1, &draw.mesh->_vertexBuffer._buffer, &offset);
-
-		VkDeviceSize indirect_offset = draw.first * sizeof(VkDrawIndirectCommand);
-		uint32_t draw_stride = sizeof(VkDrawIndirectCommand);
-
-		vkCmdDrawIndirect(cmd, get_current_frame().indirectBuffer._buffer, indirect_offset, draw.count, draw_stride);
-	}
-}
-
-
-void VulkanEngine::draw_objects(VkCommandBuffer cmd, RenderObject* first, int count)
-{
-	int frameIndex = _frameNumber % FRAME_OVERLAP;
-
-	std::vector<IndirectBatch> draws = compact_draws(first, count);
-
-	for (IndirectBatch& draw : draws)
-	{
-		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.material->pipeline);
-
-		uint32_t uniform_offset = pad_uniform_buffer_size(sizeof(GPUSceneData)) * frameIndex;
-		
-		if (draw.material->pipeline == get_material("Front")->pipeline) {
-			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.material->pipelineLayout, 0, 1, &get_current_frame().skyboxDescriptor, 0, nullptr);
-		}
-		else {
-			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.material->pipelineLayout, 0, 1, &get_current_frame().globalDescriptor, 0, nullptr);
-		}
-		
-
-		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.material->pipelineLayout, 1, 1, &get_current_frame().cascadesSetDescriptor, 1, &uniform_offset);
-
-		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.material->pipelineLayout, 2, 1, &get_current_frame().objectDescriptor, 0, nullptr);
-
-		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.material->pipelineLayout, 3, 1, &get_current_frame()._csmSet, 0, nullptr);
-
-		if (draw.material->textureSet != VK_NULL_HANDLE) {
-			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.material->pipelineLayout, 4, 1, &draw.material->textureSet, 0, nullptr);
-			
-		}	
-		
-
-		VkDeviceSize offset = 0;
-		vkCmdBindVertexBuffers(cmd, 0, 1, &draw.mesh->_vertexBuffer._buffer, &offset);
-
-		VkDeviceSize indirect_offset = draw.first * sizeof(VkDrawIndirectCommand);
-		uint32_t draw_stride = sizeof(VkDrawIndirectCommand);
-
-		vkCmdDrawIndirect(cmd, get_current_frame().indirectBuffer._buffer, indirect_offset, draw.count, draw_stride);
-	}
-	
-}
-
-
-void VulkanEngine::init_scene()
-{
-	
-
-	std::vector<std::string> nameVec = {
-	"Sidewalk_Plane",
-	"road_2_Plane.002",
-	"road_2.001_Plane.004",
-	"Cube.010_Cube.019",
-	"Cube.016_Cube.031",
-	"Cube.020_Cube.035",
-	"Cube.023_Cube.038",
-	"Building_1_Plane.006",
-	"Building_1.001_Plane.005",
-	"Building_2_Cube.001",
-	"Building_2.001_Cube.010",
-	"Building_3_Cube.022",
-	"Building_4_Cube.009",
-	"Building_4.001_Cube.013",
-	"Building_5_Cube.027",
-	"Building_6_Cube.008",
-	"Plane.005_Plane.017",
-	"Cube.003_Cube.004",
-	"Cube.005",
-	"Cube.004_Cube.051",
-	"Cube.009_Cube.021",
-	"Cube.011_Cube.024",
-	"Cube.012_Cube.025",
-	"Cube.013_Cube.026",
-	"Cube.014_Cube.029",
-	"Cube.015_Cube.030",
-	"Cube.017_Cube.032",
-	"Cube.018_Cube.033",
-	"Cube.019_Cube.034",
-	"Cube.021_Cube.036",
-	"Cube.022_Cube.037",
-	"floor",
-	"front",
-	"left",
-	"right",
-	"back",
-	"top"
-	};
-	
-
-	const std::unordered_map<std::string, std::string> texMap = {
-	{"Sidewalk_Plane", "Side walk" },
-		{"road_2_Plane.002","Center road"},
-		{"road_2.001_Plane.004", "Road"},
-		{"Cube.010_Cube.019", "Bark"},
-		{"Cube.016_Cube.031", "Bark"},
-		{"Cube.020_Cube.035", "Bark"},
-		{"Cube.023_Cube.038", "Bark"},
-		{"Cylinder_Cylinder.001", "Stop light"},
-		{"Cylinder.001_Cylinder.003", "Stop light"},
-		{"Building_1_Plane.006", "Building 1"},
-		{"Building_1.001_Plane.005", "Building 1"},
-		{"Building_2_Cube.001", "Building 2"},
-		{"Building_2.001_Cube.010","Building 2"},
-		{"Building_3_Cube.022", "Building 3"},
-		{"Building_4_Cube.009", "Building 4"},
-		{"Building_4.001_Cube.013", "Building 4"},
-		{"Building_5_Cube.027", "Building 5"},
-		{"Building_6_Cube.008", "Building 6"},
-		{"Plane.005_Plane.017", "Building 7"},
-		{"Cube.001", "Building 8"},
-		{"Cube.001_Cube.002", "Building 8"},
-		{"Cube.002_Cube.003", "Building 8"},
-		{"Cube.007_Cube.016", "Building 8"},
-		{"Cube.008_Cube.018", "Building 8"},
-		{"Cube.003_Cube.004", "Building 9"},
-		{"Cube.005", "Building 9"},
-		{"Cube.004_Cube.051", "Building 10"},
-		{"Cube.006_Cube.012", "Building 11"},
-		{"Cube.009_Cube.021", "Leaf 2"},
-		{"Cube.011_Cube.024", "Leaf 2"},
-		{"Cube.012_Cube.025", "Bark"},
-		{"Cube.013_Cube.026", "Leaf 2"},
-		{"Cube.014_Cube.029", "Leaf 2"},
-		{"Cube.015_Cube.030", "Bark"},
-		{"Cube.017_Cube.032", "Leaf 2"},
-		{"Cube.018_Cube.033", "Leaf 2"},
-		{"Cube.019_Cube.034", "Bark"},
-		{"Cube.021_Cube.036", "Leaf 2"},
-		{"Cube.022_Cube.037", "Bark"},
-		{"floor","Side walk"},
-		{"front","Front"},
-		{"left","Left"},
-		{"right","Right"},
-		{"back","Back"},
-		{"top","Top"}
-		
-	};
-
-	for (auto n : nameVec) {
-		RenderObject obj;
-		obj.mesh = get_mesh(n);
-		obj.material = get_material(texMap.at(n));
-		obj.transformMatrix = glm::mat4(1.0f);
-		_renderables.push_back(obj);
-	}
-	RenderObject obj1;
-	obj1.mesh = get_mesh("Building_5_Cube.027");
-	obj1.material = get_material(texMap.at("Building_5_Cube.027"));
-	obj1.transformMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(15.0f,0.0f, 0.0f));
-	_renderables.push_back(obj1);
-
-	RenderObject obj2;
-	obj2.mesh = get_mesh("Plane.005_Plane.017");
-	obj2.material = get_material(texMap.at("Plane.005_Plane.017"));
-	obj2.transformMatrix = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	_renderables.push_back(obj2);
-
-	RenderObject front;
-	front.mesh = get_mesh("front");
-	front.material = get_material("Front");
-	front.transformMatrix = glm::mat4(1.0f);
-	_renderables.push_back(front);
-
-	RenderObject left;
-	left.mesh = get_mesh("left");
-	left.material = get_material("Left");
-	left.transformMatrix = glm::mat4(1.0f);
-	_renderables.push_back(left);
-
-	RenderObject right;
-	right.mesh = get_mesh("right");
-	right.material = get_material("Right");
-	right.transformMatrix = glm::mat4(1.0f);
-	_renderables.push_back(right);
-
-	RenderObject back;
-	back.mesh = get_mesh("back");
-	back.material = get_material("Back");
-	back.transformMatrix = glm::mat4(1.0f);
-	_renderables.push_back(back);
-
-	RenderObject top;
-	top.mesh = get_mesh("top");
-	top.material = get_material("Top");
-	top.transformMatrix = glm::mat4(1.0f);
-	_renderables.push_back(top);
-
-	VkSamplerCreateInfo samplerInfo = vkinit::sampler_create_info(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
-	VkSamplerCreateInfo shadowSamplerInfo = vkinit::sampler_create_info(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
-	shadowSamplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-
-	VkSampler imgSampler;
-	vkCreateSampler(_device, &samplerInfo, nullptr, &imgSampler);
-
-	vkCreateSampler(_device, &shadowSamplerInfo, nullptr, &_shadowSampler);
-
-	_mainDeletionQueue.push_function([=]() {
-		vkDestroySampler(_device, imgSampler, nullptr);
-		vkDestroySampler(_device, _shadowSampler, nullptr);
-		});
-	
-
-
-	for (auto name : TEXTURE_NAMES) {
-		Material* texMat = get_material(name);
-		_descriptorAllocator->allocate(&texMat->textureSet, _singleTextureSetLayout);
-
-		VkDescriptorImageInfo imageBufferInfo;
-		imageBufferInfo.sampler = _loadedTextures[name].image._sampler;
-		imageBufferInfo.imageView = _loadedTextures[name].imageView;
-		imageBufferInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-		std::string skyboxs[] = {"Front","Left","Right","Back","Top"};
-		std::string* res = std::find(std::begin(skyboxs), std::end(skyboxs), name);
-
-		if (res != std::end(skyboxs)) {
-			imageBufferInfo.sampler = imgSampler;
-		}
-
-		vkutil::DescriptorBuilder::begin(_descriptorLayoutCache, _descriptorAllocator)
-			.bind_image(0, 1, &imageBufferInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-			.build(texMat->textureSet);
-	}
-
-	
-	VkDescriptorImageInfo csmBufferInfo;
-	
-	csmBufferInfo.sampler = _shadowSampler;
-	csmBufferInfo.imageView = _depthView;
-	csmBufferInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-	
-	for (int i = 0; i < FRAME_OVERLAP; i++) {
-		vkutil::DescriptorBuilder::begin(_descriptorLayoutCache, _descriptorAllocator)
-			.bind_image(0, 1, &csmBufferInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-			.build(_frames[i]._csmSet);
-	}
-
-}
-
-AllocatedBuffer VulkanEngine::create_buffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage)
-{
-	VkBufferCreateInfo bufferInfo = {};
-	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferInfo.pNext = nullptr;
-	bufferInfo.size = allocSize;
-
-	bufferInfo.usage = usage;
-
-	VmaAllocationCreateInfo vmaallocInfo = {};
-	vmaallocInfo.usage = memoryUsage;
-
-	AllocatedBuffer newBuffer;
-
-	VK_CHECK(vmaCreateBuffer(_allocator, &bufferInfo, &vmaallocInfo,
-		&newBuffer._buffer,
-		&newBuffer._allocation,
-		nullptr));
-
-	return newBuffer;
-}
-
-size_t VulkanEngine::pad_uniform_buffer_size(size_t originalSize)
-{
-	size_t minUboAlignment = _gpuProperties.limits.minUniformBufferOffsetAlignment;
-	size_t alignedSize = originalSize;
-	if (minUboAlignment > 0) {
-		alignedSize = (alignedSize + minUboAlignment - 1) & ~(minUboAlignment - 1);
-	}
-	return alignedSize;
-}
-
-void VulkanEngine::immediate_submit(std::function<void(VkCommandBuffer cmd)>&& function)
-{
-	VkCommandBuffer cmd = _uploadContext._commandBuffer;
-	VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
-	VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
-
-
-	function(cmd);
-
-
-	VK_CHECK(vkEndCommandBuffer(cmd));
-
-	VkSubmitInfo submit = vkinit::submit_info(&cmd);
-
-
-	VK_CHECK(vkQueueSubmit(_graphicsQueue, 1, &submit, _uploadContext._uploadFence));
-
-	vkWaitForFences(_device, 1, &_uploadContext._uploadFence, true, 9999999999);
-	vkResetFences(_device, 1, &_uploadContext._uploadFence);
-
-	vkResetCommandPool(_device, _uploadContext._commandPool, 0);
-}
-
-void VulkanEngine::init_descriptors()
-{
-
-	_descriptorAllocator = new vkutil::DescriptorAllocator{};
-	_descriptorAllocator->init(_device);
-
-	_descriptorLayoutCache = new vkutil::DescriptorLayoutCache{};
-	_descriptorLayoutCache->init(_device);
-
-
-	VkDescriptorSetLayoutBinding cameraBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0);
-	VkDescriptorSetLayoutBinding sceneBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 1);
-	VkDescriptorSetLayoutBinding bindings[] = { cameraBind,sceneBind };
-	
-
-	VkDescriptorSetLayoutCreateInfo setinfo = {};
-	setinfo.bindingCount = 1;
-	setinfo.flags = 0;
-	setinfo.pNext = nullptr;
-	setinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	setinfo.pBindings = &cameraBind;
-
-	_globalSetLayout = _descriptorLayoutCache->create_descriptor_layout(&setinfo);
-
-
-	VkDescriptorSetLayoutBinding objectBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0);
-
-	VkDescriptorSetLayoutCreateInfo set2info = {};
-	set2info.bindingCount = 1;
-	set2info.flags = 0;
-	set2info.pNext = nullptr;
-	set2info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	set2info.pBindings = &objectBind;
-
-	_objectSetLayout = _descriptorLayoutCache->create_descriptor_layout(&set2info);
-
-	
-	VkDescriptorSetLayoutBinding textureBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0);
-
-	VkDescriptorSetLayoutBinding gBufferBind1 = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0);
-	VkDescriptorSetLayoutBinding gBufferBind2 = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1);
-	VkDescriptorSetLayoutBinding gBufferBind3 = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 2);
-	VkDescriptorSetLayoutBinding gBufferBind4 = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 3);
-	VkDescriptorSetLayoutBinding gBufferBind5 = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 4);
-	VkDescriptorSetLayoutBinding gBufferBindings[] = { gBufferBind1,gBufferBind2,gBufferBind3,gBufferBind4,gBufferBind5 };
-
-	VkDescriptorSetLayoutCreateInfo set3info = {};
-	set3info.bindingCount = 1;
-	set3info.flags = 0;
-	set3info.pNext = nullptr;
-	set3info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	set3info.pBindings = &textureBind;
-
-	_singleTextureSetLayout = _descriptorLayoutCache->create_descriptor_layout(&set3info);
-
-	VkDescriptorSetLayoutCreateInfo set4info = {};
-	set4info.bindingCount = 2;
-	set4info.flags = 0;
-	set4info.pNext = nullptr;
-	set4info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	set4info.pBindings = bindings;
-
-	_lightSetLayout = _descriptorLayoutCache->create_descriptor_layout(&set4info);
-	_cascadesSetLayout = _descriptorLayoutCache->create_descriptor_layout(&set4info);
-
-	VkDescriptorSetLayoutCreateInfo set5info = {};
-	set5info.bindingCount = 5;
-	set5info.flags = 0;
-	set5info.pNext = nullptr;
-	set5info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	set5info.pBindings = gBufferBindings;
-
-	_gBufferSetLayout = _descriptorLayoutCache->create_descriptor_layout(&set5info);
-	
-	const size_t sceneParamBufferSize = FRAME_OVERLAP * pad_uniform_buffer_size(sizeof(GPUSceneData));
-
-	_sceneParameterBuffer = create_buffer(sceneParamBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-
-	VkDescriptorSetLayoutBinding cullBind1 = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0);
-	VkDescriptorSetLayoutBinding cullBind2 = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
-	VkDescriptorSetLayoutBinding cullBind3 = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2);
-	VkDescriptorSetLayoutBinding cullBindings[] = { cullBind1, cullBind2, cullBind3 };
-
-	VkDescriptorSetLayoutCreateInfo set6info = {};
-	set6info.bindingCount = 3;
-	set6info.flags = 0;
-	set6info.pNext = nullptr;
-	set6info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	set6info.pBindings = cullBindings;
-
-	_cullSetLayout = _descriptorLayoutCache->create_descriptor_layout(&set6info);
-
-	VkDescriptorSetLayoutBinding cascadeBindings = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0);
-	VkDescriptorSetLayoutCreateInfo csmSetInfo = {};
-	csmSetInfo.bindingCount = 1;
-	csmSetInfo.flags = 0;
-	csmSetInfo.pNext = nullptr;
-	csmSetInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	csmSetInfo.pBindings = &cascadeBindings;
-
-	_csmSetLayout = _descriptorLayoutCache->create_descriptor_layout(&csmSetInfo);
-
-	for (int i = 0; i < FRAME_OVERLAP; i++)
-	{
-		_frames[i].cameraBuffer = create_buffer(sizeof(GPUCameraData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-		_frames[i].lightBuffer = create_buffer(sizeof(GPUCameraData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-		_frames[i].skyboxBuffer = create_buffer(sizeof(GPUCameraData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-		_frames[i].cascadesSetBuffer = create_buffer(sizeof(CascadesSet), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-		for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
-			_frames[i].cascadesBuffers[j] = create_buffer(sizeof(GPUCameraData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-		}
-
-		const int MAX_OBJECTS = 10000;
-		_frames[i].objectBuffer = create_buffer(sizeof(GPUObjectData) * MAX_OBJECTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-		_frames[i].instanceBuffer = create_buffer(sizeof(GPUInstance) * MAX_OBJECTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-
-		const int MAX_COMMANDS = 10000;
-		_frames[i].indirectBuffer = create_buffer(sizeof(VkDrawIndirectCommand) * MAX_COMMANDS, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-		for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
-			_frames[i].indirectShadowBuffers[j] = create_buffer(sizeof(VkDrawIndirectCommand) * MAX_COMMANDS, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-			_descriptorAllocator->allocate(&_frames[i].cullCascadeDescriptors[j], _cullSetLayout);
-		}
-
-		_descriptorAllocator->allocate(&_frames[i].lightDescriptor, _lightSetLayout);
-		_descriptorAllocator->allocate(&_frames[i].globalDescriptor, _globalSetLayout);
-		_descriptorAllocator->allocate(&_frames[i].objectDescriptor, _objectSetLayout);
-		_descriptorAllocator->allocate(&_frames[i].cullDescriptor, _cullSetLayout);
-		_descriptorAllocator->allocate(&_frames[i].cascadesSetDescriptor, _cascadesSetLayout);
-		_descriptorAllocator->allocate(&_frames[i].skyboxDescriptor, _globalSetLayout);
-
-		VkDescriptorBufferInfo cameraInfo;
-		cameraInfo.buffer = _frames[i].cameraBuffer._buffer;
-		cameraInfo.offset = 0;
-		cameraInfo.range = sizeof(GPUCameraData);
-
-		VkDescriptorBufferInfo sceneInfo;
-		sceneInfo.buffer = _sceneParameterBuffer._buffer;
-		sceneInfo.offset = 0;
-		sceneInfo.range = sizeof(GPUSceneData);
-
-		VkDescriptorBufferInfo objectBufferInfo;
-		objectBufferInfo.buffer = _frames[i].objectBuffer._buffer;
-		objectBufferInfo.offset = 0;
-		objectBufferInfo.range = sizeof(GPUObjectData) * MAX_OBJECTS;
-
-		VkDescriptorBufferInfo instanceBufferInfo;
-		instanceBufferInfo.buffer = _frames[i].instanceBuffer._buffer;
-		instanceBufferInfo.offset = 0;
-		instanceBufferInfo.range = sizeof(GPUInstance) * MAX_OBJECTS;
-
-		VkDescriptorBufferInfo indirectBufferInfo;
-		indirectBufferInfo.buffer = _frames[i].indirectBuffer._buffer;
-		indirectBufferInfo.offset = 0;
-		indirectBufferInfo.range = sizeof(VkDrawIndirectCommand) * MAX_OBJECTS;
-
-		std::array<VkDescriptorBufferInfo,SHADOW_MAP_CASCADE_COUNT> indirectShadowBufferInfos;
-		for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
-			indirectShadowBufferInfos[j].buffer = _frames[i].indirectShadowBuffers[j]._buffer;
-			indirectShadowBufferInfos[j].offset = 0;
-			indirectShadowBufferInfos[j].range = sizeof(VkDrawIndirectCommand) * MAX_OBJECTS;
-		}
-		
-
-		VkDescriptorBufferInfo lightBufferInfo;
-		lightBufferInfo.buffer = _frames[i].lightBuffer._buffer;
-		lightBufferInfo.offset = 0;
-		lightBufferInfo.range = sizeof(GPUCameraData);
-
-		VkDescriptorBufferInfo skyboxBufferInfo;
-		skyboxBufferInfo.buffer = _frames[i].skyboxBuffer._buffer;
-		skyboxBufferInfo.offset = 0;
-		skyboxBufferInfo.range = sizeof(GPUCameraData);
-
-		VkDescriptorBufferInfo cascadesSetBufferInfo;
-		cascadesSetBufferInfo.buffer = _frames[i].cascadesSetBuffer._buffer;
-		cascadesSetBufferInfo.offset = 0;
-		cascadesSetBufferInfo.range = sizeof(CascadesSet);
-
-
-		std::array<VkDescriptorBufferInfo, SHADOW_MAP_CASCADE_COUNT> cascadesBufferInfo;
-		for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
-			cascadesBufferInfo[j].buffer = _frames[i].cascadesBuffers[j]._buffer;
-			cascadesBufferInfo[j].offset = 0;
-			cascadesBufferInfo[j].range = sizeof(GPUCameraData);
-
-			vkutil::DescriptorBuilder::begin(_descriptorLayoutCache, _descriptorAllocator)
-				.bind_buffer(0, &cascadesBufferInfo[j], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-				.bind_buffer(1, &sceneInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-				.build(_frames[i].cascades[j].descriptorSet);
-		}
-
-		vkutil::DescriptorBuilder::begin(_descriptorLayoutCache, _descriptorAllocator)
-			.bind_buffer(0, &lightBufferInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-			.bind_buffer(1, &sceneInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-			.build(_frames[i].lightDescriptor);
-
-		vkutil::DescriptorBuilder::begin(_descriptorLayoutCache, _descriptorAllocator)
-			.bind_buffer(0, &cascadesSetBufferInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-			.bind_buffer(1, &sceneInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-			.build(_frames[i].cascadesSetDescriptor);
-
-
-		vkutil::DescriptorBuilder::begin(_descriptorLayoutCache, _descriptorAllocator)
-			.bind_buffer(0, &cameraInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-			.build(_frames[i].globalDescriptor);
-
-		vkutil::DescriptorBuilder::begin(_descriptorLayoutCache, _descriptorAllocator)
-			.bind_buffer(0, &skyboxBufferInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-			.build(_frames[i].skyboxDescriptor);
-
-		vkutil::DescriptorBuilder::begin(_descriptorLayoutCache, _descriptorAllocator)
-			.bind_buffer(0, &objectBufferInfo, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
-			.build(_frames[i].objectDescriptor);
-
-		vkutil::DescriptorBuilder::begin(_descriptorLayoutCache, _descriptorAllocator)
-			.bind_buffer(0, &objectBufferInfo, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
-			.bind_buffer(1, &instanceBufferInfo, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
-			.bind_buffer(2, &indirectBufferInfo, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
-			.build(_frames[i].cullDescriptor);
-
-		for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
-			vkutil::DescriptorBuilder::begin(_descriptorLayoutCache, _descriptorAllocator)
-				.bind_buffer(0, &objectBufferInfo, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
-				.bind_buffer(1, &instanceBufferInfo, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
-				.bind_buffer(2, &indirectShadowBufferInfos[j], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
-				.build(_frames[i].cullCascadeDescriptors[j]);
-		}
-
-		
-			
-	}
-
-	_mainDeletionQueue.push_function([&]() {
-	
-		vmaDestroyBuffer(_allocator, _sceneParameterBuffer._buffer, _sceneParameterBuffer._allocation);
-		for (int i = 0; i < FRAME_OVERLAP; i++)
-		{
-			vmaDestroyBuffer(_allocator, _frames[i].cameraBuffer._buffer, _frames[i].cameraBuffer._allocation);
-			vmaDestroyBuffer(_allocator, _frames[i].lightBuffer._buffer, _frames[i].lightBuffer._allocation);
-			vmaDestroyBuffer(_allocator, _frames[i].objectBuffer._buffer, _frames[i].objectBuffer._allocation);
-			vmaDestroyBuffer(_allocator, _frames[i].instanceBuffer._buffer, _frames[i].instanceBuffer._allocation);
-			vmaDestroyBuffer(_allocator, _frames[i].skyboxBuffer._buffer, _frames[i].skyboxBuffer._allocation);
-			vmaDestroyBuffer(_allocator, _frames[i].cascadesSetBuffer._buffer, _frames[i].cascadesSetBuffer._allocation);
-			for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
-				vmaDestroyBuffer(_allocator, _frames[i].indirectShadowBuffers[j]._buffer, _frames[i].indirectShadowBuffers[j]._allocation);
-				vmaDestroyBuffer(_allocator, _frames[i].cascadesBuffers[j]._buffer, _frames[i].cascadesBuffers[j]._allocation);
-			}
-			vmaDestroyBuffer(_allocator, _frames[i].indirectBuffer._buffer, _frames[i].indirectBuffer._allocation);
-		}
-	});
-		
-
-}
-
-void VulkanEngine::key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
-{
-    VulkanEngine* myEngine = static_cast<VulkanEngine*>(glfwGetWindowUserPointer(window));
-    glm::vec3 dir = myEngine->_camera._foc - myEngine->_camera._camPos;
-    dir[1] = 0.0f;
-    glm::vec3 forward = glm::normalize(dir) * 0.25f;
-    glm::vec3 right = glm::cross(glm::normalize(dir), glm::vec3{0.0f, 1.0f, 0.0f}) * 0.25f;
-    if (action == GLFW_REPEAT || action == GLFW_PRESS) {
-        switch (key)
-        {
-        case GLFW_KEY_A:
-		
-			myEngine->_camera._camPos -= right;
-			myEngine->_camera._foc -= right;
-			myEngine->_camera._oriFoc -= right;
-            break;
-        case GLFW_KEY_D:
-            
-			myEngine->_camera._camPos += right;
-			myEngine->_camera._foc += right;
-			myEngine->_camera._oriFoc += right;
-            break;
-        case GLFW_KEY_W:
-            
-			myEngine->_camera._camPos += forward;
-			myEngine->_camera._foc += forward;
-			myEngine->_camera._oriFoc += forward;
-            break;
-        case GLFW_KEY_S:
-            
-			myEngine->_camera._camPos -= forward;
-			myEngine->_camera._foc -= forward;
-			myEngine->_camera._oriFoc -= forward;
-            break;
-        default:
-            break;
-        };
-    }
-}
-
-void VulkanEngine::mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
-{
-    VulkanEngine* myEngine = static_cast<VulkanEngine*>(glfwGetWindowUserPointer(window));
-    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
-    {
-        double xpos, ypos;
-        glfwGetCursorPos(window, &xpos, &ypos);
-        myEngine->_camera._posPress = glm::vec2(xpos, ypos);
-    }
-    else if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE)
-    {
-        myEngine->_camera._horAngle = myEngine->_camera._horAngle + myEngine->_camera._horAngleOffset;
-        myEngine->_camera._verAngle = myEngine->_camera._verAngle + myEngine->_camera._verAngleOffset;
-        myEngine->_camera._horAngleOffset = 0.0f;
-        myEngine->_camera._verAngleOffset = 0.0f;
-    }
-}
-
-void VulkanEngine::cursor_position_callback(GLFWwindow* window, double xpos, double ypos)
-{
-    VulkanEngine* myEngine = static_cast<VulkanEngine*>(glfwGetWindowUserPointer(window));
-    int state = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT);
-    if (state == GLFW_PRESS) {
-
-        myEngine->_camera._horAngleOffset = (myEngine->_camera._posPress.x - xpos) * 90.0f / (float)myEngine->_windowExtent.width;
-        myEngine->_camera._verAngleOffset = (myEngine->_camera._posPress.y - ypos) * 90.0f / (float)myEngine->_windowExtent.height;
-
-
-        if (myEngine->_camera._verAngle + myEngine->_camera._verAngleOffset > 30.0f) {
-            myEngine->_camera._verAngleOffset = 30.0f - myEngine->_camera._verAngle;
-        }
-        else if (myEngine->_camera._verAngle + myEngine->_camera._verAngleOffset < -30.0f) {
-            myEngine->_camera._verAngleOffset = -30.0f - myEngine->_camera._verAngle;
-        }
-
-        glm::vec3 trans = -myEngine->_camera._camPos;
-        glm::mat4 horizatal_rotate = glm::rotate(glm::mat4(1.0f), glm::radians(myEngine->_camera._horAngle + myEngine->_camera._horAngleOffset), glm::vec3(0.0f, 1.0f, 0.0f));
-        glm::mat4 vertical_rotate = glm::rotate(glm::mat4(1.0f), glm::radians(myEngine->_camera._verAngle + myEngine->_camera._verAngleOffset), glm::vec3(1.0f, 0.0f, 0.0f));
-        glm::vec4 focal = (glm::translate(glm::mat4(1.0), -trans) * horizatal_rotate * vertical_rotate * glm::translate(glm::mat4(1.0), trans) * glm::vec4(myEngine->_camera._oriFoc, 1.0f));
-        focal /= focal.w;
-        myEngine->_camera._foc = glm::vec3(focal.x, focal.y, focal.z);
-    }
-
-}
-
-void VulkanEngine::cursor_enter_callback(GLFWwindow* window, int entered)
-{
-    VulkanEngine* myEngine = static_cast<VulkanEngine*>(glfwGetWindowUserPointer(window));
-    if (!entered) {
-		int horAngleInt = static_cast<int>(myEngine->_camera._horAngle + myEngine->_camera._horAngleOffset);
-        myEngine->_camera._horAngle = (myEngine->_camera._horAngle + myEngine->_camera._horAngleOffset) - horAngleInt/360 * 360.0f;
-        myEngine->_camera._verAngle = myEngine->_camera._verAngle + myEngine->_camera._verAngleOffset;
-        myEngine->_camera._horAngleOffset = 0.0f;
-        myEngine->_camera._verAngleOffset = 0.0f;
-    }
-
-}
-
-void VulkanEngine::framebufferResizeCallback(GLFWwindow* window, int width, int height) {
-    auto myEngine = reinterpret_cast<VulkanEngine*>(glfwGetWindowUserPointer(window));
-    myEngine->framebufferResized = true;
+#include "vk_types.h"
+#include "vk_initializers.h"
+#include "vk_descriptors.h"
+#include "VkBootstrap.h"
+#include "vk_engine.h"
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+#include <iostream>
+#include <fstream>
+
+#include "Texture.h"
+#include "Scene.h"
+
+#define VMA_STATIC_VULKAN_FUNCTIONS 0 
+#define VMA_DYNAMIC_VULKAN_FUNCTIONS 1
+#define VMA_IMPLEMENTATION
+#include <vma/vk_mem_alloc.h>
+
+
+#define VK_CHECK(x)                                                 \
+	do                                                              \
+	{                                                               \
+		VkResult err = x;                                           \
+		if (err)                                                    \
+		{                                                           \
+			std::cout <<"Detected Vulkan error: " << err << std::endl; \
+			abort();                                                \
+		}                                                           \
+	} while (0)
+
+#ifdef NDEBUG
+constexpr bool bUseValidationLayers = false;
+#else
+constexpr bool bUseValidationLayers = true;
+#endif
+
+#ifdef VKE_COUNT_FRAME_ALLOCATIONS
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// every operator new made by the render thread and the pool, render_loop aborts on steady state frames that made any
+static std::atomic<size_t> gHeapAllocations{ 0 };
+// cleared by simulate(), snapshots and input callbacks allocate on their own schedule and not in a frame
+static thread_local bool tCountAllocations = true;
+
+// arenas, worker command buffers and object buffers are still growing during the first frames
+constexpr int ALLOCATION_WARMUP_FRAMES = 120;
+
+void* operator new(size_t size)
+{
+	if (tCountAllocations) {
+		gHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (void* memory = std::malloc(size > 0 ? size : 1)) {
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	std::free(memory);
+}
+#endif
+
+const std::vector<std::string> TEXTURE_PATHS =
+{
+	"assets/NY_City/City Block OBJ/Building textures/Building 1/Brownstone red_Color.png",
+	"assets/NY_City/City Block OBJ/Building textures/Building 2/Building brick cornor_Color.png",
+	 "assets/NY_City/City Block OBJ/Building textures/Building 3/Townhouse 001_color.png",
+	 "assets/NY_City/City Block OBJ/Building textures/Building 4/Townhouse6_Color.png",
+	"assets/NY_City/City Block OBJ/Building textures/Building 5/Brownstone tall_Color.png",
+	 "assets/NY_City/City Block OBJ/Building textures/Building 6/Brick Building_Color.png",
+	 "assets/NY_City/City Block OBJ/Building textures/Building 7/Building center_Color.png",
+	 "assets/NY_City/City Block OBJ/Building textures/Building 9/Townhousecornor_color.png",
+	"assets/NY_City/City Block OBJ/Building textures/Building 10/Townhouse Brownstone_Color.png",
+	 "assets/NY_City/City Block OBJ/Maple tree/Bark.png",
+	 "assets/NY_City/City Block OBJ/Maple tree/leaf2_Color.png",
+	 "assets/NY_City/City Block OBJ/Road textures/Center road.png",
+	 "assets/NY_City/City Block OBJ/Road textures/Road.png",
+	 "assets/NY_City/City Block OBJ/Road textures/Side walk.png",
+};
+
+const std::vector<std::string> TEXTURE_NAMES =
+{
+	"Building 1",
+	"Building 2",
+	 "Building 3",
+	 "Building 4",
+	"Building 5",
+	 "Building 6",
+	 "Building 7",
+	 "Building 9",
+	 "Building 10",
+	"Bark",
+	"Leaf 2",
+	"Center road",
+	"Road",
+	"Side walk"
+};
+
+// cubemap faces in +X, -X, +Y, -Y, +Z, -Z order, before the skybox is turned by SKYBOX_YAW
+const std::array<vkutil::CubemapFace, 6> SKYBOX_FACES =
+{ {
+	{ "assets/left.png" },
+	{ "assets/right.png" },
+	{ "assets/top.png", true },
+	{ "" },
+	{ "assets/back.png" },
+	{ "assets/front.png" }
+} };
+
+constexpr float SKYBOX_YAW = 210.0f;
+
+constexpr uint32_t INITIAL_OBJECT_CAPACITY = 10000;
+
+// starting size of each frame's arena, it grows to the largest frame seen
+constexpr size_t FRAME_ARENA_SIZE = 1024 * 1024;
+
+constexpr float STRESS_BLOCK_SPACING = 100.0f;
+constexpr uint32_t STRESS_SEED = 1337;
+
+constexpr uint32_t TEXTURE_STREAMING_WINDOW = 60;
+constexpr uint32_t MAX_TEXTURE_STREAMS_PER_FRAME = 2;
+
+// in low latency mode the limiter starts a frame this much earlier than its predicted CPU time needs
+constexpr float LATENCY_MARGIN_MS = 1.0f;
+// debug builds print the averaged input latency this often while low latency mode is on
+constexpr uint32_t LATENCY_REPORT_FRAMES = 600;
+
+// the render extent moves in steps of this many pixels, small swings in GPU time do not resize it
+constexpr uint32_t RENDER_EXTENT_GRANULE = 8;
+
+static const char* present_mode_name(VkPresentModeKHR mode)
+{
+	switch (mode) {
+	case VK_PRESENT_MODE_IMMEDIATE_KHR: return "IMMEDIATE";
+	case VK_PRESENT_MODE_MAILBOX_KHR: return "MAILBOX";
+	case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO_RELAXED";
+	default: return "unknown";
+	}
+}
+
+void VulkanEngine::init()
+{
+	glfwInit();
+	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+
+	_window = glfwCreateWindow(_windowExtent.width,
+		_windowExtent.height, "Vulkan", nullptr, nullptr);
+
+	glfwSetWindowUserPointer(_window, this);
+	glfwSetFramebufferSizeCallback(_window, framebufferResizeCallback);
+
+	glfwSetWindowUserPointer(_window, this);
+
+	glfwSetKeyCallback(_window, key_callback);
+	glfwSetMouseButtonCallback(_window, mouse_button_callback);
+	glfwSetCursorPosCallback(_window, cursor_position_callback);
+	glfwSetCursorEnterCallback(_window, cursor_enter_callback);
+
+	if (_frameRateLimit == 0) {
+		const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+		_frameRateLimit = videoMode != nullptr ? videoMode->refreshRate : 60;
+	}
+	_frameInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / _frameRateLimit));
+
+	init_vulkan();
+
+	_frames.init(_frameOverlap);
+
+	init_swapchain();
+
+
+	init_render_graph();
+
+	prepare_depthpass();
+
+	init_framebuffers();
+
+	init_commands();
+
+	init_sync_structures();
+
+	init_descriptors();
+
+	init_pipelines();
+
+	load_images();
+
+	load_meshes();
+
+	init_scene();
+
+	init_frame_graph();
+
+	_isInitialized = true;
+}
+void VulkanEngine::cleanup()
+{
+	if (_isInitialized) {
+
+		vkDeviceWaitIdle(_device);
+
+		// decodes still running write into their staging buffers
+		for (TextureStream& stream : _textureStreams) {
+			if (stream.texture) {
+				while (!stream.done.load(std::memory_order_acquire)) {
+					std::this_thread::yield();
+				}
+				vmaDestroyBuffer(_allocator, stream.stagingBuffer._buffer, stream.stagingBuffer._allocation);
+			}
+		}
+
+		for (FrameData& frame : _frames)
+		{
+			frame._frameDeletionQueue.flush();
+		}
+
+		_mainDeletionQueue.flush();
+		
+		vkDestroySurfaceKHR(_instance, _surface, nullptr);
+
+		_descriptorAllocator->cleanup();
+		_descriptorLayoutCache->cleanup();
+		_samplerCache->cleanup();
+
+		vkDestroyDevice(_device, nullptr);
+		vkb::destroy_debug_utils_messenger(_instance, _debug_messenger);
+		vkDestroyInstance(_instance, nullptr);
+
+		glfwDestroyWindow(_window);
+
+		glfwTerminate();
+	}
+}
+
+void VulkanEngine::draw()
+{
+	wait_for_drawing();
+
+	pace_frame();
+
+	VK_CHECK(vkAcquireNextImageKHR(_device, _swapchain, UINT64_MAX, get_current_frame()._presentSemaphore, nullptr, &_swapchainImageIndex));
+
+	sample_input();
+
+	upload_object_data(get_current_frame());
+
+	update_descriptors(_renderables.data(), _renderables.size());
+
+	prepare_light_culling();
+
+	prepare_culling();
+
+	submit_culling();
+
+	if (!_recordOnce) {
+		_drawBatches = compact_draws(get_current_frame().arena, _renderables.data(), _renderables.size());
+	}
+
+	for (uint32_t i = 0; i < SHADOW_MAP_CASCADE_COUNT; i++) {
+		record_cascade(i);
+	}
+
+	prepare_shadowmap();
+
+	for (uint32_t i = 0; i < _mainPassSliceCount; i++) {
+		record_main_pass_slice(i);
+	}
+
+	render_scene(_swapchainImageIndex);
+
+	submit_frame(_swapchainImageIndex);
+
+	_frameNumber++;
+}
+
+void VulkanEngine::multithreading_draw()
+{
+	wait_for_drawing();
+
+	pace_frame();
+
+	// acquire can block on the presentation engine, input is read after it so the frame sees the newest state
+	VK_CHECK(vkAcquireNextImageKHR(_device, _swapchain, UINT64_MAX, get_current_frame()._presentSemaphore, nullptr, &_swapchainImageIndex));
+
+	sample_input();
+
+	_frameGraph.run(_threadpool);
+
+	_frameGraph.wait(_threadpool);
+
+	submit_frame(_swapchainImageIndex);
+
+	_frameNumber++;
+}
+
+void VulkanEngine::submit_culling()
+{
+	FrameData& frame = get_current_frame();
+
+	VkCommandBuffer cmds[] = {
+		frame._cullShadowCommandBuffer,
+		frame._cullCommandBuffer
+	};
+
+	frame.timelineValue = ++_frameTimelineValue;
+
+	// nothing to wait on: the slot's previous graphics work, the last reader of these
+	// buffers, already finished in wait_for_drawing, so this can overlap the previous frame
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &frame.timelineValue;
+
+	VkSubmitInfo submit = vkinit::submit_info(cmds);
+	submit.pNext = &timelineInfo;
+	submit.commandBufferCount = 2;
+
+	submit.signalSemaphoreCount = 1;
+	submit.pSignalSemaphores = &_cullTimeline;
+
+	VK_CHECK(vkQueueSubmit(_computeQueue, 1, &submit, nullptr));
+}
+
+void VulkanEngine::submit_frame(uint32_t swapchainImageIndex)
+{
+	FrameData& frame = get_current_frame();
+
+	// streamed texture uploads go first, the passes behind them sample the new images
+	VkCommandBuffer cmds[3];
+	uint32_t cmdCount = 0;
+	if (frame.uploadsRecorded) {
+		cmds[cmdCount++] = frame._uploadCommandBuffer;
+	}
+	cmds[cmdCount++] = _recordOnce ? frame._staticShadowCommandBuffer : frame._shadowCommandBuffer;
+	cmds[cmdCount++] = _recordOnce ? frame._staticMainCommandBuffers[swapchainImageIndex] : frame._mainCommandBuffer;
+
+	VkSemaphore waitSemaphores[] = { frame._presentSemaphore, _cullTimeline };
+	uint64_t waitValues[] = { 0, frame.timelineValue };
+	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT };
+
+	VkSemaphore signalSemaphores[] = { frame._renderSemaphore, _frameTimeline };
+	uint64_t signalValues[] = { 0, frame.timelineValue };
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = 2;
+	timelineInfo.pWaitSemaphoreValues = waitValues;
+	timelineInfo.signalSemaphoreValueCount = 2;
+	timelineInfo.pSignalSemaphoreValues = signalValues;
+
+	VkSubmitInfo submit = vkinit::submit_info(cmds);
+	submit.pNext = &timelineInfo;
+	submit.commandBufferCount = cmdCount;
+
+	submit.pWaitDstStageMask = waitStages;
+
+	submit.waitSemaphoreCount = 2;
+	submit.pWaitSemaphores = waitSemaphores;
+
+	submit.signalSemaphoreCount = 2;
+	submit.pSignalSemaphores = signalSemaphores;
+
+	VK_CHECK(vkQueueSubmit(_graphicsQueue, 1, &submit, nullptr));
+
+	frame.timestampsWritten = _gpuFrameBudget > 0.0f;
+
+	measure_input_latency();
+	
+	VkPresentInfoKHR presentInfo = vkinit::present_info();
+
+	presentInfo.pSwapchains = &_swapchain;
+	presentInfo.swapchainCount = 1;
+
+	presentInfo.pWaitSemaphores = &frame._renderSemaphore;
+	presentInfo.waitSemaphoreCount = 1;
+
+	presentInfo.pImageIndices = &swapchainImageIndex;
+
+	VK_CHECK(vkQueuePresentKHR(_graphicsQueue, &presentInfo));
+}
+
+void VulkanEngine::wait_for_timeline(uint64_t value)
+{
+	VkSemaphoreWaitInfo waitInfo = {};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &_frameTimeline;
+	waitInfo.pValues = &value;
+
+	VK_CHECK(vkWaitSemaphores(_device, &waitInfo, UINT64_MAX));
+}
+
+
+void VulkanEngine::init_frame_graph()
+{
+	using Task = vks::TaskGraph::Task;
+
+	Task uploadObjects = _frameGraph.add([this] { upload_object_data(get_current_frame()); });
+
+	// camera, scene and cascade uniforms, the cascade fit feeds the light culling and the shadow pass
+	Task fitCascades = _frameGraph.add([this] { update_descriptors(_renderables.data(), _renderables.size()); });
+
+	Task batchDraws = _frameGraph.add([this] {
+		if (!_recordOnce) {
+			_drawBatches = compact_draws(get_current_frame().arena, _renderables.data(), _renderables.size());
+		}
+		});
+
+	Task recordLightCull = _frameGraph.then({ fitCascades }, [this] { prepare_light_culling(); });
+	Task recordCull = _frameGraph.then({ fitCascades }, [this] { prepare_culling(); });
+
+	_frameGraph.then({ uploadObjects, recordLightCull, recordCull }, [this] { submit_culling(); });
+
+	// each cascade and each slice of the main pass records its own secondary command buffer,
+	// the primaries only begin the render passes and execute them in order
+	Task shadowPass = _frameGraph.add([this] { prepare_shadowmap(); });
+	for (uint32_t i = 0; i < SHADOW_MAP_CASCADE_COUNT; i++) {
+		Task cascade = _frameGraph.then({ fitCascades, batchDraws }, [this, i] { record_cascade(i); });
+		_frameGraph.precede(cascade, shadowPass);
+	}
+
+	_mainPassSliceCount = std::min(_workerThreadCount + 1, MAX_MAIN_PASS_SLICES);
+
+	Task mainPass = _frameGraph.add([this] { render_scene(_swapchainImageIndex); });
+	for (uint32_t i = 0; i < _mainPassSliceCount; i++) {
+		Task slice = _frameGraph.then({ batchDraws }, [this, i] { record_main_pass_slice(i); });
+		_frameGraph.precede(slice, mainPass);
+	}
+}
+
+void VulkanEngine::run()
+{
+	// GLFW has to be polled on the thread that created the window, so this one simulates and frames
+	// are rendered on another. The first snapshot is published before the renderer starts
+	_simulation.sceneParameters = _sceneParameters;
+	publish_snapshot(std::chrono::steady_clock::now());
+
+	_rendering = true;
+	std::thread renderThread([this] { render_loop(); });
+
+	simulate();
+
+	_rendering = false;
+	renderThread.join();
+}
+
+void VulkanEngine::render_loop()
+{
+	// binds this thread as queue 0, so the frame graph submits to its own deque and workerIndex() is valid here
+	_threadpool.setThreadCount(_workerThreadCount);
+
+	while (_rendering) {
+#ifdef VKE_COUNT_FRAME_ALLOCATIONS
+		size_t allocations = gHeapAllocations.load();
+		uint32_t streamEvents = _startedTextureStreams + _streamedTextureCount;
+#endif
+		//draw();
+		multithreading_draw();
+#ifdef VKE_COUNT_FRAME_ALLOCATIONS
+		// starting a texture stream queues a pool job and swapping one in queues the old image for deletion,
+		// any other steady state frame that allocates is a regression
+		size_t frameAllocations = gHeapAllocations.load() - allocations;
+		if (_frameNumber > ALLOCATION_WARMUP_FRAMES && frameAllocations > 0 && _startedTextureStreams + _streamedTextureCount == streamEvents) {
+			std::cout << "Frame " << _frameNumber << " made " << frameAllocations << " heap allocations" << std::endl;
+			if (_allocationTestFrames == 0) {
+				abort();
+			}
+			_allocatingFrames++;
+		}
+		if (_allocationTestFrames > 0 && _frameNumber >= ALLOCATION_WARMUP_FRAMES + static_cast<int>(_allocationTestFrames)) {
+			std::cout << "Allocation test: " << _allocatingFrames << " of " << _allocationTestFrames << " steady state frames allocated" << std::endl;
+			glfwSetWindowShouldClose(_window, GLFW_TRUE);
+			break;
+		}
+#endif
+	}
+
+}
+
+void VulkanEngine::simulate()
+{
+#ifdef VKE_COUNT_FRAME_ALLOCATIONS
+	tCountAllocations = false;
+#endif
+
+	std::chrono::steady_clock::duration step = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / _simulationRate));
+	std::chrono::steady_clock::time_point nextStep = std::chrono::steady_clock::now();
+
+	while (!glfwWindowShouldClose(_window)) {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now < nextStep) {
+			// callbacks move the camera as soon as their events arrive, frames see it from the next step on
+			glfwWaitEventsTimeout(std::chrono::duration<double>(nextStep - now).count());
+			continue;
+		}
+
+		glfwPollEvents();
+
+		publish_snapshot(std::chrono::steady_clock::now());
+
+		// a late step moves the schedule, the next ones are not run back to back to catch up
+		nextStep = std::max(nextStep + step, now);
+	}
+}
+
+void VulkanEngine::publish_snapshot(std::chrono::steady_clock::time_point inputTime)
+{
+	SceneSnapshot& snapshot = _snapshots.back();
+	snapshot.camera = _camera;
+	snapshot.sceneParameters = _simulation.sceneParameters;
+	snapshot.sceneParametersVersion = _simulation.sceneParametersVersion;
+	snapshot.transforms.assign(_simulation.pendingTransforms.begin(), _simulation.pendingTransforms.end());
+	snapshot.inputTime = inputTime;
+
+	// snapshots the renderer skipped lose nothing, their transform changes go out again until one is taken
+	std::vector<ObjectTransform>& pending = _simulation.pendingTransforms;
+	if (_snapshots.publish()) {
+		pending.erase(pending.begin(), pending.begin() + _simulation.sentTransforms);
+	}
+	_simulation.sentTransforms = pending.size();
+}
+
+void VulkanEngine::move_object(uint32_t index, const glm::mat4& transform)
+{
+	_simulation.pendingTransforms.push_back({ index, transform });
+}
+
+void VulkanEngine::set_scene_parameters(const GPUSceneData& parameters)
+{
+	_simulation.sceneParameters = parameters;
+	_simulation.sceneParametersVersion++;
+}
+
+void VulkanEngine::wait_for_drawing() {
+	// low latency mode keeps a single frame queued: wait for the last one submitted, not only this slot's
+	wait_for_timeline(_lowLatency ? _frameTimelineValue : get_current_frame().timelineValue);
+
+	get_current_frame()._frameDeletionQueue.flush();
+
+	get_current_frame().arena.reset();
+
+	update_render_scale();
+
+	reserve_object_buffers(get_current_frame(), _renderables.size());
+
+	update_texture_streaming();
+
+	VK_CHECK(vkResetCommandBuffer(get_current_frame()._cullShadowCommandBuffer, 0));
+	VK_CHECK(vkResetCommandBuffer(get_current_frame()._cullCommandBuffer, 0));
+	VK_CHECK(vkResetCommandBuffer(get_current_frame()._mainCommandBuffer, 0));
+	VK_CHECK(vkResetCommandBuffer(get_current_frame()._shadowCommandBuffer, 0));
+
+	for (WorkerCommands& worker : get_current_frame()._workerCommands) {
+		VK_CHECK(vkResetCommandPool(_device, worker.pool, 0));
+		worker.used = 0;
+	}
+}
+
+void VulkanEngine::pace_frame()
+{
+	if (!_lowLatency) {
+		return;
+	}
+
+	// everything the frame does between reading input and submitting adds to the latency, so
+	// instead of starting right after the wait, start when there is just enough time left
+	std::chrono::duration<float, std::milli> expected(_averageInputLatency + LATENCY_MARGIN_MS);
+	std::chrono::steady_clock::time_point start = _nextSubmitTime - std::chrono::duration_cast<std::chrono::steady_clock::duration>(expected);
+
+	if (start > std::chrono::steady_clock::now()) {
+		std::this_thread::sleep_until(start);
+	}
+}
+
+void VulkanEngine::sample_input()
+{
+	// the simulation thread polls the window, the frame starts from the newest snapshot it published
+	if (_snapshots.acquire()) {
+		const SceneSnapshot& snapshot = _snapshots.front();
+
+		for (const ObjectTransform& change : snapshot.transforms) {
+			set_object_transform(change.index, change.transform);
+		}
+
+		if (snapshot.sceneParametersVersion != _sceneParametersVersion) {
+			_sceneParameters = snapshot.sceneParameters;
+			_sceneParametersVersion = snapshot.sceneParametersVersion;
+			mark_scene_params_dirty();
+		}
+	}
+
+	_inputTime = _snapshots.front().inputTime;
+}
+
+void VulkanEngine::measure_input_latency()
+{
+	std::chrono::steady_clock::time_point submitTime = std::chrono::steady_clock::now();
+
+	_inputLatency = std::chrono::duration<float, std::milli>(submitTime - _inputTime).count();
+	_averageInputLatency = _averageInputLatency == 0.0f ? _inputLatency : glm::mix(_averageInputLatency, _inputLatency, 0.1f);
+
+	// a late frame moves the schedule, the next ones are not started back to back to catch up
+	_nextSubmitTime = std::max(_nextSubmitTime, submitTime) + _frameInterval;
+
+#ifndef NDEBUG
+	if (_lowLatency && (_frameNumber + 1) % LATENCY_REPORT_FRAMES == 0) {
+		std::cout << "Input to submit latency " << _averageInputLatency << " ms" << std::endl;
+	}
+#endif
+}
+
+void VulkanEngine::prepare_culling() {
+	VkCommandBuffer cmd = get_current_frame()._cullShadowCommandBuffer;
+
+	cmd = get_current_frame()._cullCommandBuffer;
+	execute_culling(cmd, _renderables.data(), _renderables.size());
+}
+
+void VulkanEngine::prepare_light_culling() {
+	VkCommandBuffer cmd = get_current_frame()._cullShadowCommandBuffer;
+
+	VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+	VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+
+	for (uint32_t i = 0; i < SHADOW_MAP_CASCADE_COUNT; i++) {
+		execute_shadow_culling(cmd, _renderables.data(), _renderables.size(), i);
+	}
+
+	VK_CHECK(vkEndCommandBuffer(cmd));
+}
+
+void  VulkanEngine::prepare_shadowmap() {
+
+	FrameData& frame = get_current_frame();
+
+	VkCommandBuffer cmd = frame._shadowCommandBuffer;
+	VkCommandBufferUsageFlags usage = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	// in record-once mode the cascades are recorded inline and the buffer is resubmitted until the scene changes
+	BufferSpan<IndirectBatch> staticDraws;
+	if (_recordOnce) {
+		if (frame._staticShadowVersion == _sceneVersion) {
+			return;
+		}
+		cmd = frame._staticShadowCommandBuffer;
+		usage = 0;
+		staticDraws = compact_draws(frame.arena, _renderables.data(), _renderables.size());
+		VK_CHECK(vkResetCommandBuffer(cmd, 0));
+		frame._staticShadowVersion = _sceneVersion;
+	}
+
+	VkClearValue clearValue;
+	clearValue.color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+
+	VkClearValue depthClear;
+	depthClear.depthStencil.depth = 1.f;
+
+	VkClearValue clearValues[] = { clearValue, depthClear };
+
+	VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(usage);
+
+	VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+
+	if (_gpuFrameBudget > 0.0f) {
+		vkCmdResetQueryPool(cmd, frame.timestampPool, 0, 2);
+		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestampPool, 0);
+	}
+
+	for (size_t i = 0; i < SHADOW_MAP_CASCADE_COUNT; i++) {
+		VkRenderPassBeginInfo sdrpInfo = vkinit::renderpass_begin_info(_depthPass, _shadowExtent, frame.cascades[i].frameBuffer);
+
+		VkClearValue clearValues[1];
+		clearValues[0].depthStencil = { 1.0f, 0 };
+
+		sdrpInfo.clearValueCount = 1;
+		sdrpInfo.pClearValues = clearValues;
+
+		if (_recordOnce) {
+			vkCmdBeginRenderPass(cmd, &sdrpInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+			set_viewport(cmd, _shadowExtent);
+			update_csm(cmd, staticDraws.data, staticDraws.size(), i);
+		}
+		else {
+			vkCmdBeginRenderPass(cmd, &sdrpInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+			vkCmdExecuteCommands(cmd, 1, &frame._cascadeCommandBuffers[i]);
+		}
+
+		vkCmdEndRenderPass(cmd);
+
+	}
+	VK_CHECK(vkEndCommandBuffer(cmd));
+}
+
+
+
+void  VulkanEngine::render_scene(uint32_t swapchainImageIndex) {
+
+	FrameData& frame = get_current_frame();
+
+	VkCommandBuffer cmd = frame._mainCommandBuffer;
+	VkCommandBufferUsageFlags usage = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	// the framebuffer differs per swapchain image, so record-once keeps one buffer per image in every frame slot
+	BufferSpan<IndirectBatch> staticDraws;
+	if (_recordOnce) {
+		if (frame._staticMainVersions[swapchainImageIndex] == _sceneVersion) {
+			return;
+		}
+		cmd = frame._staticMainCommandBuffers[swapchainImageIndex];
+		usage = 0;
+		staticDraws = compact_draws(frame.arena, _renderables.data(), _renderables.size());
+		VK_CHECK(vkResetCommandBuffer(cmd, 0));
+		frame._staticMainVersions[swapchainImageIndex] = _sceneVersion;
+	}
+
+	VkClearValue clearValue;
+	clearValue.color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+
+	VkClearValue depthClear;
+	depthClear.depthStencil.depth = 1.f;
+
+	VkClearValue clearValues[] = { clearValue, depthClear };
+
+	VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(usage);
+
+	VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+	VkRenderPassBeginInfo rpInfo = vkinit::renderpass_begin_info(_renderPass, frame.renderExtent, _sceneFramebuffer);
+
+	rpInfo.clearValueCount = 2;
+
+	rpInfo.pClearValues = &clearValues[0];
+
+	if (_recordOnce) {
+		vkCmdBeginRenderPass(cmd, &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		set_viewport(cmd, frame.renderExtent);
+		draw_objects(cmd, staticDraws.data, staticDraws.size());
+		draw_skybox(cmd);
+	}
+	else {
+		vkCmdBeginRenderPass(cmd, &rpInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+		vkCmdExecuteCommands(cmd, _mainPassSliceCount, frame._mainPassSlices.data());
+	}
+
+	vkCmdEndRenderPass(cmd);
+
+	VkRenderPassBeginInfo upscaleInfo = vkinit::renderpass_begin_info(_upscalePass, _windowExtent, _framebuffers[swapchainImageIndex]);
+
+	upscaleInfo.clearValueCount = 1;
+
+	upscaleInfo.pClearValues = &clearValue;
+
+	vkCmdBeginRenderPass(cmd, &upscaleInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	draw_upscale(cmd, frame.renderExtent);
+
+	vkCmdEndRenderPass(cmd);
+
+	if (_gpuFrameBudget > 0.0f) {
+		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.timestampPool, 1);
+	}
+
+	VkBufferMemoryBarrier feedbackBarrier = vkinit::buffer_barrier(frame.feedbackBuffer._buffer, _graphicsQueueFamily);
+	feedbackBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	feedbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &feedbackBarrier, 0, nullptr);
+
+	VK_CHECK(vkEndCommandBuffer(cmd));
+
+}
+
+VkCommandBuffer VulkanEngine::begin_secondary_command_buffer(VkRenderPass renderPass, VkFramebuffer framebuffer)
+{
+	// every pool thread records from its own command pool, so recording needs no locking
+	WorkerCommands& worker = get_current_frame()._workerCommands[_threadpool.workerIndex()];
+
+	if (worker.used == worker.buffers.size()) {
+		VkCommandBufferAllocateInfo cmdAllocInfo = vkinit::command_buffer_allocate_info(worker.pool, 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+		VkCommandBuffer buffer;
+		VK_CHECK(vkAllocateCommandBuffers(_device, &cmdAllocInfo, &buffer));
+		worker.buffers.push_back(buffer);
+	}
+	VkCommandBuffer cmd = worker.buffers[worker.used++];
+
+	VkCommandBufferInheritanceInfo inheritanceInfo = vkinit::command_buffer_inheritance_info(renderPass, 0, framebuffer);
+
+	VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT);
+	cmdBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+
+	return cmd;
+}
+
+void VulkanEngine::record_cascade(uint32_t cascadeIndex)
+{
+	// record-once mode records the passes inline in prepare_shadowmap and render_scene instead
+	if (_recordOnce) {
+		return;
+	}
+
+	FrameData& frame = get_current_frame();
+
+	VkCommandBuffer cmd = begin_secondary_command_buffer(_depthPass, frame.cascades[cascadeIndex].frameBuffer);
+
+	// dynamic state is not inherited from the primary
+	set_viewport(cmd, _shadowExtent);
+
+	update_csm(cmd, _drawBatches.data, _drawBatches.size(), cascadeIndex);
+
+	VK_CHECK(vkEndCommandBuffer(cmd));
+
+	frame._cascadeCommandBuffers[cascadeIndex] = cmd;
+}
+
+void VulkanEngine::record_main_pass_slice(uint32_t slice)
+{
+	if (_recordOnce) {
+		return;
+	}
+
+	FrameData& frame = get_current_frame();
+
+	size_t begin = _drawBatches.size() * slice / _mainPassSliceCount;
+	size_t end = _drawBatches.size() * (slice + 1) / _mainPassSliceCount;
+
+	VkCommandBuffer cmd = begin_secondary_command_buffer(_renderPass, _sceneFramebuffer);
+
+	set_viewport(cmd, frame.renderExtent);
+
+	draw_objects(cmd, _drawBatches.data + begin, end - begin);
+
+	// the skybox fills whatever the geometry left, so it goes after every other slice
+	if (slice == _mainPassSliceCount - 1) {
+		draw_skybox(cmd);
+	}
+
+	VK_CHECK(vkEndCommandBuffer(cmd));
+
+	frame._mainPassSlices[slice] = cmd;
+}
+
+FrameData& VulkanEngine::get_current_frame()
+{
+	return _frames.current(_frameNumber);
+}
+
+
+FrameData& VulkanEngine::get_last_frame()
+{
+	return _frames.previous(_frameNumber);
+}
+
+FrameData& VulkanEngine::get_next_frame()
+{
+	return _frames.next(_frameNumber);
+}
+
+void VulkanEngine::init_vulkan()
+{
+	vkb::InstanceBuilder builder;
+
+	auto inst_ret = builder.set_app_name("Example Vulkan Application")
+		.request_validation_layers(bUseValidationLayers)
+		.use_default_debug_messenger()
+		.require_api_version(1, 2, 0)
+		.build();
+
+	vkb::Instance vkb_inst = inst_ret.value();
+
+	_instance = vkb_inst.instance;
+	_debug_messenger = vkb_inst.debug_messenger;
+
+	glfwCreateWindowSurface(_instance, _window, NULL, &_surface);
+
+	vkb::PhysicalDeviceSelector selector{ vkb_inst };
+	VkPhysicalDeviceFeatures feats{};
+
+	feats.pipelineStatisticsQuery = true;
+	feats.multiDrawIndirect = true;
+	feats.drawIndirectFirstInstance = true;
+	feats.samplerAnisotropy = true;
+	feats.fragmentStoresAndAtomics = true;
+	selector.set_required_features(feats);
+
+	VkPhysicalDeviceVulkan12Features feats12{};
+	feats12.descriptorIndexing = true;
+	feats12.runtimeDescriptorArray = true;
+	feats12.descriptorBindingPartiallyBound = true;
+	feats12.shaderSampledImageArrayNonUniformIndexing = true;
+	feats12.timelineSemaphore = true;
+	selector.set_required_features_12(feats12);
+
+	vkb::PhysicalDevice physicalDevice = selector
+		.set_minimum_version(1, 2)
+		.set_surface(_surface)
+		.select()
+		.value();
+
+	vkb::DeviceBuilder deviceBuilder{ physicalDevice };
+	VkPhysicalDeviceShaderDrawParametersFeatures shader_draw_parameters_features = {};
+	shader_draw_parameters_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_DRAW_PARAMETERS_FEATURES;
+	shader_draw_parameters_features.pNext = nullptr;
+	shader_draw_parameters_features.shaderDrawParameters = true;
+	vkb::Device vkbDevice = deviceBuilder.add_pNext(&shader_draw_parameters_features).build().value();
+
+	_device = vkbDevice.device;
+	_chosenGPU = physicalDevice.physical_device;
+
+	_graphicsQueue = vkbDevice.get_queue(vkb::QueueType::graphics).value();
+
+	_graphicsQueueFamily = vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
+
+	// culling goes to a compute family without graphics when the device exposes one,
+	// otherwise it is submitted to the graphics queue and only loses the overlap
+	auto computeQueue = vkbDevice.get_queue(vkb::QueueType::compute);
+	if (computeQueue) {
+		_computeQueue = computeQueue.value();
+		_computeQueueFamily = vkbDevice.get_queue_index(vkb::QueueType::compute).value();
+	}
+	else {
+		_computeQueue = _graphicsQueue;
+		_computeQueueFamily = _graphicsQueueFamily;
+	}
+
+	VmaVulkanFunctions vulkanFunctions = {};
+	vulkanFunctions.vkGetInstanceProcAddr = &vkGetInstanceProcAddr;
+	vulkanFunctions.vkGetDeviceProcAddr = &vkGetDeviceProcAddr;
+
+	VmaAllocatorCreateInfo allocatorInfo = {};
+	allocatorInfo.physicalDevice = _chosenGPU;
+	allocatorInfo.device = _device;
+	allocatorInfo.instance = _instance;
+	allocatorInfo.pVulkanFunctions = &vulkanFunctions;
+	vmaCreateAllocator(&allocatorInfo, &_allocator);
+
+	_mainDeletionQueue.push_function([&]() {
+		vmaDestroyAllocator(_allocator);
+		});
+
+	vkGetPhysicalDeviceProperties(_chosenGPU, &_gpuProperties);
+
+}
+
+void VulkanEngine::init_swapchain()
+{
+	vkb::SwapchainBuilder swapchainBuilder{_chosenGPU, _device, _surface };
+
+	vkb::Swapchain vkbSwapchain = swapchainBuilder
+		.use_default_format_selection()
+		.set_desired_present_mode(_presentMode)
+		// one image more than frames in flight so acquire does not stall on the ring
+		.set_desired_min_image_count(_frames.size() + 1)
+		.set_desired_extent(_windowExtent.width, _windowExtent.height)
+		.build()
+		.value();
+
+	_swapchain = vkbSwapchain.swapchain;
+	_swapchainImages = vkbSwapchain.get_images().value();
+	_swapchainImageViews = vkbSwapchain.get_image_views().value();
+
+	_swachainImageFormat = vkbSwapchain.image_format;
+
+	if (vkbSwapchain.present_mode != _presentMode) {
+		std::cout << "Present mode " << present_mode_name(_presentMode) << " is not supported, using " << present_mode_name(vkbSwapchain.present_mode) << std::endl;
+		_presentMode = vkbSwapchain.present_mode;
+	}
+
+	_mainDeletionQueue.push_function([=]() {
+		vkDestroySwapchainKHR(_device, _swapchain, nullptr);
+		});
+
+	_depthFormat = VK_FORMAT_D32_SFLOAT;
+	_shadowMapFormat = VK_FORMAT_R8G8B8A8_SRGB;
+}
+
+void VulkanEngine::init_render_graph()
+{
+	_renderGraph.init(_device, _allocator);
+
+	// the multisampled targets are resolved and discarded inside the main pass, so the graph
+	// makes them transient attachments that tilers can keep entirely in on-chip memory
+	vkutil::RenderGraph::ImageDesc colorTargetInfo;
+	colorTargetInfo.format = _swachainImageFormat;
+	colorTargetInfo.extent = _windowExtent;
+	colorTargetInfo.samples = _msaaSamples;
+	vkutil::RenderGraph::Resource colorTarget = _renderGraph.create_image("msaa color", colorTargetInfo);
+
+	vkutil::RenderGraph::ImageDesc depthTargetInfo;
+	depthTargetInfo.format = _depthFormat;
+	depthTargetInfo.extent = _windowExtent;
+	depthTargetInfo.samples = _msaaSamples;
+	vkutil::RenderGraph::Resource depthTarget = _renderGraph.create_image("msaa depth", depthTargetInfo);
+
+	// sized for full resolution, frames rendered at a lower scale only use its top left corner
+	vkutil::RenderGraph::ImageDesc sceneColorInfo;
+	sceneColorInfo.format = _swachainImageFormat;
+	sceneColorInfo.extent = _windowExtent;
+	vkutil::RenderGraph::Resource sceneColor = _renderGraph.create_image("scene color", sceneColorInfo);
+
+	vkutil::RenderGraph::ImageDesc shadowMapInfo;
+	shadowMapInfo.format = _depthFormat;
+	shadowMapInfo.extent = _shadowExtent;
+	shadowMapInfo.layers = SHADOW_MAP_CASCADE_COUNT;
+	_shadowMapResource = _renderGraph.create_image("shadow map", shadowMapInfo);
+
+	// one resource stands in for every swapchain image, the framebuffers pick the acquired one
+	vkutil::RenderGraph::Resource swapchain = _renderGraph.import_image("swapchain", _swachainImageFormat, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	_renderGraph.mark_output(swapchain);
+
+	// nothing samples the gbuffer yet, so the pass is dropped and its targets never allocated
+	_gBufferGraphPass = _renderGraph.add_pass("gbuffer");
+
+	vkutil::RenderGraph::ImageDesc gBufferTargetInfo;
+	gBufferTargetInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+	gBufferTargetInfo.extent = _gBufferExtent;
+	for (uint32_t i = 0; i < 5; i++) {
+		_renderGraph.write_color(_gBufferGraphPass, _renderGraph.create_image("gbuffer", gBufferTargetInfo), true);
+	}
+
+	vkutil::RenderGraph::ImageDesc gBufferDepthInfo;
+	gBufferDepthInfo.format = _depthFormat;
+	gBufferDepthInfo.extent = _gBufferExtent;
+	_renderGraph.write_depth(_gBufferGraphPass, _renderGraph.create_image("gbuffer depth", gBufferDepthInfo), true);
+
+	// drawn once per cascade, each time into its own layer
+	_shadowGraphPass = _renderGraph.add_pass("shadow");
+	_renderGraph.write_depth(_shadowGraphPass, _shadowMapResource, true);
+
+	_mainGraphPass = _renderGraph.add_pass("main");
+	_renderGraph.write_color(_mainGraphPass, colorTarget, true);
+	_renderGraph.write_depth(_mainGraphPass, depthTarget, true);
+	_renderGraph.write_resolve(_mainGraphPass, sceneColor);
+	_renderGraph.read_texture(_mainGraphPass, _shadowMapResource, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+	_upscaleGraphPass = _renderGraph.add_pass("upscale");
+	_renderGraph.read_texture(_upscaleGraphPass, sceneColor, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	_renderGraph.write_color(_upscaleGraphPass, swapchain, true);
+
+	if (!_renderGraph.compile()) {
+		std::cout << "Failed to compile the render graph" << std::endl;
+		abort();
+	}
+
+	_gBufferPass = _renderGraph.render_pass(_gBufferGraphPass);
+	_depthPass = _renderGraph.render_pass(_shadowGraphPass);
+	_renderPass = _renderGraph.render_pass(_mainGraphPass);
+	_upscalePass = _renderGraph.render_pass(_upscaleGraphPass);
+
+	_colorImageView = _renderGraph.image_view(colorTarget);
+	_depthImageView = _renderGraph.image_view(depthTarget);
+	_depthView = _renderGraph.image_view(_shadowMapResource);
+	_sceneColorView = _renderGraph.image_view(sceneColor);
+
+	_renderExtent = _windowExtent;
+
+	_mainDeletionQueue.push_function([=]() {
+		_renderGraph.cleanup();
+		});
+}
+
+
+void VulkanEngine::init_framebuffers()
+{
+	// full size, the render area picks the part the current render scale uses
+	VkFramebufferCreateInfo scene_fb_info = vkinit::framebuffer_create_info(_renderPass, _windowExtent);
+
+	VkImageView sceneAttachments[3];
+	sceneAttachments[0] = _colorImageView;
+	sceneAttachments[1] = _depthImageView;
+	sceneAttachments[2] = _sceneColorView;
+
+	scene_fb_info.pAttachments = sceneAttachments;
+	scene_fb_info.attachmentCount = 3;
+
+	VK_CHECK(vkCreateFramebuffer(_device, &scene_fb_info, nullptr, &_sceneFramebuffer));
+
+	_mainDeletionQueue.push_function([=]() {
+		vkDestroyFramebuffer(_device, _sceneFramebuffer, nullptr);
+		});
+
+	VkFramebufferCreateInfo fb_info = vkinit::framebuffer_create_info(_upscalePass, _windowExtent);
+
+	const uint32_t swapchain_imagecount = _swapchainImages.size();
+	_framebuffers = std::vector<VkFramebuffer>(swapchain_imagecount);
+
+
+	for (int i = 0; i < swapchain_imagecount; i++) {
+		fb_info.pAttachments = &_swapchainImageViews[i];
+		fb_info.attachmentCount = 1;
+
+		VK_CHECK(vkCreateFramebuffer(_device, &fb_info, nullptr, &_framebuffers[i]));
+
+		_mainDeletionQueue.push_function([=]() {
+			vkDestroyFramebuffer(_device, _framebuffers[i], nullptr);
+			vkDestroyImageView(_device, _swapchainImageViews[i], nullptr);
+			});
+	}
+
+}
+
+void VulkanEngine::init_commands()
+{
+	// the render thread takes part in the pool while it waits, so leave it a core of its own. The pool
+	// is only started by render_loop, until then parallel loops run on the calling thread
+	uint32_t hardwareThreads = std::thread::hardware_concurrency();
+	_workerThreadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+
+	VkCommandPoolCreateInfo commandPoolInfo = vkinit::command_pool_create_info(_graphicsQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+	VkCommandPoolCreateInfo computePoolInfo = vkinit::command_pool_create_info(_computeQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+	// secondaries are reset a whole pool at a time in wait_for_drawing
+	VkCommandPoolCreateInfo workerPoolInfo = vkinit::command_pool_create_info(_graphicsQueueFamily, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+
+	for (int i = 0; i < _frames.size(); i++) {
+
+		_frames[i].arena.init(FRAME_ARENA_SIZE);
+
+		VK_CHECK(vkCreateCommandPool(_device, &computePoolInfo, nullptr, &_frames[i]._cullCommandPool));
+		VK_CHECK(vkCreateCommandPool(_device, &computePoolInfo, nullptr, &_frames[i]._cullShadowCommandPool));
+		VK_CHECK(vkCreateCommandPool(_device, &commandPoolInfo, nullptr, &_frames[i]._commandPool));
+		VK_CHECK(vkCreateCommandPool(_device, &commandPoolInfo, nullptr, &_frames[i]._shadowCommandPool));
+
+
+		VkCommandBufferAllocateInfo cmdAllocInfo; 
+		cmdAllocInfo = vkinit::command_buffer_allocate_info(_frames[i]._cullCommandPool, 1);
+		VK_CHECK(vkAllocateCommandBuffers(_device, &cmdAllocInfo, &_frames[i]._cullCommandBuffer));
+
+		cmdAllocInfo = vkinit::command_buffer_allocate_info(_frames[i]._cullShadowCommandPool, 1);
+		VK_CHECK(vkAllocateCommandBuffers(_device, &cmdAllocInfo, &_frames[i]._cullShadowCommandBuffer));
+
+		cmdAllocInfo = vkinit::command_buffer_allocate_info(_frames[i]._commandPool, 1);
+		VK_CHECK(vkAllocateCommandBuffers(_device, &cmdAllocInfo, &_frames[i]._mainCommandBuffer));
+		VK_CHECK(vkAllocateCommandBuffers(_device, &cmdAllocInfo, &_frames[i]._uploadCommandBuffer));
+
+		cmdAllocInfo = vkinit::command_buffer_allocate_info(_frames[i]._shadowCommandPool, 1);
+		VK_CHECK(vkAllocateCommandBuffers(_device, &cmdAllocInfo, &_frames[i]._shadowCommandBuffer));
+
+		// the record-once buffers come from the pool of the pass they replace, the two passes record on different threads
+		cmdAllocInfo = vkinit::command_buffer_allocate_info(_frames[i]._shadowCommandPool, 1);
+		VK_CHECK(vkAllocateCommandBuffers(_device, &cmdAllocInfo, &_frames[i]._staticShadowCommandBuffer));
+
+		_frames[i]._staticMainCommandBuffers.resize(_swapchainImages.size());
+		_frames[i]._staticMainVersions.assign(_swapchainImages.size(), 0);
+		cmdAllocInfo = vkinit::command_buffer_allocate_info(_frames[i]._commandPool, _swapchainImages.size());
+		VK_CHECK(vkAllocateCommandBuffers(_device, &cmdAllocInfo, _frames[i]._staticMainCommandBuffers.data()));
+
+		_frames[i]._workerCommands.resize(_workerThreadCount + 1);
+		for (WorkerCommands& worker : _frames[i]._workerCommands) {
+			VK_CHECK(vkCreateCommandPool(_device, &workerPoolInfo, nullptr, &worker.pool));
+		}
+
+	}
+
+
+	VkCommandPoolCreateInfo uploadCommandPoolInfo = vkinit::command_pool_create_info(_graphicsQueueFamily);
+	VK_CHECK(vkCreateCommandPool(_device, &uploadCommandPoolInfo, nullptr, &_uploadContext._commandPool));
+
+	_mainDeletionQueue.push_function([=]() {
+		vkDestroyCommandPool(_device, _uploadContext._commandPool, nullptr);
+		for (int i = 0; i < _frames.size(); i++) {
+		vkDestroyCommandPool(_device, _frames[i]._cullCommandPool, nullptr);
+		vkDestroyCommandPool(_device, _frames[i]._cullShadowCommandPool, nullptr);
+		vkDestroyCommandPool(_device, _frames[i]._commandPool, nullptr);
+		vkDestroyCommandPool(_device, _frames[i]._shadowCommandPool, nullptr);
+		for (WorkerCommands& worker : _frames[i]._workerCommands) {
+			vkDestroyCommandPool(_device, worker.pool, nullptr);
+		}
+		}
+	});
+
+	VkCommandBufferAllocateInfo cmdAllocInfo = vkinit::command_buffer_allocate_info(_uploadContext._commandPool, 1);
+
+	VK_CHECK(vkAllocateCommandBuffers(_device, &cmdAllocInfo, &_uploadContext._commandBuffer));
+}
+
+void VulkanEngine::init_sync_structures()
+{
+	VkSemaphoreCreateInfo semaphoreCreateInfo = vkinit::semaphore_create_info();
+
+	VkSemaphoreTypeCreateInfo timelineCreateInfo = {};
+	timelineCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	timelineCreateInfo.pNext = nullptr;
+	timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timelineCreateInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo timelineSemaphoreInfo = vkinit::semaphore_create_info();
+	timelineSemaphoreInfo.pNext = &timelineCreateInfo;
+
+	VK_CHECK(vkCreateSemaphore(_device, &timelineSemaphoreInfo, nullptr, &_frameTimeline));
+	VK_CHECK(vkCreateSemaphore(_device, &timelineSemaphoreInfo, nullptr, &_cullTimeline));
+
+	_mainDeletionQueue.push_function([=]() {
+		vkDestroySemaphore(_device, _frameTimeline, nullptr);
+		vkDestroySemaphore(_device, _cullTimeline, nullptr);
+		});
+
+	// without timestamps on the graphics queue there is nothing to drive the render scale
+	if (!_gpuProperties.limits.timestampComputeAndGraphics) {
+		_gpuFrameBudget = 0.0f;
+	}
+
+	VkQueryPoolCreateInfo queryPoolInfo = {};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.pNext = nullptr;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = 2;
+
+	for (int i = 0; i < _frames.size(); i++) {
+
+		VK_CHECK(vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &_frames[i]._presentSemaphore));
+		VK_CHECK(vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &_frames[i]._renderSemaphore));
+		VK_CHECK(vkCreateQueryPool(_device, &queryPoolInfo, nullptr, &_frames[i].timestampPool));
+
+		_mainDeletionQueue.push_function([=]() {
+			vkDestroySemaphore(_device, _frames[i]._presentSemaphore, nullptr);
+			vkDestroySemaphore(_device, _frames[i]._renderSemaphore, nullptr);
+			vkDestroyQueryPool(_device, _frames[i].timestampPool, nullptr);
+			});
+	}
+
+
+	VkFenceCreateInfo uploadFenceCreateInfo = vkinit::fence_create_info();
+
+	VK_CHECK(vkCreateFence(_device, &uploadFenceCreateInfo, nullptr, &_uploadContext._uploadFence));
+	_mainDeletionQueue.push_function([=]() {
+		vkDestroyFence(_device, _uploadContext._uploadFence, nullptr);
+		});
+}
+
+void VulkanEngine::init_pipelines()
+{
+
+
+	PipelineBuilder pipelineBuilder;
+
+	VkPipelineLayoutCreateInfo mesh_pipeline_layout_info = vkinit::pipeline_layout_create_info();
+
+	VkPipelineLayoutCreateInfo scene_pipeline_layout_info = mesh_pipeline_layout_info;
+	VkDescriptorSetLayout sceneLayouts[] = { _globalSetLayout, _cascadesSetLayout, _objectSetLayout, _csmSetLayout, _bindlessTextureSetLayout, _feedbackSetLayout };
+
+	scene_pipeline_layout_info.setLayoutCount = 6;
+	scene_pipeline_layout_info.pSetLayouts = sceneLayouts;
+
+	VkPipelineLayout scenePipeLayout;
+	VK_CHECK(vkCreatePipelineLayout(_device, &scene_pipeline_layout_info, nullptr, &scenePipeLayout));
+
+	VkPipelineLayoutCreateInfo textured_specular_pipeline_layout_info = mesh_pipeline_layout_info;
+
+	VkPipelineLayoutCreateInfo shadow_pipeline_layout_info = mesh_pipeline_layout_info;
+	VkDescriptorSetLayout shadowSetLayouts[] = { _lightSetLayout, _objectSetLayout };
+
+	shadow_pipeline_layout_info.setLayoutCount = 2;
+	shadow_pipeline_layout_info.pSetLayouts = shadowSetLayouts;
+
+	VkPipelineLayout shadowPipeLayout;
+	VK_CHECK(vkCreatePipelineLayout(_device, &shadow_pipeline_layout_info, nullptr, &shadowPipeLayout));
+
+	VkPipelineLayoutCreateInfo skybox_pipeline_layout_info = mesh_pipeline_layout_info;
+	VkDescriptorSetLayout skyboxSetLayouts[] = { _globalSetLayout, _skyboxSetLayout };
+
+	skybox_pipeline_layout_info.setLayoutCount = 2;
+	skybox_pipeline_layout_info.pSetLayouts = skyboxSetLayouts;
+
+	VkPipelineLayout skyboxPipeLayout;
+	VK_CHECK(vkCreatePipelineLayout(_device, &skybox_pipeline_layout_info, nullptr, &skyboxPipeLayout));
+
+	VkPipelineLayoutCreateInfo upscale_pipeline_layout_info = mesh_pipeline_layout_info;
+
+	VkPushConstantRange upscale_push_constant;
+	upscale_push_constant.offset = 0;
+	upscale_push_constant.size = sizeof(UpscaleConstants);
+	upscale_push_constant.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	upscale_pipeline_layout_info.setLayoutCount = 1;
+	upscale_pipeline_layout_info.pSetLayouts = &_upscaleSetLayout;
+	upscale_pipeline_layout_info.pushConstantRangeCount = 1;
+	upscale_pipeline_layout_info.pPushConstantRanges = &upscale_push_constant;
+
+	VkPipelineLayout upscalePipeLayout;
+	VK_CHECK(vkCreatePipelineLayout(_device, &upscale_pipeline_layout_info, nullptr, &upscalePipeLayout));
+
+	pipelineBuilder._vertexInputInfo = vkinit::vertex_input_state_create_info();
+
+
+	pipelineBuilder._inputAssembly = vkinit::input_assembly_create_info(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+
+	pipelineBuilder._rasterizer = vkinit::rasterization_state_create_info(VK_POLYGON_MODE_FILL);
+	pipelineBuilder._rasterizer.cullMode = VK_CULL_MODE_NONE;
+
+	pipelineBuilder._multisampling = vkinit::multisampling_state_create_info(_msaaSamples);
+
+	pipelineBuilder._colorBlendAttachment.push_back(vkinit::color_blend_attachment_state());
+
+	pipelineBuilder._depthStencil = vkinit::depth_stencil_create_info(true, true, VK_COMPARE_OP_LESS_OR_EQUAL);
+
+
+	VertexInputDescription vertexDescription = Vertex::get_vertex_description();
+
+	pipelineBuilder._vertexInputInfo.pVertexAttributeDescriptions = vertexDescription.attributes.data();
+	pipelineBuilder._vertexInputInfo.vertexAttributeDescriptionCount = vertexDescription.attributes.size();
+
+	pipelineBuilder._vertexInputInfo.pVertexBindingDescriptions = vertexDescription.bindings.data();
+	pipelineBuilder._vertexInputInfo.vertexBindingDescriptionCount = vertexDescription.bindings.size();
+
+	VkShaderModule meshVertShader;
+	if (!load_shader_module("shaders/shader.vert.spv", &meshVertShader))
+	{
+		std::cout << "Error when building the mesh vertex shader module" << std::endl;
+	}
+
+	VkShaderModule sceneShader;
+	if (!load_shader_module("shaders/scene_shader.frag.spv", &sceneShader))
+	{
+		std::cout << "Error when building the scene shader module" << std::endl;
+	}
+	
+	pipelineBuilder._shaderStages.clear();
+	pipelineBuilder._shaderStages.push_back(
+		vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_VERTEX_BIT, meshVertShader));
+
+	pipelineBuilder._shaderStages.push_back(
+		vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT, sceneShader));
+	pipelineBuilder._pipelineLayout = scenePipeLayout;
+	VkPipeline scenePipeline = pipelineBuilder.build_pipeline(_device, _renderPass);
+	for (auto name : TEXTURE_NAMES) {
+		create_material(scenePipeline, scenePipeLayout, name);
+	}
+	
+	VkShaderModule skyboxVertShader;
+	if (!load_shader_module("shaders/skybox_shader.vert.spv", &skyboxVertShader))
+	{
+		std::cout << "Error when building the skybox vertex shader module" << std::endl;
+	}
+
+	VkShaderModule skyboxShader;
+	if (!load_shader_module("shaders/skybox_shader.frag.spv", &skyboxShader))
+	{
+		std::cout << "Error when building the skyboxshader module" << std::endl;
+	}
+
+	// fullscreen triangle at the far plane, only the pixels no geometry covered pass the equal test
+	PipelineBuilder skyboxBuilder = pipelineBuilder;
+	skyboxBuilder._vertexInputInfo = vkinit::vertex_input_state_create_info();
+	skyboxBuilder._depthStencil = vkinit::depth_stencil_create_info(true, false, VK_COMPARE_OP_EQUAL);
+
+	skyboxBuilder._shaderStages.clear();
+	skyboxBuilder._shaderStages.push_back(
+		vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_VERTEX_BIT, skyboxVertShader));
+
+	skyboxBuilder._shaderStages.push_back(
+		vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT, skyboxShader));
+	skyboxBuilder._pipelineLayout = skyboxPipeLayout;
+	VkPipeline skyboxPipeline = skyboxBuilder.build_pipeline(_device, _renderPass);
+	create_material(skyboxPipeline, skyboxPipeLayout, "skybox");
+
+	VkShaderModule upscaleVertShader;
+	if (!load_shader_module("shaders/upscale.vert.spv", &upscaleVertShader))
+	{
+		std::cout << "Error when building the upscale vertex shader module" << std::endl;
+	}
+
+	VkShaderModule upscaleShader;
+	if (!load_shader_module("shaders/upscale.frag.spv", &upscaleShader))
+	{
+		std::cout << "Error when building the upscale shader module" << std::endl;
+	}
+
+	// fullscreen triangle onto the swapchain, sampling the part of the scene color this frame rendered
+	PipelineBuilder upscaleBuilder = pipelineBuilder;
+	upscaleBuilder._vertexInputInfo = vkinit::vertex_input_state_create_info();
+	upscaleBuilder._multisampling = vkinit::multisampling_state_create_info(VK_SAMPLE_COUNT_1_BIT);
+	upscaleBuilder._depthStencil = vkinit::depth_stencil_create_info(false, false, VK_COMPARE_OP_ALWAYS);
+
+	upscaleBuilder._shaderStages.clear();
+	upscaleBuilder._shaderStages.push_back(
+		vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_VERTEX_BIT, upscaleVertShader));
+
+	upscaleBuilder._shaderStages.push_back(
+		vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT, upscaleShader));
+	upscaleBuilder._pipelineLayout = upscalePipeLayout;
+	VkPipeline upscalePipeline = upscaleBuilder.build_pipeline(_device, _upscalePass);
+	create_material(upscalePipeline, upscalePipeLayout, "upscale");
+
+
+	pipelineBuilder._multisampling = vkinit::multisampling_state_create_info(VK_SAMPLE_COUNT_1_BIT);
+
+	VkShaderModule directDepthShader;
+	if (!load_shader_module("shaders/depth_shader.vert.spv", &directDepthShader))
+	{
+		std::cout << "Error when building the depthshader module" << std::endl;
+	}
+	pipelineBuilder._shaderStages.clear();
+	pipelineBuilder._shaderStages.push_back(
+		vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_VERTEX_BIT, directDepthShader));
+
+
+	pipelineBuilder._pipelineLayout = shadowPipeLayout;
+	pipelineBuilder._rasterizer.cullMode = VK_CULL_MODE_NONE;
+	VkPipeline depthPipeline = pipelineBuilder.build_pipeline(_device, _depthPass);
+	create_material(depthPipeline, shadowPipeLayout, "directDepth");
+
+
+	vkDestroyShaderModule(_device, meshVertShader, nullptr);
+	vkDestroyShaderModule(_device, skyboxVertShader, nullptr);
+	vkDestroyShaderModule(_device, skyboxShader, nullptr);
+	vkDestroyShaderModule(_device, upscaleVertShader, nullptr);
+	vkDestroyShaderModule(_device, upscaleShader, nullptr);
+	vkDestroyShaderModule(_device, sceneShader, nullptr);
+	vkDestroyShaderModule(_device, directDepthShader, nullptr);
+
+
+	_mainDeletionQueue.push_function([=]() {
+		vkDestroyPipeline(_device, skyboxPipeline, nullptr);
+		vkDestroyPipeline(_device, upscalePipeline, nullptr);
+		vkDestroyPipeline(_device, depthPipeline, nullptr);
+		vkDestroyPipeline(_device, scenePipeline, nullptr);
+
+
+		vkDestroyPipelineLayout(_device, shadowPipeLayout, nullptr);
+		vkDestroyPipelineLayout(_device, scenePipeLayout, nullptr);
+		vkDestroyPipelineLayout(_device, skyboxPipeLayout, nullptr);
+		vkDestroyPipelineLayout(_device, upscalePipeLayout, nullptr);
+		});
+
+	if (!load_compute_shader("shaders/compute_culling.comp.spv"))
+	{
+		std::cout << "Error when building the culling shader module" << std::endl;
+	}
+}
+
+bool VulkanEngine::load_compute_shader(const char* shaderPath)
+{
+	VkShaderModule computeModule;
+	if (!load_shader_module(shaderPath, &computeModule))
+
+	{
+		std::cout << "Error when building compute shader shader module" << std::endl;
+		return false;
+	}
+
+	VkPipelineLayoutCreateInfo compute_pipeline_layout_info = vkinit::pipeline_layout_create_info();
+
+	VkPushConstantRange push_constant;
+	push_constant.offset = 0;
+	push_constant.size = sizeof(CullConstants);
+	push_constant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayout setLayouts[] = { _cullSetLayout };
+	compute_pipeline_layout_info.setLayoutCount = 1;
+	compute_pipeline_layout_info.pSetLayouts = setLayouts;
+	compute_pipeline_layout_info.pPushConstantRanges = &push_constant;
+	compute_pipeline_layout_info.pushConstantRangeCount = 1;
+
+	VkPipelineLayout computePipeLayout;
+	VK_CHECK(vkCreatePipelineLayout(_device, &compute_pipeline_layout_info, nullptr, &computePipeLayout));
+
+	ComputePipelineBuilder computeBuilder;
+
+	computeBuilder._pipelineLayout = computePipeLayout;
+	computeBuilder._shaderStage = vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_COMPUTE_BIT, computeModule);
+
+	VkPipeline computePipeline = computeBuilder.build_pipeline(_device);
+
+	create_material(computePipeline, computePipeLayout, "culling");
+
+	vkDestroyShaderModule(_device, computeModule, nullptr);
+
+	_mainDeletionQueue.push_function([=]() {
+		vkDestroyPipeline(_device, computePipeline, nullptr);
+
+		vkDestroyPipelineLayout(_device, computePipeLayout, nullptr);
+		});
+
+	return true;
+}
+
+bool VulkanEngine::load_shader_module(const char* filePath, VkShaderModule* outShaderModule)
+{
+	std::ifstream file(filePath, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open()) {
+		return false;
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+
+	std::vector<uint32_t> buffer(fileSize / sizeof(uint32_t));
+
+	file.seekg(0);
+
+	file.read((char*)buffer.data(), fileSize);
+
+	file.close();
+
+	VkShaderModuleCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.pNext = nullptr;
+
+	createInfo.codeSize = buffer.size() * sizeof(uint32_t);
+	createInfo.pCode = buffer.data();
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(_device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		return false;
+	}
+	*outShaderModule = shaderModule;
+	return true;
+}
+
+VkPipeline ComputePipelineBuilder::build_pipeline(VkDevice device)
+{
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.layout = _pipelineLayout;
+	pipelineInfo.stage = _shaderStage;
+
+	VkPipeline newPipeline;
+	if (vkCreateComputePipelines(
+		device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &newPipeline) != VK_SUCCESS) {
+		std::cout << "failed to create pipline\n";
+		return VK_NULL_HANDLE;
+	}
+	else
+	{
+		return newPipeline;
+	}
+}
+
+VkPipeline PipelineBuilder::build_pipeline(VkDevice device, VkRenderPass pass)
+{
+
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.pNext = nullptr;
+
+	// set when recording, so a new render extent needs no new pipelines
+	viewportState.viewportCount = 1;
+	viewportState.pViewports = nullptr;
+	viewportState.scissorCount = 1;
+	viewportState.pScissors = nullptr;
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.pNext = nullptr;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending = {};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.pNext = nullptr;
+
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.logicOp = VK_LOGIC_OP_COPY;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &_colorBlendAttachment[0];
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.pNext = nullptr;
+
+	pipelineInfo.stageCount = _shaderStages.size();
+	pipelineInfo.pStages = _shaderStages.data();
+	pipelineInfo.pVertexInputState = &_vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &_inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &_rasterizer;
+	pipelineInfo.pMultisampleState = &_multisampling;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDepthStencilState = &_depthStencil;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = _pipelineLayout;
+	pipelineInfo.renderPass = pass;
+	pipelineInfo.subpass = 0;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	VkPipeline newPipeline;
+	if (vkCreateGraphicsPipelines(
+		device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &newPipeline) != VK_SUCCESS) {
+		std::cout << "failed to create pipline\n";
+		return VK_NULL_HANDLE; 
+	}
+	else
+	{
+		return newPipeline;
+	}
+}
+
+VkPipeline PipelineBuilder::build_pipeline(VkDevice device, VkRenderPass pass, int size)
+{
+
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.pNext = nullptr;
+
+	// set when recording, so a new render extent needs no new pipelines
+	viewportState.viewportCount = 1;
+	viewportState.pViewports = nullptr;
+	viewportState.scissorCount = 1;
+	viewportState.pScissors = nullptr;
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.pNext = nullptr;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending = {};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.pNext = nullptr;
+
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.logicOp = VK_LOGIC_OP_COPY;
+	colorBlending.attachmentCount = size;
+	colorBlending.pAttachments = &_colorBlendAttachment[0];
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.pNext = nullptr;
+
+	pipelineInfo.stageCount = _shaderStages.size();
+	pipelineInfo.pStages = _shaderStages.data();
+	pipelineInfo.pVertexInputState = &_vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &_inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &_rasterizer;
+	pipelineInfo.pMultisampleState = &_multisampling;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDepthStencilState = &_depthStencil;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = _pipelineLayout;
+	pipelineInfo.renderPass = pass;
+	pipelineInfo.subpass = 0;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	VkPipeline newPipeline;
+	if (vkCreateGraphicsPipelines(
+		device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &newPipeline) != VK_SUCCESS) {
+		std::cout << "failed to create pipline\n";
+		return VK_NULL_HANDLE;
+	}
+	else
+	{
+		return newPipeline;
+	}
+}
+
+void VulkanEngine::load_meshes()
+{
+	Mesh floor{};
+	floor._vertices.resize(6);
+
+	floor._vertices[0].position = { 50.f, -0.1f, -50.0f };
+	floor._vertices[1].position = { -50.f, -0.1f, -50.0f };
+	floor._vertices[2].position = { 50.f, -0.1f, 50.0f };
+
+	floor._vertices[0].uv = { 0.0f, 0.05f };
+	floor._vertices[1].uv = { 0.05f, 0.05f };
+	floor._vertices[2].uv = { 0.0f, 0.0f };
+
+	floor._vertices[0].normal = { 0.f,1.f, 0.0f };
+	floor._vertices[1].normal = { 0.f,1.f, 0.0f };
+	floor._vertices[2].normal = { 0.f,1.f, 0.0f };
+
+	floor._vertices[0].color = { 1.f,1.f, 1.0f };
+	floor._vertices[1].color = { 1.f,1.f, 1.0f };
+	floor._vertices[2].color = { 1.f,1.f, 1.0f };
+
+	floor._vertices[3].position = { 50.f, -0.1f, 50.0f };
+	floor._vertices[4].position = { -50.f,-0.1f, -50.0f };
+	floor._vertices[5].position = { -50.f, -0.1f, 50.0f };
+
+	floor._vertices[3].uv = { 0.0f, 0.0f };
+	floor._vertices[4].uv = { 0.05f, 0.05f };
+	floor._vertices[5].uv = { 0.05f, 0.0f };
+
+	floor._vertices[3].normal = { 0.f,1.f, 0.0f };
+	floor._vertices[4].normal = { 0.f,1.f, 0.0f };
+	floor._vertices[5].normal = { 0.f,1.f, 0.0f };
+
+	floor._vertices[3].color = { 1.0f,1.0f, 1.0f };
+	floor._vertices[4].color = { 1.0f,1.0f, 1.0f };
+	floor._vertices[5].color = { 1.0f,1.0f, 1.0f };
+
+	floor.sphereBound = { glm::vec3{0.0f,-0.1f,0.0f},glm::sqrt(100.0f * 100.0f * 2.0f) };
+
+	upload_mesh(floor);
+	_meshes["floor"] = std::move(floor);
+	
+	Meshes nyCity{};
+	nyCity.load_from_obj("./assets/NY_City/City Block OBJ/City block.obj");
+
+	for (Mesh& m : nyCity._meshes) {
+		upload_mesh(m);
+		std::string name = m.name;
+		_meshes[name] = std::move(m);
+	}
+}
+
+void VulkanEngine::load_images()
+{
+	for (int i = 0; i < TEXTURE_PATHS.size(); i++) {
+
+		Texture tex;
+		tex.path = TEXTURE_PATHS[i];
+		tex.index = i;
+		tex.streamed = true;
+
+		vkutil::ImageFileInfo info;
+		if (!vkutil::query_image_info(tex.path, info)) {
+			continue;
+		}
+
+		tex.width = info.width;
+		tex.height = info.height;
+		tex.mipLevels = info.mipLevels;
+
+		uint32_t baseMip = 0;
+		if (tex.streamed) {
+			while (baseMip + 1 < tex.mipLevels && std::max(tex.width, tex.height) >> baseMip > _textureResidentExtent) {
+				baseMip++;
+			}
+		}
+
+		tex.residentMip = baseMip;
+		tex.lowestResidentMip = baseMip;
+		tex.requestedMip = baseMip;
+		tex.windowMip = baseMip;
+		tex.targetMip = baseMip;
+
+		vkutil::load_image_mip_from_file(*this, tex.path, baseMip, tex.image);
+		tex.image._sampler = vkutil::create_texture_sampler(*this, VK_LOD_CLAMP_NONE);
+
+		VkImageViewCreateInfo imageinfo = vkinit::imageview_create_info(VK_FORMAT_R8G8B8A8_SRGB, tex.image._image, VK_IMAGE_ASPECT_COLOR_BIT, tex.image._mipLevels);
+		vkCreateImageView(_device, &imageinfo, nullptr, &tex.imageView);
+
+		std::cout << "Texture loaded succesfully " << tex.path << " at mip " << baseMip << std::endl;
+
+		_loadedTextures[TEXTURE_NAMES[i]] = tex;
+	}
+
+	if (vkutil::load_cubemap_from_files(*this, SKYBOX_FACES, _skyboxImage)) {
+		VkImageViewCreateInfo skyboxinfo = vkinit::imageview_create_info(VK_FORMAT_R8G8B8A8_SRGB, _skyboxImage._image, VK_IMAGE_ASPECT_COLOR_BIT, _skyboxImage._mipLevels);
+		skyboxinfo.viewType = VK_IMAGE_VIEW_TYPE_CUBE;
+		skyboxinfo.subresourceRange.layerCount = 6;
+		vkCreateImageView(_device, &skyboxinfo, nullptr, &_skyboxImageView);
+
+		_mainDeletionQueue.push_function([=]() {
+			vkDestroyImageView(_device, _skyboxImageView, nullptr);
+			vmaDestroyImage(_allocator, _skyboxImage._image, _skyboxImage._allocation);
+			});
+	}
+	else {
+		std::cout << "Skybox not loaded, the scene is drawn without it" << std::endl;
+	}
+
+	_mainDeletionQueue.push_function([=]() {
+		for (auto& it : _loadedTextures) {
+			vkDestroyImageView(_device, it.second.imageView, nullptr);
+			vmaDestroyImage(_allocator, it.second.image._image, it.second.image._allocation);
+		}
+		});
+}
+
+size_t VulkanEngine::texture_memory_size(const Texture& texture, uint32_t baseMip)
+{
+	size_t size = 0;
+	for (uint32_t mip = baseMip; mip < texture.mipLevels; mip++) {
+		size += size_t(std::max(texture.width >> mip, 1u)) * std::max(texture.height >> mip, 1u) * 4;
+	}
+	return size;
+}
+
+void VulkanEngine::update_texture_streaming()
+{
+	FrameData& frame = get_current_frame();
+
+	for (Texture* texture : frame.staleTextures) {
+		write_bindless_texture(frame, *texture);
+	}
+	frame.staleTextures.clear();
+
+	// the slot's last submission has finished, so its upload buffer can be recorded again
+	frame.uploadsRecorded = false;
+	for (TextureStream& stream : _textureStreams) {
+		if (stream.texture && stream.done.load(std::memory_order_acquire)) {
+			finish_texture_stream(frame, stream);
+		}
+	}
+	if (frame.uploadsRecorded) {
+		VK_CHECK(vkEndCommandBuffer(frame._uploadCommandBuffer));
+	}
+
+	vmaInvalidateAllocation(_allocator, frame.feedbackBuffer._allocation, 0, VK_WHOLE_SIZE);
+
+	BufferSpan<uint32_t> requests = frame.feedbackBuffer.span<uint32_t>();
+
+	bool closeWindow = _frameNumber % TEXTURE_STREAMING_WINDOW == 0;
+	size_t totalSize = 0;
+
+	for (auto& it : _loadedTextures) {
+		Texture& tex = it.second;
+		if (!tex.streamed) {
+			continue;
+		}
+
+		// finer requests are honoured right away, coarser ones only once a whole window went by without them
+		uint32_t request = std::min(requests[tex.index], tex.lowestResidentMip);
+		tex.windowMip = std::min(tex.windowMip, request);
+		tex.requestedMip = std::min(tex.requestedMip, request);
+
+		if (closeWindow) {
+			tex.requestedMip = tex.windowMip;
+			tex.windowMip = tex.lowestResidentMip;
+		}
+
+		tex.targetMip = tex.requestedMip;
+		totalSize += texture_memory_size(tex, tex.targetMip);
+	}
+
+	memset(requests.data, 0xFF, sizeof(uint32_t) * MAX_TEXTURES);
+	vmaFlushAllocation(_allocator, frame.feedbackBuffer._allocation, 0, VK_WHOLE_SIZE);
+
+	while (totalSize > _textureMemoryBudget) {
+		Texture* largest = nullptr;
+		for (auto& it : _loadedTextures) {
+			Texture& tex = it.second;
+			if (tex.streamed && tex.targetMip < tex.lowestResidentMip &&
+				(largest == nullptr || texture_memory_size(tex, tex.targetMip) > texture_memory_size(*largest, largest->targetMip))) {
+				largest = &tex;
+			}
+		}
+
+		if (largest == nullptr) {
+			break;
+		}
+
+		totalSize -= texture_memory_size(*largest, largest->targetMip) - texture_memory_size(*largest, largest->targetMip + 1);
+		largest->targetMip++;
+	}
+
+	uint32_t streamCount = 0;
+	for (auto& it : _loadedTextures) {
+		Texture& tex = it.second;
+		if (!tex.streamed || tex.streaming || tex.targetMip == tex.residentMip) {
+			continue;
+		}
+
+		if (!start_texture_stream(tex, tex.targetMip) || ++streamCount == MAX_TEXTURE_STREAMS_PER_FRAME) {
+			break;
+		}
+	}
+}
+
+bool VulkanEngine::start_texture_stream(Texture& texture, uint32_t targetMip)
+{
+	TextureStream* stream = nullptr;
+	for (TextureStream& candidate : _textureStreams) {
+		if (!candidate.texture) {
+			stream = &candidate;
+			break;
+		}
+	}
+
+	if (!stream) {
+		return false;
+	}
+
+	stream->texture = &texture;
+	stream->targetMip = targetMip;
+	stream->extent = { std::max(texture.width >> targetMip, 1u), std::max(texture.height >> targetMip, 1u) };
+	stream->stagingBuffer = create_buffer(size_t(stream->extent.width) * stream->extent.height * 4, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+	stream->loaded = false;
+	stream->done.store(false, std::memory_order_relaxed);
+
+	texture.streaming = true;
+	_startedTextureStreams++;
+
+	// dropping mips decodes the file again too, copying them out of the old image would have to wait
+	// for every queued frame that samples it
+	_threadpool.submitBackground([stream] {
+		stream->loaded = vkutil::decode_image_mip(stream->texture->path, stream->targetMip, stream->extent, stream->stagingBuffer._mapped);
+		stream->done.store(true, std::memory_order_release);
+		});
+
+	return true;
+}
+
+void VulkanEngine::finish_texture_stream(FrameData& frame, TextureStream& stream)
+{
+	Texture& texture = *stream.texture;
+	texture.streaming = false;
+	stream.texture = nullptr;
+
+	if (!stream.loaded) {
+		// nothing on the GPU read it
+		vmaDestroyBuffer(_allocator, stream.stagingBuffer._buffer, stream.stagingBuffer._allocation);
+
+		// the file could not be read again, keep the resident chain rather than retrying every frame
+		std::cout << "Failed to stream texture " << texture.path << ", keeping mip " << texture.residentMip << std::endl;
+		texture.streamed = false;
+		texture.targetMip = texture.residentMip;
+		return;
+	}
+
+	AllocatedImage newImage;
+	vkutil::create_texture_image(*this, stream.extent, newImage);
+	newImage._sampler = texture.image._sampler;
+
+	VkImageView newView;
+	VkImageViewCreateInfo imageinfo = vkinit::imageview_create_info(VK_FORMAT_R8G8B8A8_SRGB, newImage._image, VK_IMAGE_ASPECT_COLOR_BIT, newImage._mipLevels);
+	VK_CHECK(vkCreateImageView(_device, &imageinfo, nullptr, &newView));
+
+	if (!frame.uploadsRecorded) {
+		VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		VK_CHECK(vkBeginCommandBuffer(frame._uploadCommandBuffer, &cmdBeginInfo));
+		frame.uploadsRecorded = true;
+	}
+
+	// nothing uses the new image yet, so the upload does not wait on earlier frames. Its last barrier only
+	// holds back the fragment shaders of this frame's passes, which are submitted right behind it
+	vkutil::record_image_upload(frame._uploadCommandBuffer, stream.stagingBuffer._buffer, newImage, stream.extent);
+
+	// earlier frames can still be sampling the old image. They were all submitted before this one,
+	// so they are done by the time this frame slot has been waited on again, and so is the upload
+	AllocatedBuffer stagingBuffer = stream.stagingBuffer;
+	AllocatedImage oldImage = texture.image;
+	VkImageView oldView = texture.imageView;
+	frame._frameDeletionQueue.push_function([=]() {
+		vmaDestroyBuffer(_allocator, stagingBuffer._buffer, stagingBuffer._allocation);
+		vkDestroyImageView(_device, oldView, nullptr);
+		vmaDestroyImage(_allocator, oldImage._image, oldImage._allocation);
+		});
+
+	texture.image = newImage;
+	texture.imageView = newView;
+	texture.residentMip = stream.targetMip;
+	_streamedTextureCount++;
+
+	write_bindless_texture(frame, texture);
+
+	for (FrameData& other : _frames) {
+		if (&other != &frame && std::find(other.staleTextures.begin(), other.staleTextures.end(), &texture) == other.staleTextures.end()) {
+			other.staleTextures.push_back(&texture);
+		}
+	}
+}
+
+void VulkanEngine::write_bindless_texture(FrameData& frame, const Texture& texture)
+{
+	VkDescriptorImageInfo imageBufferInfo;
+	imageBufferInfo.sampler = texture.image._sampler;
+	imageBufferInfo.imageView = texture.imageView;
+	imageBufferInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet write = vkinit::write_descriptor_image(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frame.bindlessTextureSet, &imageBufferInfo, 0);
+	write.dstArrayElement = texture.index;
+	vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+
+	// the set is not update-after-bind, so buffers that bound it have to be recorded again
+	_sceneVersion++;
+
+	// the fragment shader adds the resident mip to its lod so feedback is always relative to the full image
+	frame.residencyBuffer.span<uint32_t>()[texture.index] = texture.residentMip;
+}
+
+void VulkanEngine::upload_mesh(Mesh& mesh)
+{
+	const size_t bufferSize = mesh._vertices.size() * sizeof(Vertex);
+
+	AllocatedBuffer stagingBuffer = create_buffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+
+	memcpy(stagingBuffer._mapped, mesh._vertices.data(), bufferSize);
+
+	VkBufferCreateInfo vertexBufferInfo = {};
+	vertexBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	vertexBufferInfo.pNext = nullptr;
+	vertexBufferInfo.size = bufferSize;
+	vertexBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+	VmaAllocationCreateInfo vmaallocInfo = {};
+	vmaallocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+	VK_CHECK(vmaCreateBuffer(_allocator, &vertexBufferInfo, &vmaallocInfo,
+		&mesh._vertexBuffer._buffer,
+		&mesh._vertexBuffer._allocation,
+		nullptr));
+	AllocatedBuffer vertexBuffer = mesh._vertexBuffer;
+	_mainDeletionQueue.push_function([=]() {
+
+		vmaDestroyBuffer(_allocator, vertexBuffer._buffer, vertexBuffer._allocation);
+		});
+
+	immediate_submit([&](VkCommandBuffer cmd) {
+		VkBufferCopy copy;
+		copy.dstOffset = 0;
+		copy.srcOffset = 0;
+		copy.size = bufferSize;
+		vkCmdCopyBuffer(cmd, stagingBuffer._buffer, mesh._vertexBuffer._buffer, 1, &copy);
+		});
+
+	vmaDestroyBuffer(_allocator, stagingBuffer._buffer, stagingBuffer._allocation);
+
+	// the copy has completed, only bounds and draw metadata need to stay on the host
+	mesh.apply_residency(_meshResidency);
+}
+
+Material* VulkanEngine::create_material(VkPipeline pipeline, VkPipelineLayout layout, const std::string& name)
+{
+	Material mat;
+	mat.pipeline = pipeline;
+	mat.pipelineLayout = layout;
+	_materials[name] = mat;
+	return &_materials[name];
+}
+
+Material* VulkanEngine::get_material(const std::string& name)
+{
+	auto it = _materials.find(name);
+	if (it == _materials.end()) {
+		return nullptr;
+	}
+	else {
+		return &(*it).second;
+	}
+}
+
+
+Mesh* VulkanEngine::get_mesh(const std::string& name)
+{
+	auto it = _meshes.find(name);
+	if (it == _meshes.end()) {
+		return nullptr;
+	}
+	else {
+		return &(*it).second;
+	}
+}
+
+BufferSpan<IndirectBatch> VulkanEngine::compact_draws(vkutil::FrameArena& arena, RenderObject* objects, int count)
+{
+	// textures are indexed per object from the bindless array, so only the mesh and the pipeline can split a batch
+	auto sameBatch = [](const RenderObject& a, const RenderObject& b) {
+		return a.mesh == b.mesh && a.material->pipeline == b.material->pipeline;
+	};
+
+	// counted first, so the batches take exactly the arena memory they need
+	size_t batchCount = count > 0 ? 1 : 0;
+	for (int i = 1; i < count; i++)
+	{
+		if (!sameBatch(objects[i], objects[i - 1])) {
+			batchCount++;
+		}
+	}
+
+	BufferSpan<IndirectBatch> draws = arena.allocate<IndirectBatch>(batchCount);
+
+	size_t batch = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (i > 0 && sameBatch(objects[i], objects[i - 1]))
+		{
+			draws[batch - 1].count++;
+		}
+		else
+		{
+			IndirectBatch& newDraw = draws[batch++];
+			newDraw.mesh = objects[i].mesh;
+			newDraw.material = objects[i].material;
+			newDraw.first = i;
+			newDraw.count = 1;
+		}
+	}
+	return draws;
+};
+
+void VulkanEngine::execute_shadow_culling(VkCommandBuffer cmd, RenderObject* first, int count, int cascadesIndex)
+{
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, get_material("culling")->pipeline);
+
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, get_material("culling")->pipelineLayout, 0, 1, &get_current_frame().cullCascadeDescriptors[cascadesIndex], 0, nullptr);
+
+	glm::vec3 verticalNormal = { 0.0f, 1.0f, 0.0f };
+	glm::vec3 horizontalNormal = { 1.0f, 0.0f, 0.0f };
+	float yTopBottom = verticalNormal.y;
+	float zTopBottom = verticalNormal.z;
+	float xLeftRight = horizontalNormal.x;
+	float zLeftRight = horizontalNormal.z;
+
+	CullConstants constants;
+	constants.view = glm::lookAt(_lightPos, _lightFoc, glm::vec3(0.0f, 1.0f, 0.0f));
+	constants.frustum = { zLeftRight, xLeftRight, zTopBottom, yTopBottom };
+	constants.distance = get_current_frame().cascades[cascadesIndex].radius;
+	constants.zfar = 200.0f;
+	constants.znear = 0.5f;
+	constants.count = count;
+
+	vkCmdPushConstants(cmd, get_material("culling")->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
+
+	int groupcount = ((count) / 256) + 1;
+
+	vkCmdDispatch(cmd, groupcount, 1, 1);
+}
+
+void VulkanEngine::execute_culling(VkCommandBuffer cmd, RenderObject* first, int count)
+{
+	VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+	VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, get_material("culling")->pipeline);
+
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, get_material("culling")->pipelineLayout, 0, 1, &get_current_frame().cullDescriptor, 0, nullptr);
+
+	glm::vec3 verticalNormal = { 0.0f, glm::cos(glm::radians(45.0f)), glm::sin(glm::radians(45.0f)) };
+	glm::vec3 horizontalNormal = glm::normalize(glm::vec3{ glm::cos(glm::radians(45.0f)),
+														   0.0f, 
+														   glm::sin(glm::radians(45.0f)) * _windowExtent.width / (float)_windowExtent.height });
+	float yTopBottom = verticalNormal.y;
+	float zTopBottom = verticalNormal.z;
+	float xLeftRight = horizontalNormal.x;
+	float zLeftRight = horizontalNormal.z;
+
+	CullConstants constants;
+	const Camera& camera = _snapshots.front().camera;
+	constants.view = glm::lookAt(camera._camPos, camera._foc, glm::vec3(0.0f, 1.0f, 0.0f));
+	constants.frustum = { zLeftRight, xLeftRight, zTopBottom, yTopBottom };
+	constants.distance = 0.0f;
+	constants.zfar = camera.zFar;
+	constants.znear = camera.zNear;
+	constants.count = count;
+
+	vkCmdPushConstants(cmd, get_material("culling")->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
+
+	int groupcount = ((count) / 256) + 1;
+
+	vkCmdDispatch(cmd, groupcount, 1, 1);
+
+	// the graphics submit waits on _cullTimeline at DRAW_INDIRECT, which makes these writes visible
+	VK_CHECK(vkEndCommandBuffer(cmd));
+}
+
+void VulkanEngine::prepare_depthpass()
+{
+	// the shadow map and its render pass come from the render graph, each cascade renders into one layer
+	VkImage shadowMap = _renderGraph.image(_shadowMapResource);
+
+	for (int i = 0; i < _frames.size(); i++)
+	{
+		for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
+
+			VkImageViewCreateInfo viewInfo = vkinit::imageview_create_info(_depthFormat, shadowMap, VK_IMAGE_ASPECT_DEPTH_BIT,1);
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+			viewInfo.subresourceRange.baseMipLevel = 0;
+			viewInfo.subresourceRange.levelCount = 1;
+			viewInfo.subresourceRange.baseArrayLayer = j;
+			viewInfo.subresourceRange.layerCount = 1;
+
+			VK_CHECK(vkCreateImageView(_device, &viewInfo, nullptr, &_frames[i].cascades[j].view));
+
+			VkFramebufferCreateInfo framebufferInfo = vkinit::framebuffer_create_info(_depthPass, _shadowExtent);
+			framebufferInfo.renderPass = _depthPass;
+			framebufferInfo.attachmentCount = 1;
+			framebufferInfo.pAttachments = &_frames[i].cascades[j].view;
+			framebufferInfo.layers = 1;
+			VK_CHECK(vkCreateFramebuffer(_device, &framebufferInfo, nullptr, &_frames[i].cascades[j].frameBuffer));
+		
+
+			_mainDeletionQueue.push_function([=]() {
+				
+				vkDestroyImageView(_device, _frames[i].cascades[j].view, nullptr);
+				vkDestroyFramebuffer(_device, _frames[i].cascades[j].frameBuffer, nullptr);
+				
+				});
+		}
+
+	}
+}
+
+void VulkanEngine::update_descriptors( RenderObject* first, int count)
+{
+
+	float cascadeSplits[SHADOW_MAP_CASCADE_COUNT];
+
+	static auto startTime = std::chrono::high_resolution_clock::now();
+
+	auto currentTime = std::chrono::high_resolution_clock::now();
+	float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+
+	const Camera& camera = _snapshots.front().camera;
+
+	// consecutive frames visit every slot once, so counting down reaches each copy
+	if (_sceneParamsDirtyFrames > 0) {
+		int frameIndex = _frames.index(_frameNumber);
+
+		_sceneParameterBuffer.span<GPUSceneData>(pad_uniform_buffer_size(sizeof(GPUSceneData)) * frameIndex)[0] = _sceneParameters;
+		_sceneParamsDirtyFrames--;
+	}
+
+	glm::mat4 clip = glm::mat4(1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, -1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 0.5f, 0.0f,
+		0.0f, 0.0f, 0.5f, 1.0f);
+
+	glm::mat4 view = glm::lookAt(camera._camPos, camera._foc, glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), _windowExtent.width / (float)_windowExtent.height, 0.5f, 120.0f);
+	projection[1][1] *= -1;
+	glm::mat4 viewProjMat = projection * view;
+	
+	GPUCameraData camData;
+	camData.pos = camera._camPos;
+	camData.viewproj = viewProjMat;
+	camData.view = view;
+
+	get_current_frame().uniformBuffer.span<GPUCameraData>(_uniformOffsets.camera)[0] = camData;
+
+	glm::mat4 skyboxView = glm::mat4(glm::mat3(view)); 
+	glm::mat4 skyboxProj = glm::perspective(glm::radians(45.0f), _windowExtent.width / (float)_windowExtent.height, 0.5f, 120.0f);
+	skyboxProj[1][1] *= -1;
+	GPUCameraData skybox;
+	skybox.pos = camera._camPos;
+	skybox.viewproj = skyboxProj * skyboxView * glm::rotate(glm::mat4(1.0f), glm::radians(SKYBOX_YAW), glm::vec3(0.0f, 1.0f, 0.0f));
+	skybox.view = skyboxView;
+
+	get_current_frame().uniformBuffer.span<GPUCameraData>(_uniformOffsets.skybox)[0] = skybox;
+
+	float nearClip = camera.zNear;
+	float farClip = camera.zFar;
+	float clipRange = farClip - nearClip;
+
+	float minZ = nearClip;
+	float maxZ = nearClip + clipRange;
+	float range = maxZ - minZ;
+	float ratio = maxZ / minZ;
+
+	float cascadeSplitLambda = 0.8f;
+	for (uint32_t i = 0; i < SHADOW_MAP_CASCADE_COUNT; i++) {
+		float p = (i + 1) / static_cast<float>(SHADOW_MAP_CASCADE_COUNT);
+		float log = minZ * std::pow(ratio, p);
+		float uniform = minZ + range * p;
+		float d = cascadeSplitLambda * (log - uniform) + uniform;
+		cascadeSplits[i] = (d - nearClip) / clipRange;
+	}
+
+	float lastSplitDist = 0.0;
+	for (uint32_t i = 0; i < SHADOW_MAP_CASCADE_COUNT; i++) {
+		float splitDist = cascadeSplits[i];
+
+		glm::vec3 frustumCorners[8] = {
+			glm::vec3(-1.0f,  1.0f, 0.0f),
+			glm::vec3(1.0f,  1.0f, 0.0f),
+			glm::vec3(1.0f, -1.0f, 0.0f),
+			glm::vec3(-1.0f, -1.0f, 0.0f),
+			glm::vec3(-1.0f,  1.0f,  1.0f),
+			glm::vec3(1.0f,  1.0f,  1.0f),
+			glm::vec3(1.0f, -1.0f,  1.0f),
+			glm::vec3(-1.0f, -1.0f,  1.0f),
+		};
+
+
+		glm::mat4 invCam = glm::inverse(projection * view);
+		for (uint32_t j = 0; j < 8; j++) {
+			glm::vec4 invCorner = invCam * glm::vec4(frustumCorners[j], 1.0f);
+			frustumCorners[j] = invCorner / invCorner.w;
+		}
+
+		for (uint32_t j = 0; j < 4; j++) {
+			glm::vec3 dist = frustumCorners[j + 4] - frustumCorners[j];
+			frustumCorners[j + 4] = frustumCorners[j] + (dist * splitDist);
+			frustumCorners[j] = frustumCorners[j] + (dist * lastSplitDist);
+		}
+
+		glm::vec3 frustumCenter = glm::vec3(0.0f);
+		for (uint32_t j = 0; j < 8; j++) {
+			frustumCenter += frustumCorners[j];
+		}
+		frustumCenter /= 8.0f;
+
+		float radius = 0.0f;
+		for (uint32_t j = 0; j < 8; j++) {
+			float distance = glm::length(frustumCorners[j] - frustumCenter);
+			radius = glm::max(radius, distance);
+		}
+
+
+		glm::vec3 maxExtents = glm::vec3(radius);
+		glm::vec3 minExtents = -maxExtents;
+
+		glm::mat4 lightViewMatrix = glm::lookAt(frustumCenter + _sceneParameters.lightDir * (maxExtents + 40.0f), frustumCenter, glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 lightOrthoMatrix = glm::ortho(minExtents.x, maxExtents.x,  maxExtents.y, minExtents.y, 0.0f, maxExtents.z*2.0f+80.0f);
+
+		glm::mat4 shadowMatrix = lightOrthoMatrix * lightViewMatrix;
+		glm::vec4 shadowOrigin = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		shadowOrigin = shadowMatrix * shadowOrigin;
+		shadowOrigin = shadowOrigin * (float)_shadowExtent.height / 2.0f;
+
+		glm::vec4 roundedOrigin = glm::round(shadowOrigin);
+		glm::vec4 roundOffset = roundedOrigin - shadowOrigin;
+		roundOffset = roundOffset * 2.0f / (float)_shadowExtent.height;
+		roundOffset.z = 0.0f;
+		roundOffset.w = 0.0f;
+
+		glm::mat4 shadowProj = lightOrthoMatrix;
+		shadowProj[3] += roundOffset;
+		lightOrthoMatrix = shadowProj;
+
+		get_current_frame().cascades[i].radius = radius;
+		get_current_frame().cascades[i].splitDepth = (camera.zNear + splitDist * clipRange) * -1.0f;
+		get_current_frame().cascades[i].viewProjMatrix = lightOrthoMatrix * lightViewMatrix;
+
+		lastSplitDist = cascadeSplits[i];
+
+		GPUCameraData lightData;
+		lightData.pos = frustumCenter - _sceneParameters.lightDir * minExtents.z;
+		lightData.viewproj = lightOrthoMatrix * lightViewMatrix;
+		lightData.view = lightViewMatrix;
+
+		get_current_frame().uniformBuffer.span<GPUCameraData>(_uniformOffsets.cascades[i])[0] = lightData;
+	}
+
+	CascadesSet cascadesSet;
+	for (uint32_t i = 0; i < SHADOW_MAP_CASCADE_COUNT; i++) {
+		uint32_t rowIndex = i / 4;
+		uint32_t colIndex = i % 4;
+		cascadesSet.cascadeSplits[rowIndex][colIndex] = get_current_frame().cascades[i].splitDepth;
+		cascadesSet.cascadeViewProjMat[i] = get_current_frame().cascades[i].viewProjMatrix;
+		cascadesSet.cascadeSizes[rowIndex][colIndex] = std::pow(2.0f * get_current_frame().cascades[i].radius, 2.0f);
+	}
+	
+	get_current_frame().uniformBuffer.span<CascadesSet>(_uniformOffsets.cascadesSet)[0] = cascadesSet;
+}
+
+
+void VulkanEngine::update_csm(VkCommandBuffer cmd, IndirectBatch* first, int count, int cascadesIndex)
+{
+
+	int frameIndex = _frames.index(_frameNumber);
+
+	VkPipeline pipeline = get_material("directDepth")->pipeline;
+	VkPipelineLayout pipeline_layout = get_material("directDepth")->pipelineLayout;
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+	uint32_t uniform_offsets[] = { _uniformOffsets.cascades[cascadesIndex], static_cast<uint32_t>(pad_uniform_buffer_size(sizeof(GPUSceneData)) * frameIndex) };
+
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &get_current_frame().lightDescriptor, 2, uniform_offsets);
+
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 1, 1, &get_current_frame().objectDescriptor, 0, nullptr);
+
+	for (int i = 0; i < count; i++)
+	{
+		IndirectBatch& draw = first[i];
+
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(cmd, 0, 1, &draw.mesh->_vertexBuffer._buffer, &offset);
+
+		VkDeviceSize indirect_offset = draw.first * sizeof(VkDrawIndirectCommand);
+		uint32_t draw_stride = sizeof(VkDrawIndirectCommand);
+
+		vkCmdDrawIndirect(cmd, get_current_frame().indirectShadowBuffers[cascadesIndex]._buffer, indirect_offset, draw.count, draw_stride);
+	}
+}
+
+void VulkanEngine::draw_gbuffer(VkCommandBuffer cmd, RenderObject* first, int count)
+{
+	int frameIndex = _frames.index(_frameNumber);
+
+	BufferSpan<IndirectBatch> draws = compact_draws(get_current_frame().arena, first, count);
+
+	for (IndirectBatch& draw : draws)
+	{
+		VkPipelineLayout layout;
+		VkPipeline pipeline;
+		if (draw.material->texture != nullptr) {
+			layout = get_material("gbuffer")->pipelineLayout;
+			pipeline = get_material("gbuffer")->pipeline;
+		}
+		else {
+			layout = get_material("gbufferTextured")->pipelineLayout;
+			pipeline = get_material("gbufferTextured")->pipeline;
+		}
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+		// the light view of the nearest cascade
+		uint32_t uniform_offsets[] = { _uniformOffsets.cascades[0], static_cast<uint32_t>(pad_uniform_buffer_size(sizeof(GPUSceneData)) * frameIndex) };
+
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &get_current_frame().globalDescriptor, 1, &_uniformOffsets.camera);
+
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 1, 1, &get_current_frame().lightDescriptor, 2, uniform_offsets);
+
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 2, 1, &get_current_frame().objectDescriptor, 0, nullptr);
+
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 3, 1, &get_current_frame()._csmSet, 0, nullptr);
+
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 4, 1, &get_current_frame().bindlessTextureSet, 0, nullptr);
+
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(cmd, 0, 1, &draw.mesh->_vertexBuffer._buffer, &offset);
+
+		VkDeviceSize indirect_offset = draw.first * sizeof(VkDrawIndirectCommand);
+		uint32_t draw_stride = sizeof(VkDrawIndirectCommand);
+
+		vkCmdDrawIndirect(cmd, get_current_frame().indirectBuffer._buffer, indirect_offset, draw.count, draw_stride);
+	}
+}
+
+
+void VulkanEngine::draw_objects(VkCommandBuffer cmd, IndirectBatch* first, int count)
+{
+	int frameIndex = _frames.index(_frameNumber);
+
+	for (int i = 0; i < count; i++)
+	{
+		IndirectBatch& draw = first[i];
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.material->pipeline);
+
+		uint32_t uniform_offsets[] = { _uniformOffsets.cascadesSet, static_cast<uint32_t>(pad_uniform_buffer_size(sizeof(GPUSceneData)) * frameIndex) };
+
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.material->pipelineLayout, 0, 1, &get_current_frame().globalDescriptor, 1, &_uniformOffsets.camera);
+
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.material->pipelineLayout, 1, 1, &get_current_frame().cascadesSetDescriptor, 2, uniform_offsets);
+
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.material->pipelineLayout, 2, 1, &get_current_frame().objectDescriptor, 0, nullptr);
+
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.material->pipelineLayout, 3, 1, &get_current_frame()._csmSet, 0, nullptr);
+
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.material->pipelineLayout, 4, 1, &get_current_frame().bindlessTextureSet, 0, nullptr);
+
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.material->pipelineLayout, 5, 1, &get_current_frame().feedbackDescriptor, 0, nullptr);
+
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(cmd, 0, 1, &draw.mesh->_vertexBuffer._buffer, &offset);
+
+		VkDeviceSize indirect_offset = draw.first * sizeof(VkDrawIndirectCommand);
+		uint32_t draw_stride = sizeof(VkDrawIndirectCommand);
+
+		vkCmdDrawIndirect(cmd, get_current_frame().indirectBuffer._buffer, indirect_offset, draw.count, draw_stride);
+	}
+	
+}
+
+
+void VulkanEngine::draw_skybox(VkCommandBuffer cmd)
+{
+	if (_skyboxSet == VK_NULL_HANDLE) {
+		return;
+	}
+
+	Material* skybox = get_material("skybox");
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, skybox->pipeline);
+
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, skybox->pipelineLayout, 0, 1, &get_current_frame().globalDescriptor, 1, &_uniformOffsets.skybox);
+
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, skybox->pipelineLayout, 1, 1, &_skyboxSet, 0, nullptr);
+
+	vkCmdDraw(cmd, 3, 1, 0, 0);
+}
+
+void VulkanEngine::draw_upscale(VkCommandBuffer cmd, VkExtent2D renderExtent)
+{
+	Material* upscale = get_material("upscale");
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, upscale->pipeline);
+
+	set_viewport(cmd, _windowExtent);
+
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, upscale->pipelineLayout, 0, 1, &_upscaleSet, 0, nullptr);
+
+	// bilinear taps are kept half a texel inside the rendered area, past it is last frame's or undefined data
+	UpscaleConstants constants;
+	constants.uvScale = glm::vec2(renderExtent.width / (float)_windowExtent.width, renderExtent.height / (float)_windowExtent.height);
+	constants.uvMax = glm::vec2((renderExtent.width - 0.5f) / _windowExtent.width, (renderExtent.height - 0.5f) / _windowExtent.height);
+
+	vkCmdPushConstants(cmd, upscale->pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(UpscaleConstants), &constants);
+
+	vkCmdDraw(cmd, 3, 1, 0, 0);
+}
+
+void VulkanEngine::set_viewport(VkCommandBuffer cmd, VkExtent2D extent)
+{
+	VkViewport viewport;
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float)extent.width;
+	viewport.height = (float)extent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	VkRect2D scissor;
+	scissor.offset = { 0, 0 };
+	scissor.extent = extent;
+
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
+}
+
+void VulkanEngine::update_render_scale()
+{
+	FrameData& frame = get_current_frame();
+
+	// only frames rendered at the current extent say anything about it
+	uint64_t timestamps[2];
+	bool sameExtent = frame.renderExtent.width == _renderExtent.width && frame.renderExtent.height == _renderExtent.height;
+	if (_gpuFrameBudget > 0.0f && frame.timestampsWritten && sameExtent &&
+		vkGetQueryPoolResults(_device, frame.timestampPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+
+		float gpuTime = (timestamps[1] - timestamps[0]) * _gpuProperties.limits.timestampPeriod / 1000000.0f;
+		_gpuFrameTime = _gpuFrameTime == 0.0f ? gpuTime : glm::mix(_gpuFrameTime, gpuTime, 0.1f);
+
+		// the cost follows the pixel count, the square of the scale. Nothing changes while the time sits
+		// in the band under the budget, so the extent does not flip between two sizes every frame
+		if (_gpuFrameTime > _gpuFrameBudget || _gpuFrameTime < _gpuFrameBudget * 0.7f) {
+			_renderScale = std::clamp(_renderScale * std::sqrt(_gpuFrameBudget * 0.85f / _gpuFrameTime), MIN_RENDER_SCALE, 1.0f);
+
+			VkExtent2D extent;
+			extent.width = std::min(_windowExtent.width, (uint32_t(_windowExtent.width * _renderScale) + RENDER_EXTENT_GRANULE - 1) / RENDER_EXTENT_GRANULE * RENDER_EXTENT_GRANULE);
+			extent.height = std::min(_windowExtent.height, (uint32_t(_windowExtent.height * _renderScale) + RENDER_EXTENT_GRANULE - 1) / RENDER_EXTENT_GRANULE * RENDER_EXTENT_GRANULE);
+
+			if (extent.width != _renderExtent.width || extent.height != _renderExtent.height) {
+				_renderExtent = extent;
+				_gpuFrameTime = 0.0f;
+				// record-once buffers have the render area and viewport baked in
+				_sceneVersion++;
+			}
+		}
+	}
+
+	frame.renderExtent = _renderExtent;
+}
+
+
+void VulkanEngine::init_scene()
+{
+	Scene scene;
+	if (!scene.load_from_file(_scenePath.c_str())) {
+		std::cout << "Failed to load scene " << _scenePath << std::endl;
+	}
+
+	if (_stressGridSize > 0) {
+		Scene block = scene;
+		scene.tile_grid(block, _stressGridSize, STRESS_BLOCK_SPACING, STRESS_SEED);
+	}
+
+	_renderables.reserve(scene.instance_count());
+
+	for (const SceneObject& object : scene.objects) {
+		RenderObject obj;
+		obj.mesh = get_mesh(object.mesh);
+		obj.material = get_material(object.material);
+		if (obj.mesh == nullptr || obj.material == nullptr) {
+			std::cout << "Skipping scene object " << object.mesh << " with unknown mesh or material " << object.material << std::endl;
+			continue;
+		}
+
+		for (const glm::mat4& transform : object.transforms) {
+			obj.transformMatrix = transform;
+			_renderables.push_back(obj);
+		}
+	}
+
+	std::cout << "Scene loaded with " << _renderables.size() << " objects" << std::endl;
+
+	_renderablesVersion++;
+	_sceneVersion++;
+
+	_sceneParameters.lightColor = { 3.0,3.0,3.0 };
+	_sceneParameters.lightDir = glm::normalize(glm::vec4{ -0.3, 1.0, 1.0, 0.0 });
+	_sceneParameters.zNear = 0.1f;
+	_sceneParameters.zFar = 200.0f;
+	mark_scene_params_dirty();
+
+	VkSamplerCreateInfo samplerInfo = vkinit::sampler_create_info(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+	VkSamplerCreateInfo shadowSamplerInfo = vkinit::sampler_create_info(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+	shadowSamplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+
+	VkSampler imgSampler = _samplerCache->create_sampler(&samplerInfo);
+
+	_shadowSampler = _samplerCache->create_sampler(&shadowSamplerInfo);
+
+
+	for (auto name : TEXTURE_NAMES) {
+		Material* texMat = get_material(name);
+		texMat->texture = &_loadedTextures[name];
+		texMat->materialID = texMat->texture->index;
+
+		for (FrameData& frame : _frames) {
+			write_bindless_texture(frame, *texMat->texture);
+		}
+	}
+
+	if (_skyboxImageView != VK_NULL_HANDLE) {
+		VkDescriptorImageInfo skyboxImageInfo;
+		skyboxImageInfo.sampler = imgSampler;
+		skyboxImageInfo.imageView = _skyboxImageView;
+		skyboxImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		vkutil::DescriptorBuilder::begin(_descriptorLayoutCache, _descriptorAllocator)
+			.bind_image(0, 1, &skyboxImageInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.build(_skyboxSet);
+	}
+
+	VkDescriptorImageInfo sceneColorInfo;
+	sceneColorInfo.sampler = imgSampler;
+	sceneColorInfo.imageView = _sceneColorView;
+	sceneColorInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	vkutil::DescriptorBuilder::begin(_descriptorLayoutCache, _descriptorAllocator)
+		.bind_image(0, 1, &sceneColorInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+		.build(_upscaleSet);
+
+	
+	VkDescriptorImageInfo csmBufferInfo;
+	
+	csmBufferInfo.sampler = _shadowSampler;
+	csmBufferInfo.imageView = _depthView;
+	csmBufferInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	
+	for (int i = 0; i < _frames.size(); i++) {
+		vkutil::DescriptorBuilder::begin(_descriptorLayoutCache, _descriptorAllocator)
+			.bind_image(0, 1, &csmBufferInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.build(_frames[i]._csmSet);
+	}
+
+	upload_draw_templates();
+}
+
+AllocatedBuffer VulkanEngine::create_buffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, bool sharedWithCompute)
+{
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.pNext = nullptr;
+	bufferInfo.size = allocSize;
+
+	bufferInfo.usage = usage;
+
+	// concurrent sharing avoids queue family ownership transfers every frame
+	uint32_t queueFamilies[] = { _graphicsQueueFamily, _computeQueueFamily };
+	if (sharedWithCompute && _graphicsQueueFamily != _computeQueueFamily) {
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = 2;
+		bufferInfo.pQueueFamilyIndices = queueFamilies;
+	}
+
+	VmaAllocationCreateInfo vmaallocInfo = {};
+	vmaallocInfo.usage = memoryUsage;
+	if (memoryUsage != VMA_MEMORY_USAGE_GPU_ONLY) {
+		vmaallocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+	}
+
+	AllocatedBuffer newBuffer;
+	VmaAllocationInfo allocationInfo;
+
+	VK_CHECK(vmaCreateBuffer(_allocator, &bufferInfo, &vmaallocInfo,
+		&newBuffer._buffer,
+		&newBuffer._allocation,
+		&allocationInfo));
+
+	newBuffer._mapped = allocationInfo.pMappedData;
+	newBuffer._size = allocSize;
+
+	return newBuffer;
+}
+
+size_t VulkanEngine::pad_uniform_buffer_size(size_t originalSize)
+{
+	size_t minUboAlignment = _gpuProperties.limits.minUniformBufferOffsetAlignment;
+	size_t alignedSize = originalSize;
+	if (minUboAlignment > 0) {
+		alignedSize = (alignedSize + minUboAlignment - 1) & ~(minUboAlignment - 1);
+	}
+	return alignedSize;
+}
+
+void VulkanEngine::immediate_submit(std::function<void(VkCommandBuffer cmd)>&& function)
+{
+	VkCommandBuffer cmd = _uploadContext._commandBuffer;
+	VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+	VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+
+
+	function(cmd);
+
+
+	VK_CHECK(vkEndCommandBuffer(cmd));
+
+	VkSubmitInfo submit = vkinit::submit_info(&cmd);
+
+
+	VK_CHECK(vkQueueSubmit(_graphicsQueue, 1, &submit, _uploadContext._uploadFence));
+
+	vkWaitForFences(_device, 1, &_uploadContext._uploadFence, true, 9999999999);
+	vkResetFences(_device, 1, &_uploadContext._uploadFence);
+
+	vkResetCommandPool(_device, _uploadContext._commandPool, 0);
+}
+
+void VulkanEngine::init_descriptors()
+{
+
+	_descriptorAllocator = new vkutil::DescriptorAllocator{};
+	_descriptorAllocator->init(_device);
+
+	_descriptorLayoutCache = new vkutil::DescriptorLayoutCache{};
+	_descriptorLayoutCache->init(_device);
+
+	_samplerCache = new vkutil::SamplerCache{};
+	_samplerCache->init(_device);
+
+
+	VkDescriptorSetLayoutBinding cameraBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0);
+	VkDescriptorSetLayoutBinding sceneBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 1);
+	VkDescriptorSetLayoutBinding bindings[] = { cameraBind,sceneBind };
+	
+
+	VkDescriptorSetLayoutCreateInfo setinfo = {};
+	setinfo.bindingCount = 1;
+	setinfo.flags = 0;
+	setinfo.pNext = nullptr;
+	setinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setinfo.pBindings = &cameraBind;
+
+	_globalSetLayout = _descriptorLayoutCache->create_descriptor_layout(&setinfo);
+
+
+	VkDescriptorSetLayoutBinding objectBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0);
+
+	VkDescriptorSetLayoutCreateInfo set2info = {};
+	set2info.bindingCount = 1;
+	set2info.flags = 0;
+	set2info.pNext = nullptr;
+	set2info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	set2info.pBindings = &objectBind;
+
+	_objectSetLayout = _descriptorLayoutCache->create_descriptor_layout(&set2info);
+
+	
+	VkDescriptorSetLayoutBinding textureBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0);
+
+	VkDescriptorSetLayoutBinding gBufferBind1 = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0);
+	VkDescriptorSetLayoutBinding gBufferBind2 = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1);
+	VkDescriptorSetLayoutBinding gBufferBind3 = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 2);
+	VkDescriptorSetLayoutBinding gBufferBind4 = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 3);
+	VkDescriptorSetLayoutBinding gBufferBind5 = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 4);
+	VkDescriptorSetLayoutBinding gBufferBindings[] = { gBufferBind1,gBufferBind2,gBufferBind3,gBufferBind4,gBufferBind5 };
+
+	// every material texture lives in one array, slots of textures that failed to load are left unwritten
+	textureBind.descriptorCount = MAX_TEXTURES;
+	VkDescriptorBindingFlags textureBindFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo textureBindFlagsInfo = {};
+	textureBindFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	textureBindFlagsInfo.pNext = nullptr;
+	textureBindFlagsInfo.bindingCount = 1;
+	textureBindFlagsInfo.pBindingFlags = &textureBindFlags;
+
+	VkDescriptorSetLayoutCreateInfo set3info = {};
+	set3info.bindingCount = 1;
+	set3info.flags = 0;
+	set3info.pNext = &textureBindFlagsInfo;
+	set3info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	set3info.pBindings = &textureBind;
+
+	_bindlessTextureSetLayout = _descriptorLayoutCache->create_descriptor_layout(&set3info);
+	for (FrameData& frame : _frames) {
+		_descriptorAllocator->allocate(&frame.bindlessTextureSet, _bindlessTextureSetLayout);
+		frame.staleTextures.reserve(MAX_TEXTURES);
+	}
+
+	VkDescriptorSetLayoutBinding skyboxBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0);
+
+	VkDescriptorSetLayoutCreateInfo skyboxSetInfo = {};
+	skyboxSetInfo.bindingCount = 1;
+	skyboxSetInfo.flags = 0;
+	skyboxSetInfo.pNext = nullptr;
+	skyboxSetInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	skyboxSetInfo.pBindings = &skyboxBind;
+
+	_skyboxSetLayout = _descriptorLayoutCache->create_descriptor_layout(&skyboxSetInfo);
+	_upscaleSetLayout = _descriptorLayoutCache->create_descriptor_layout(&skyboxSetInfo);
+
+	VkDescriptorSetLayoutCreateInfo set4info = {};
+	set4info.bindingCount = 2;
+	set4info.flags = 0;
+	set4info.pNext = nullptr;
+	set4info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	set4info.pBindings = bindings;
+
+	_lightSetLayout = _descriptorLayoutCache->create_descriptor_layout(&set4info);
+	_cascadesSetLayout = _descriptorLayoutCache->create_descriptor_layout(&set4info);
+
+	VkDescriptorSetLayoutCreateInfo set5info = {};
+	set5info.bindingCount = 5;
+	set5info.flags = 0;
+	set5info.pNext = nullptr;
+	set5info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	set5info.pBindings = gBufferBindings;
+
+	_gBufferSetLayout = _descriptorLayoutCache->create_descriptor_layout(&set5info);
+	
+	const size_t sceneParamBufferSize = _frames.size() * pad_uniform_buffer_size(sizeof(GPUSceneData));
+
+	_sceneParameterBuffer = create_buffer(sceneParamBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	VkDescriptorSetLayoutBinding cullBind1 = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0);
+	VkDescriptorSetLayoutBinding cullBind2 = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+	VkDescriptorSetLayoutBinding cullBind3 = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2);
+	VkDescriptorSetLayoutBinding cullBind4 = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 3);
+	VkDescriptorSetLayoutBinding cullBindings[] = { cullBind1, cullBind2, cullBind3, cullBind4 };
+
+	VkDescriptorSetLayoutCreateInfo set6info = {};
+	set6info.bindingCount = 4;
+	set6info.flags = 0;
+	set6info.pNext = nullptr;
+	set6info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	set6info.pBindings = cullBindings;
+
+	_cullSetLayout = _descriptorLayoutCache->create_descriptor_layout(&set6info);
+
+	VkDescriptorSetLayoutBinding cascadeBindings = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0);
+	VkDescriptorSetLayoutCreateInfo csmSetInfo = {};
+	csmSetInfo.bindingCount = 1;
+	csmSetInfo.flags = 0;
+	csmSetInfo.pNext = nullptr;
+	csmSetInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	csmSetInfo.pBindings = &cascadeBindings;
+
+	_csmSetLayout = _descriptorLayoutCache->create_descriptor_layout(&csmSetInfo);
+
+	VkDescriptorSetLayoutBinding feedbackBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 0);
+	VkDescriptorSetLayoutBinding residencyBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1);
+	VkDescriptorSetLayoutBinding feedbackBindings[] = { feedbackBind, residencyBind };
+
+	VkDescriptorSetLayoutCreateInfo feedbackSetInfo = {};
+	feedbackSetInfo.bindingCount = 2;
+	feedbackSetInfo.flags = 0;
+	feedbackSetInfo.pNext = nullptr;
+	feedbackSetInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	feedbackSetInfo.pBindings = feedbackBindings;
+
+	_feedbackSetLayout = _descriptorLayoutCache->create_descriptor_layout(&feedbackSetInfo);
+
+	// blocks are packed at the device's uniform offset alignment and bound through dynamic offsets,
+	// so each frame needs one buffer and sets of the same layout share one descriptor
+	auto suballocate = [&](size_t size) {
+		uint32_t offset = _uniformOffsets.size;
+		_uniformOffsets.size += static_cast<uint32_t>(pad_uniform_buffer_size(size));
+		return offset;
+	};
+
+	_uniformOffsets.camera = suballocate(sizeof(GPUCameraData));
+	_uniformOffsets.skybox = suballocate(sizeof(GPUCameraData));
+	for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
+		_uniformOffsets.cascades[j] = suballocate(sizeof(GPUCameraData));
+	}
+	_uniformOffsets.cascadesSet = suballocate(sizeof(CascadesSet));
+
+	for (int i = 0; i < _frames.size(); i++)
+	{
+		_frames[i].uniformBuffer = create_buffer(_uniformOffsets.size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+		_frames[i].feedbackBuffer = create_buffer(sizeof(uint32_t) * MAX_TEXTURES, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+
+		memset(_frames[i].feedbackBuffer._mapped, 0xFF, sizeof(uint32_t) * MAX_TEXTURES);
+		vmaFlushAllocation(_allocator, _frames[i].feedbackBuffer._allocation, 0, VK_WHOLE_SIZE);
+
+		_frames[i].residencyBuffer = create_buffer(sizeof(uint32_t) * MAX_TEXTURES, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+		for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
+			_descriptorAllocator->allocate(&_frames[i].cullCascadeDescriptors[j], _cullSetLayout);
+		}
+
+		_descriptorAllocator->allocate(&_frames[i].lightDescriptor, _lightSetLayout);
+		_descriptorAllocator->allocate(&_frames[i].globalDescriptor, _globalSetLayout);
+		_descriptorAllocator->allocate(&_frames[i].objectDescriptor, _objectSetLayout);
+		_descriptorAllocator->allocate(&_frames[i].cullDescriptor, _cullSetLayout);
+		_descriptorAllocator->allocate(&_frames[i].cascadesSetDescriptor, _cascadesSetLayout);
+		_descriptorAllocator->allocate(&_frames[i].feedbackDescriptor, _feedbackSetLayout);
+
+		reserve_object_buffers(_frames[i], INITIAL_OBJECT_CAPACITY);
+
+		VkDescriptorBufferInfo cameraInfo;
+		cameraInfo.buffer = _frames[i].uniformBuffer._buffer;
+		cameraInfo.offset = 0;
+		cameraInfo.range = sizeof(GPUCameraData);
+
+		VkDescriptorBufferInfo sceneInfo;
+		sceneInfo.buffer = _sceneParameterBuffer._buffer;
+		sceneInfo.offset = 0;
+		sceneInfo.range = sizeof(GPUSceneData);
+
+		VkDescriptorBufferInfo feedbackBufferInfo;
+		feedbackBufferInfo.buffer = _frames[i].feedbackBuffer._buffer;
+		feedbackBufferInfo.offset = 0;
+		feedbackBufferInfo.range = sizeof(uint32_t) * MAX_TEXTURES;
+
+		VkDescriptorBufferInfo residencyBufferInfo;
+		residencyBufferInfo.buffer = _frames[i].residencyBuffer._buffer;
+		residencyBufferInfo.offset = 0;
+		residencyBufferInfo.range = sizeof(uint32_t) * MAX_TEXTURES;
+
+		VkDescriptorBufferInfo cascadesSetBufferInfo;
+		cascadesSetBufferInfo.buffer = _frames[i].uniformBuffer._buffer;
+		cascadesSetBufferInfo.offset = 0;
+		cascadesSetBufferInfo.range = sizeof(CascadesSet);
+
+		vkutil::DescriptorBuilder::begin(_descriptorLayoutCache, _descriptorAllocator)
+			.bind_buffer(0, &cameraInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+			.bind_buffer(1, &sceneInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+			.build(_frames[i].lightDescriptor);
+
+		vkutil::DescriptorBuilder::begin(_descriptorLayoutCache, _descriptorAllocator)
+			.bind_buffer(0, &cascadesSetBufferInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+			.bind_buffer(1, &sceneInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+			.build(_frames[i].cascadesSetDescriptor);
+
+
+		vkutil::DescriptorBuilder::begin(_descriptorLayoutCache, _descriptorAllocator)
+			.bind_buffer(0, &cameraInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+			.build(_frames[i].globalDescriptor);
+
+		vkutil::DescriptorBuilder::begin(_descriptorLayoutCache, _descriptorAllocator)
+			.bind_buffer(0, &feedbackBufferInfo, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.bind_buffer(1, &residencyBufferInfo, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.build(_frames[i].feedbackDescriptor);
+
+		
+			
+	}
+
+	_mainDeletionQueue.push_function([&]() {
+	
+		vmaDestroyBuffer(_allocator, _sceneParameterBuffer._buffer, _sceneParameterBuffer._allocation);
+		for (int i = 0; i < _frames.size(); i++)
+		{
+			vmaDestroyBuffer(_allocator, _frames[i].uniformBuffer._buffer, _frames[i].uniformBuffer._allocation);
+			vmaDestroyBuffer(_allocator, _frames[i].objectBuffer._buffer, _frames[i].objectBuffer._allocation);
+			vmaDestroyBuffer(_allocator, _frames[i].instanceBuffer._buffer, _frames[i].instanceBuffer._allocation);
+			vmaDestroyBuffer(_allocator, _frames[i].feedbackBuffer._buffer, _frames[i].feedbackBuffer._allocation);
+			vmaDestroyBuffer(_allocator, _frames[i].residencyBuffer._buffer, _frames[i].residencyBuffer._allocation);
+			for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
+				vmaDestroyBuffer(_allocator, _frames[i].indirectShadowBuffers[j]._buffer, _frames[i].indirectShadowBuffers[j]._allocation);
+			}
+			vmaDestroyBuffer(_allocator, _frames[i].indirectBuffer._buffer, _frames[i].indirectBuffer._allocation);
+		}
+	});
+		
+
+}
+
+void VulkanEngine::reserve_object_buffers(FrameData& frame, uint32_t count)
+{
+	if (count <= frame.objectCapacity) {
+		return;
+	}
+
+	uint32_t capacity = std::max(frame.objectCapacity, INITIAL_OBJECT_CAPACITY);
+	while (capacity < count) {
+		capacity *= 2;
+	}
+
+	// only called once the frame's timeline value has been reached, so nothing on the GPU still reads the old buffers
+	if (frame.objectCapacity != 0) {
+		vmaDestroyBuffer(_allocator, frame.objectBuffer._buffer, frame.objectBuffer._allocation);
+		vmaDestroyBuffer(_allocator, frame.instanceBuffer._buffer, frame.instanceBuffer._allocation);
+		vmaDestroyBuffer(_allocator, frame.indirectBuffer._buffer, frame.indirectBuffer._allocation);
+		for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
+			vmaDestroyBuffer(_allocator, frame.indirectShadowBuffers[j]._buffer, frame.indirectShadowBuffers[j]._allocation);
+		}
+	}
+
+	frame.objectBuffer = create_buffer(sizeof(GPUObjectData) * capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, true);
+	frame.instanceBuffer = create_buffer(sizeof(GPUInstance) * capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, true);
+	frame.indirectBuffer = create_buffer(sizeof(VkDrawIndirectCommand) * capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, true);
+	for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
+		frame.indirectShadowBuffers[j] = create_buffer(sizeof(VkDrawIndirectCommand) * capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY, true);
+	}
+	frame.objectCapacity = capacity;
+	frame.renderablesVersion = 0;
+	// the descriptors and indirect buffers baked into recorded passes are gone
+	_sceneVersion++;
+
+	VkDescriptorBufferInfo objectBufferInfo;
+	objectBufferInfo.buffer = frame.objectBuffer._buffer;
+	objectBufferInfo.offset = 0;
+	objectBufferInfo.range = sizeof(GPUObjectData) * capacity;
+
+	VkDescriptorBufferInfo instanceBufferInfo;
+	instanceBufferInfo.buffer = frame.instanceBuffer._buffer;
+	instanceBufferInfo.offset = 0;
+	instanceBufferInfo.range = sizeof(GPUInstance) * capacity;
+
+	VkDescriptorBufferInfo indirectBufferInfo;
+	indirectBufferInfo.buffer = frame.indirectBuffer._buffer;
+	indirectBufferInfo.offset = 0;
+	indirectBufferInfo.range = sizeof(VkDrawIndirectCommand) * capacity;
+
+	std::array<VkDescriptorBufferInfo, SHADOW_MAP_CASCADE_COUNT> indirectShadowBufferInfos;
+	for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
+		indirectShadowBufferInfos[j].buffer = frame.indirectShadowBuffers[j]._buffer;
+		indirectShadowBufferInfos[j].offset = 0;
+		indirectShadowBufferInfos[j].range = sizeof(VkDrawIndirectCommand) * capacity;
+	}
+
+	std::vector<VkWriteDescriptorSet> writes;
+	writes.push_back(vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.objectDescriptor, &objectBufferInfo, 0));
+
+	writes.push_back(vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.cullDescriptor, &objectBufferInfo, 0));
+	writes.push_back(vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.cullDescriptor, &instanceBufferInfo, 1));
+	writes.push_back(vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.cullDescriptor, &indirectBufferInfo, 2));
+
+	for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
+		writes.push_back(vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.cullCascadeDescriptors[j], &objectBufferInfo, 0));
+		writes.push_back(vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.cullCascadeDescriptors[j], &instanceBufferInfo, 1));
+		writes.push_back(vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.cullCascadeDescriptors[j], &indirectShadowBufferInfos[j], 2));
+	}
+
+	vkUpdateDescriptorSets(_device, writes.size(), writes.data(), 0, nullptr);
+}
+
+void VulkanEngine::upload_draw_templates()
+{
+	const size_t bufferSize = sizeof(VkDrawIndirectCommand) * std::max<size_t>(_renderables.size(), 1);
+
+	AllocatedBuffer stagingBuffer = create_buffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+
+	BufferSpan<VkDrawIndirectCommand> templates = stagingBuffer.span<VkDrawIndirectCommand>();
+	_threadpool.parallelFor(_renderables.size(), vks::cacheLineGranule<VkDrawIndirectCommand>(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			templates[i].vertexCount = _renderables[i].mesh->vertexCount;
+			templates[i].instanceCount = 1;
+			templates[i].firstVertex = 0;
+			templates[i].firstInstance = i;
+		}
+		});
+
+	// callers rebuild the templates only while the GPU is idle
+	if (_drawTemplateBuffer._buffer != VK_NULL_HANDLE) {
+		vmaDestroyBuffer(_allocator, _drawTemplateBuffer._buffer, _drawTemplateBuffer._allocation);
+	}
+	else {
+		_mainDeletionQueue.push_function([=]() {
+			vmaDestroyBuffer(_allocator, _drawTemplateBuffer._buffer, _drawTemplateBuffer._allocation);
+			});
+	}
+
+	_drawTemplateBuffer = create_buffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY, true);
+
+	immediate_submit([&](VkCommandBuffer cmd) {
+		VkBufferCopy copy;
+		copy.dstOffset = 0;
+		copy.srcOffset = 0;
+		copy.size = bufferSize;
+		vkCmdCopyBuffer(cmd, stagingBuffer._buffer, _drawTemplateBuffer._buffer, 1, &copy);
+		});
+
+	vmaDestroyBuffer(_allocator, stagingBuffer._buffer, stagingBuffer._allocation);
+
+	VkDescriptorBufferInfo templateBufferInfo;
+	templateBufferInfo.buffer = _drawTemplateBuffer._buffer;
+	templateBufferInfo.offset = 0;
+	templateBufferInfo.range = bufferSize;
+
+	std::vector<VkWriteDescriptorSet> writes;
+	for (FrameData& frame : _frames) {
+		writes.push_back(vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.cullDescriptor, &templateBufferInfo, 3));
+		for (uint32_t j = 0; j < SHADOW_MAP_CASCADE_COUNT; j++) {
+			writes.push_back(vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frame.cullCascadeDescriptors[j], &templateBufferInfo, 3));
+		}
+	}
+
+	vkUpdateDescriptorSets(_device, writes.size(), writes.data(), 0, nullptr);
+}
+
+void VulkanEngine::set_object_transform(uint32_t index, const glm::mat4& transform)
+{
+	RenderObject& object = _renderables[index];
+	object.transformMatrix = transform;
+
+	if (object.dirtyFrames == 0) {
+		_dirtyObjects.push_back(index);
+	}
+	object.dirtyFrames = _frames.size();
+}
+
+void VulkanEngine::mark_scene_params_dirty()
+{
+	_sceneParamsDirtyFrames = _frames.size();
+}
+
+void VulkanEngine::upload_object_data(FrameData& frame)
+{
+	BufferSpan<GPUObjectData> objectSSBO = frame.objectBuffer.span<GPUObjectData>();
+
+	// new or regrown buffers get everything once, after that only changed objects are written.
+	// the indirect commands are produced on the GPU from _drawTemplateBuffer
+	if (frame.renderablesVersion != _renderablesVersion) {
+		BufferSpan<GPUInstance> instanceSSBO = frame.instanceBuffer.span<GPUInstance>();
+
+		_threadpool.parallelFor(_renderables.size(), vks::cacheLineGranule<GPUObjectData, GPUInstance>(), [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+			{
+				RenderObject& object = _renderables[i];
+				objectSSBO[i].modelMatrix = object.transformMatrix;
+				objectSSBO[i].sphereBound = object.mesh->sphereBound;
+				objectSSBO[i].materialID = object.material->materialID;
+
+				instanceSSBO[i].objectID = i;
+			}
+			});
+
+		frame.renderablesVersion = _renderablesVersion;
+	}
+
+	for (size_t i = 0; i < _dirtyObjects.size();) {
+		RenderObject& object = _renderables[_dirtyObjects[i]];
+		objectSSBO[_dirtyObjects[i]].modelMatrix = object.transformMatrix;
+
+		if (--object.dirtyFrames == 0) {
+			_dirtyObjects[i] = _dirtyObjects.back();
+			_dirtyObjects.pop_back();
+		}
+		else {
+			i++;
+		}
+	}
+}
+
+void VulkanEngine::key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    VulkanEngine* myEngine = static_cast<VulkanEngine*>(glfwGetWindowUserPointer(window));
+    glm::vec3 dir = myEngine->_camera._foc - myEngine->_camera._camPos;
+    dir[1] = 0.0f;
+    glm::vec3 forward = glm::normalize(dir) * 0.25f;
+    glm::vec3 right = glm::cross(glm::normalize(dir), glm::vec3{0.0f, 1.0f, 0.0f}) * 0.25f;
+    if (action == GLFW_REPEAT || action == GLFW_PRESS) {
+        switch (key)
+        {
+        case GLFW_KEY_A:
+		
+			myEngine->_camera._camPos -= right;
+			myEngine->_camera._foc -= right;
+			myEngine->_camera._oriFoc -= right;
+            break;
+        case GLFW_KEY_D:
+            
+			myEngine->_camera._camPos += right;
+			myEngine->_camera._foc += right;
+			myEngine->_camera._oriFoc += right;
+            break;
+        case GLFW_KEY_W:
+            
+			myEngine->_camera._camPos += forward;
+			myEngine->_camera._foc += forward;
+			myEngine->_camera._oriFoc += forward;
+            break;
+        case GLFW_KEY_S:
+            
+			myEngine->_camera._camPos -= forward;
+			myEngine->_camera._foc -= forward;
+			myEngine->_camera._oriFoc -= forward;
+            break;
+        default:
+            break;
+        };
+    }
+}
+
+void VulkanEngine::mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
+{
+    VulkanEngine* myEngine = static_cast<VulkanEngine*>(glfwGetWindowUserPointer(window));
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
+    {
+        double xpos, ypos;
+        glfwGetCursorPos(window, &xpos, &ypos);
+        myEngine->_camera._posPress = glm::vec2(xpos, ypos);
+    }
+    else if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE)
+    {
+        myEngine->_camera._horAngle = myEngine->_camera._horAngle + myEngine->_camera._horAngleOffset;
+        myEngine->_camera._verAngle = myEngine->_camera._verAngle + myEngine->_camera._verAngleOffset;
+        myEngine->_camera._horAngleOffset = 0.0f;
+        myEngine->_camera._verAngleOffset = 0.0f;
+    }
+}
+
+void VulkanEngine::cursor_position_callback(GLFWwindow* window, double xpos, double ypos)
+{
+    VulkanEngine* myEngine = static_cast<VulkanEngine*>(glfwGetWindowUserPointer(window));
+    int state = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT);
+    if (state == GLFW_PRESS) {
+
+        myEngine->_camera._horAngleOffset = (myEngine->_camera._posPress.x - xpos) * 90.0f / (float)myEngine->_windowExtent.width;
+        myEngine->_camera._verAngleOffset = (myEngine->_camera._posPress.y - ypos) * 90.0f / (float)myEngine->_windowExtent.height;
+
+
+        if (myEngine->_camera._verAngle + myEngine->_camera._verAngleOffset > 30.0f) {
+            myEngine->_camera._verAngleOffset = 30.0f - myEngine->_camera._verAngle;
+        }
+        else if (myEngine->_camera._verAngle + myEngine->_camera._verAngleOffset < -30.0f) {
+            myEngine->_camera._verAngleOffset = -30.0f - myEngine->_camera._verAngle;
+        }
+
+        glm::vec3 trans = -myEngine->_camera._camPos;
+        glm::mat4 horizatal_rotate = glm::rotate(glm::mat4(1.0f), glm::radians(myEngine->_camera._horAngle + myEngine->_camera._horAngleOffset), glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 vertical_rotate = glm::rotate(glm::mat4(1.0f), glm::radians(myEngine->_camera._verAngle + myEngine->_camera._verAngleOffset), glm::vec3(1.0f, 0.0f, 0.0f));
+        glm::vec4 focal = (glm::translate(glm::mat4(1.0), -trans) * horizatal_rotate * vertical_rotate * glm::translate(glm::mat4(1.0), trans) * glm::vec4(myEngine->_camera._oriFoc, 1.0f));
+        focal /= focal.w;
+        myEngine->_camera._foc = glm::vec3(focal.x, focal.y, focal.z);
+    }
+
+}
+
+void VulkanEngine::cursor_enter_callback(GLFWwindow* window, int entered)
+{
+    VulkanEngine* myEngine = static_cast<VulkanEngine*>(glfwGetWindowUserPointer(window));
+    if (!entered) {
+		int horAngleInt = static_cast<int>(myEngine->_camera._horAngle + myEngine->_camera._horAngleOffset);
+        myEngine->_camera._horAngle = (myEngine->_camera._horAngle + myEngine->_camera._horAngleOffset) - horAngleInt/360 * 360.0f;
+        myEngine->_camera._verAngle = myEngine->_camera._verAngle + myEngine->_camera._verAngleOffset;
+        myEngine->_camera._horAngleOffset = 0.0f;
+        myEngine->_camera._verAngleOffset = 0.0f;
+    }
+
+}
+
+void VulkanEngine::framebufferResizeCallback(GLFWwindow* window, int width, int height) {
+    auto myEngine = reinterpret_cast<VulkanEngine*>(glfwGetWindowUserPointer(window));
+    myEngine->framebufferResized = true;
 }
\ No newline at end of file
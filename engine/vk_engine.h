@@ -1,418 +1,691 @@
-#pragma once
-#include "vk_descriptors.h"
-#include "vk_types.h"
-#include "threadpool.hpp"
-#include <vector>
-#include <deque>
-#include <functional>
-#include "Mesh.h"
-#include <unordered_map>
-#include <string>
-
-
-constexpr unsigned int FRAME_OVERLAP = 2;
-constexpr unsigned int SHADOW_MAP_CASCADE_COUNT = 3;
-
-class PipelineBuilder {
-public:
-
-	std::vector<VkPipelineShaderStageCreateInfo> _shaderStages;
-	VkPipelineVertexInputStateCreateInfo _vertexInputInfo;
-	VkPipelineInputAssemblyStateCreateInfo _inputAssembly;
-	VkViewport _viewport;
-	VkRect2D _scissor;
-	VkPipelineRasterizationStateCreateInfo _rasterizer;
-	std::vector<VkPipelineColorBlendAttachmentState> _colorBlendAttachment;
-	VkPipelineMultisampleStateCreateInfo _multisampling;
-	VkPipelineLayout _pipelineLayout;
-	VkPipelineDepthStencilStateCreateInfo _depthStencil;
-	VkPipeline build_pipeline(VkDevice device, VkRenderPass pass, int size);
-	VkPipeline build_pipeline(VkDevice device, VkRenderPass pass);
-};
-
-class ComputePipelineBuilder {
-public:
-
-	VkPipelineShaderStageCreateInfo  _shaderStage;
-	VkPipelineLayout _pipelineLayout;
-	VkPipeline build_pipeline(VkDevice device);
-};
-
-
-struct Cascade {
-	VkFramebuffer frameBuffer;
-	VkDescriptorSet descriptorSet;
-	VkImageView view;
-	
-	float radius;
-	float splitDepth;
-	glm::mat4 viewProjMatrix;
-
-	void destroy(VkDevice device) {
-		vkDestroyImageView(device, view, nullptr);
-		vkDestroyFramebuffer(device, frameBuffer, nullptr);
-	}
-};
-
-struct DeletionQueue
-{
-	std::deque<std::function<void()>> deletors;
-
-	void push_function(std::function<void()>&& function) {
-		deletors.push_back(function);
-	}
-
-	void flush() {
-		
-		for (auto it = deletors.rbegin(); it != deletors.rend(); it++) {
-			(*it)(); 
-		}
-
-		deletors.clear();
-	}
-};
-
-struct Material {
-	VkDescriptorSet textureSet{ VK_NULL_HANDLE };
-	VkPipeline pipeline;
-	VkPipelineLayout pipelineLayout;
-};
-
-struct IndirectBatch {
-	Mesh* mesh;
-	Material* material;
-	uint32_t first;
-	uint32_t count;
-};
-
-struct Texture {
-	AllocatedImage image;
-	VkImageView imageView;
-};
-
-struct RenderObject {
-	Mesh* mesh;
-
-	Material* material;
-
-	glm::mat4 transformMatrix;
-
-};
-
-struct RenderObjects {
-	std::vector<RenderObject*> RenderObjects;
-
-};
-
-
-struct FrameData {
-	VkSemaphore _presentSemaphore, _renderSemaphore;
-	VkFence _renderFence;
-
-	DeletionQueue _frameDeletionQueue;
-
-	VkCommandPool _cullCommandPool;
-	VkCommandBuffer _cullCommandBuffer;
-
-	VkCommandPool _cullShadowCommandPool;
-	VkCommandBuffer _cullShadowCommandBuffer;
-
-	VkCommandPool _commandPool;
-	VkCommandBuffer _mainCommandBuffer;
-
-	VkCommandPool _shadowCommandPool;
-	VkCommandBuffer _shadowCommandBuffer;
-
-	VkCommandPool _gBufferCommandPool;
-	VkCommandBuffer _gBufferCommandBuffer;
-
-	AllocatedBuffer cameraBuffer;
-	VkDescriptorSet globalDescriptor;
-
-	AllocatedBuffer objectBuffer;
-	VkDescriptorSet objectDescriptor;
-
-	AllocatedBuffer lightBuffer;
-	VkDescriptorSet lightDescriptor;
-
-	AllocatedBuffer skyboxBuffer;
-	VkDescriptorSet skyboxDescriptor;
-
-	std::array<Cascade, SHADOW_MAP_CASCADE_COUNT> cascades;
-	std::array<AllocatedBuffer, SHADOW_MAP_CASCADE_COUNT> cascadesBuffers;
-
-	AllocatedBuffer cascadesSetBuffer;
-	VkDescriptorSet cascadesSetDescriptor;
-
-	AllocatedBuffer instanceBuffer;
-	VkDescriptorSet cullDescriptor;
-	std::array<VkDescriptorSet, SHADOW_MAP_CASCADE_COUNT> cullCascadeDescriptors;
-
-	AllocatedBuffer indirectBuffer;
-	std::array<AllocatedBuffer, SHADOW_MAP_CASCADE_COUNT> indirectShadowBuffers;
-	VkDescriptorSet _csmSet;
-};
-
-struct Camera {
-	glm::vec3 _camPos = { 0.0f, 2.0f, 30.0f };
-	glm::vec3 _oriFoc = { 0.0f, 2.0f, 0.0f };
-	glm::vec3 _foc = { 0.0f, 2.0f, 0.0f };
-	glm::vec2 _posPress;
-	float _verAngle = 0.0f;
-	float _horAngle = 0.0f;
-	float _verAngleOffset = 0.0f;
-	float _horAngleOffset = 0.0f;
-	glm::mat4 viewproj;
-	float zNear;
-	float zFar;
-};
-
-struct CascadesSet {
-	alignas(4) glm::mat4 cascadeSplits;
-	alignas(16) glm::mat4 cascadeViewProjMat[SHADOW_MAP_CASCADE_COUNT];
-	alignas(16) glm::mat4 cascadeSizes;
-};
-
-struct UploadContext {
-	VkFence _uploadFence;
-	VkCommandPool _commandPool;
-	VkCommandBuffer _commandBuffer;
-};
-struct GPUCameraData {
-	alignas(16) glm::vec3 pos;
-	alignas(16) glm::mat4 viewproj;
-	alignas(16) glm::mat4 view;
-};
-
-
-struct GPUSceneData {
-	alignas(16) glm::vec3 lightColor;
-	alignas(16) glm::vec3 lightDir;
-	alignas(4) float zNear;
-	alignas(4) float zFar;
-};
-
-struct GPUObjectData {
-	alignas(16) glm::mat4 modelMatrix;
-	alignas(16) glm::vec4 sphereBound;
-};
-
-struct GPUInstance {
-	alignas(4) uint32_t objectID;
-};
-
-struct CullConstants {
-	alignas(16) glm::mat4 view;
-	alignas(16) glm::vec4 frustum;
-	alignas(4) float distance;
-	alignas(4) float znear;
-	alignas(4) float zfar;
-	alignas(4) uint32_t count;
-};
-
-class VulkanEngine {
-public:
-
-	bool _isInitialized{ false };
-	int _frameNumber{ 0 };
-	int _selectedShader{ 0 };
-
-	VkExtent2D _windowExtent{ 1700, 900 };
-	VkExtent2D _shadowExtent{ 2048, 2048 };
-	VkExtent2D _gBufferExtent{ 512, 512};
-
-	GLFWwindow* _window{ nullptr };
-
-	glm::vec3 _lightPos = { -120.0f,140.0f,80.0f };
-	glm::vec3 _lightFoc = { 0.0f, 0.0f, 0.0f };
-	Camera _camera;
-
-	VkSampleCountFlagBits _msaaSamples = VK_SAMPLE_COUNT_8_BIT;
-
-	vks::ThreadPool _threadpool;
-
-	VkInstance _instance;
-	VkDebugUtilsMessengerEXT _debug_messenger;
-	VkPhysicalDevice _chosenGPU;
-	VkDevice _device;
-
-	VkPhysicalDeviceProperties _gpuProperties;
-
-	FrameData _frames[FRAME_OVERLAP];
-
-	VkQueue _graphicsQueue;
-	uint32_t _graphicsQueueFamily;
-
-	VkRenderPass _renderPass;
-	VkRenderPass _gBufferPass;
-	VkRenderPass _shadowPass;
-	VkRenderPass _depthPass;
-	VkDescriptorSet _shadowMap;
-	
-	VkDescriptorSet _gBuffer;
-
-
-	VkSurfaceKHR _surface;
-	VkSwapchainKHR _swapchain;
-	VkFormat _swachainImageFormat;
-
-	std::vector<VkFramebuffer> _framebuffers;
-	std::vector<VkImage> _swapchainImages;
-	std::vector<VkImageView> _swapchainImageViews;
-
-	VkFormat _shadowMapFormat;
-	VkFramebuffer _shadowFramebuffer;
-	VkSampler _shadowSampler;
-	AllocatedImage _shadowColorImage;
-	VkImageView _shadowColorImageView;
-	AllocatedImage _shadowDepthImage;
-	VkImageView _shadowDepthImageView;
-	AllocatedImage _depth;
-	VkImageView _depthView;
-
-	VkPipelineLayout _trianglePipelineLayout;
-
-	VkPipeline _trianglePipeline;
-	VkPipeline _redTrianglePipeline;
-
-	DeletionQueue _mainDeletionQueue;
-
-	VkPipeline _meshPipeline;
-	Mesh _triangleMesh;
-	Mesh _monkeyMesh;
-
-	VkPipelineLayout _meshPipelineLayout;
-
-	VmaAllocator _allocator;
-
-	VkImageView _colorImageView;
-	AllocatedImage _colorImage;
-
-	VkImageView _depthImageView;
-	AllocatedImage _depthImage;
-
-	VkFormat _depthFormat;
-
-	vkutil::DescriptorLayoutCache* _descriptorLayoutCache;
-	vkutil::DescriptorAllocator* _descriptorAllocator;
-
-
-	VkDescriptorSetLayout _globalSetLayout;
-	VkDescriptorSetLayout _objectSetLayout;
-	VkDescriptorSetLayout _singleTextureSetLayout;
-	VkDescriptorSetLayout _csmSetLayout;
-	VkDescriptorSetLayout _lightSetLayout;
-	VkDescriptorSetLayout _cascadesSetLayout;
-	VkDescriptorSetLayout _gBufferSetLayout;
-	GPUSceneData _sceneParameters;
-	AllocatedBuffer _sceneParameterBuffer;
-
-	VkDescriptorSetLayout _cullSetLayout;
-
-	UploadContext _uploadContext;
-
-	bool framebufferResized = false;
-
-	void init();
-
-	void cleanup();
-
-	void draw();
-
-	void multithreading_draw();
-
-	void run();
-
-	FrameData& get_current_frame();
-	FrameData& get_last_frame();
-	FrameData& get_next_frame();
-
-	std::vector<RenderObject> _renderables;
-
-	std::unordered_map<std::string, Material> _materials;
-	std::unordered_map<std::string, Mesh> _meshes;
-	std::unordered_map<std::string, Texture> _loadedTextures;
-
-	Material* create_material(VkPipeline pipeline, VkPipelineLayout layout, const std::string& name);
-
-	Material* get_material(const std::string& name);
-
-	Mesh* get_mesh(const std::string& name);
-
-	std::vector<IndirectBatch> compact_draws(RenderObject* objects, int count);
-
-	void execute_shadow_culling(VkCommandBuffer cmd, RenderObject* first, int count, int cascadesIndex);
-
-	void execute_culling(VkCommandBuffer cmd, RenderObject* first, int count);
-
-	void draw_objects(VkCommandBuffer cmd, RenderObject* first, int count);
-
-	void draw_gbuffer(VkCommandBuffer cmd, RenderObject* first, int count);
-
-	void prepare_depthpass();
-
-	void wait_for_drawing();
-
-	void prepare_culling();
-
-	void prepare_light_culling();
-
-	void prepare_shadowmap();
-
-
-	void render_scene(uint32_t swapchainImageIndex);
-
-	void update_descriptors(RenderObject* first, int count);
-
-	void update_csm(VkCommandBuffer cmd, RenderObject* first, int count, int cascadesIndex);
-
-	AllocatedBuffer create_buffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage);
-
-	size_t pad_uniform_buffer_size(size_t originalSize);
-
-	void immediate_submit(std::function<void(VkCommandBuffer cmd)>&& function);
-
-private:
-
-	void init_vulkan();
-
-	void init_swapchain();
-
-
-	void init_gbuffer_renderpass();
-
-	void init_default_renderpass();
-
-	void init_framebuffers();
-
-	void init_commands();
-
-	void init_sync_structures();
-
-	void init_pipelines();
-
-	void init_scene();
-
-	void init_descriptors();
-
-	bool load_shader_module(const char* filePath, VkShaderModule* outShaderModule);
-
-	void load_meshes();
-
-	void load_images();
-
-	bool load_compute_shader(const char* shaderPath);
-
-	void upload_mesh(Mesh& mesh);
-
-	static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
-
-	static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
-
-	static void cursor_position_callback(GLFWwindow* window, double xpos, double ypos);
-
-	static void cursor_enter_callback(GLFWwindow* window, int entered);
-
-	static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
-}; 
-
+#pragma once
+#include "vk_descriptors.h"
+#include "vk_frame_arena.h"
+#include "vk_frame_ring.h"
+#include "vk_render_graph.h"
+#include "vk_triple_buffer.h"
+#include "vk_types.h"
+#include "threadpool.hpp"
+#include <vector>
+#include <deque>
+#include <functional>
+#include "Mesh.h"
+#include <unordered_map>
+#include <string>
+#include <chrono>
+#include <atomic>
+
+
+constexpr unsigned int DEFAULT_FRAME_OVERLAP = 2;
+constexpr unsigned int MAX_FRAME_OVERLAP = 4;
+constexpr unsigned int SHADOW_MAP_CASCADE_COUNT = 3;
+constexpr unsigned int MAX_TEXTURES = 1024;
+constexpr unsigned int MAX_TEXTURE_STREAMS = 4;
+constexpr unsigned int MAX_MAIN_PASS_SLICES = 16;
+constexpr float MIN_RENDER_SCALE = 0.5f;
+
+class PipelineBuilder {
+public:
+
+	std::vector<VkPipelineShaderStageCreateInfo> _shaderStages;
+	VkPipelineVertexInputStateCreateInfo _vertexInputInfo;
+	VkPipelineInputAssemblyStateCreateInfo _inputAssembly;
+	VkPipelineRasterizationStateCreateInfo _rasterizer;
+	std::vector<VkPipelineColorBlendAttachmentState> _colorBlendAttachment;
+	VkPipelineMultisampleStateCreateInfo _multisampling;
+	VkPipelineLayout _pipelineLayout;
+	VkPipelineDepthStencilStateCreateInfo _depthStencil;
+	VkPipeline build_pipeline(VkDevice device, VkRenderPass pass, int size);
+	VkPipeline build_pipeline(VkDevice device, VkRenderPass pass);
+};
+
+class ComputePipelineBuilder {
+public:
+
+	VkPipelineShaderStageCreateInfo  _shaderStage;
+	VkPipelineLayout _pipelineLayout;
+	VkPipeline build_pipeline(VkDevice device);
+};
+
+
+struct Cascade {
+	VkFramebuffer frameBuffer;
+	VkImageView view;
+	
+	float radius;
+	float splitDepth;
+	glm::mat4 viewProjMatrix;
+
+	void destroy(VkDevice device) {
+		vkDestroyImageView(device, view, nullptr);
+		vkDestroyFramebuffer(device, frameBuffer, nullptr);
+	}
+};
+
+struct DeletionQueue
+{
+	std::deque<std::function<void()>> deletors;
+
+	void push_function(std::function<void()>&& function) {
+		deletors.push_back(function);
+	}
+
+	void flush() {
+		
+		for (auto it = deletors.rbegin(); it != deletors.rend(); it++) {
+			(*it)(); 
+		}
+
+		deletors.clear();
+	}
+};
+
+struct Texture;
+
+struct Material {
+	Texture* texture{ nullptr };
+	uint32_t materialID{ 0 };
+	VkPipeline pipeline;
+	VkPipelineLayout pipelineLayout;
+};
+
+struct IndirectBatch {
+	Mesh* mesh;
+	Material* material;
+	uint32_t first;
+	uint32_t count;
+};
+
+struct Texture {
+	AllocatedImage image;
+	VkImageView imageView;
+
+	std::string path;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevels;
+
+	// mips are counted from the full resolution image, residentMip is the finest one in GPU memory
+	bool streamed{ false };
+	uint32_t index;
+	uint32_t residentMip{ 0 };
+	uint32_t lowestResidentMip{ 0 };
+	uint32_t requestedMip{ 0 };
+	uint32_t windowMip{ 0 };
+	uint32_t targetMip{ 0 };
+	// a TextureStream is loading a new chain for it
+	bool streaming{ false };
+};
+
+// a texture's new mip chain, decoded into the staging buffer by a pool worker. The first frame that finds
+// it done records the upload ahead of its passes and swaps the texture over
+struct TextureStream {
+	Texture* texture{ nullptr };
+	uint32_t targetMip{ 0 };
+	VkExtent2D extent{};
+	AllocatedBuffer stagingBuffer;
+	bool loaded{ false };
+	// set by the worker, loaded is only read once this is
+	std::atomic<bool> done{ false };
+};
+
+struct RenderObject {
+	Mesh* mesh;
+
+	Material* material;
+
+	glm::mat4 transformMatrix;
+
+	// frames in flight whose object buffer still holds an older transform
+	uint32_t dirtyFrames{ 0 };
+};
+
+struct RenderObjects {
+	std::vector<RenderObject*> RenderObjects;
+
+};
+
+
+// secondary command buffers recorded by one pool thread, the pool is reset as a whole once the frame is done
+struct WorkerCommands {
+	VkCommandPool pool;
+	std::vector<VkCommandBuffer> buffers;
+	uint32_t used{ 0 };
+};
+
+struct FrameData {
+	VkSemaphore _presentSemaphore, _renderSemaphore;
+	// value _cullTimeline and _frameTimeline reach once this frame's culling and rendering have finished
+	uint64_t timelineValue{ 0 };
+
+	// _renderablesVersion the object, instance and indirect buffers were last fully written for
+	uint64_t renderablesVersion{ 0 };
+
+	DeletionQueue _frameDeletionQueue;
+
+	// scratch memory for everything recorded into this frame, reset once its work has finished
+	vkutil::FrameArena arena;
+
+	VkCommandPool _cullCommandPool;
+	VkCommandBuffer _cullCommandBuffer;
+
+	VkCommandPool _cullShadowCommandPool;
+	VkCommandBuffer _cullShadowCommandBuffer;
+
+	VkCommandPool _commandPool;
+	VkCommandBuffer _mainCommandBuffer;
+	// streamed texture uploads, submitted ahead of the passes when uploadsRecorded is set
+	VkCommandBuffer _uploadCommandBuffer;
+	bool uploadsRecorded{ false };
+
+	VkCommandPool _shadowCommandPool;
+	VkCommandBuffer _shadowCommandBuffer;
+
+	VkCommandPool _gBufferCommandPool;
+	VkCommandBuffer _gBufferCommandBuffer;
+
+	// indexed by ThreadPool::workerIndex()
+	std::vector<WorkerCommands> _workerCommands;
+	std::array<VkCommandBuffer, SHADOW_MAP_CASCADE_COUNT> _cascadeCommandBuffers;
+	std::array<VkCommandBuffer, MAX_MAIN_PASS_SLICES> _mainPassSlices;
+
+	// record-once mode, stamped with the _sceneVersion they were recorded for
+	VkCommandBuffer _staticShadowCommandBuffer;
+	uint64_t _staticShadowVersion{ 0 };
+	std::vector<VkCommandBuffer> _staticMainCommandBuffers;
+	std::vector<uint64_t> _staticMainVersions;
+
+	// every uniform block of the frame, laid out as described by _uniformOffsets
+	AllocatedBuffer uniformBuffer;
+	// camera sized blocks, the dynamic offset picks the main camera or the skybox
+	VkDescriptorSet globalDescriptor;
+	// camera sized block plus the scene parameters, the dynamic offset picks the cascade
+	VkDescriptorSet lightDescriptor;
+	VkDescriptorSet cascadesSetDescriptor;
+
+	AllocatedBuffer objectBuffer;
+	VkDescriptorSet objectDescriptor;
+
+	std::array<Cascade, SHADOW_MAP_CASCADE_COUNT> cascades;
+
+	AllocatedBuffer instanceBuffer;
+	VkDescriptorSet cullDescriptor;
+	std::array<VkDescriptorSet, SHADOW_MAP_CASCADE_COUNT> cullCascadeDescriptors;
+
+	AllocatedBuffer indirectBuffer;
+	std::array<AllocatedBuffer, SHADOW_MAP_CASCADE_COUNT> indirectShadowBuffers;
+	uint32_t objectCapacity{ 0 };
+	VkDescriptorSet _csmSet;
+
+	AllocatedBuffer feedbackBuffer;
+	VkDescriptorSet feedbackDescriptor;
+
+	// this frame's copy of the material texture array and of the mips resident behind it. Streamed textures
+	// are swapped in once the frame's previous work has finished, frames still in flight keep the old image
+	VkDescriptorSet bindlessTextureSet;
+	AllocatedBuffer residencyBuffer;
+	// swapped by other frames since this one last ran
+	std::vector<Texture*> staleTextures;
+
+	// GPU time from the start of the shadow pass to the end of the upscale, read back once the frame is done
+	VkQueryPool timestampPool;
+	bool timestampsWritten{ false };
+	// scene resolution this frame was recorded with
+	VkExtent2D renderExtent{};
+};
+
+struct Camera {
+	glm::vec3 _camPos = { 0.0f, 2.0f, 30.0f };
+	glm::vec3 _oriFoc = { 0.0f, 2.0f, 0.0f };
+	glm::vec3 _foc = { 0.0f, 2.0f, 0.0f };
+	glm::vec2 _posPress;
+	float _verAngle = 0.0f;
+	float _horAngle = 0.0f;
+	float _verAngleOffset = 0.0f;
+	float _horAngleOffset = 0.0f;
+	glm::mat4 viewproj;
+	float zNear = 0.5f;
+	float zFar = 120.0f;
+};
+
+struct CascadesSet {
+	alignas(4) glm::mat4 cascadeSplits;
+	alignas(16) glm::mat4 cascadeViewProjMat[SHADOW_MAP_CASCADE_COUNT];
+	alignas(16) glm::mat4 cascadeSizes;
+};
+
+// where each block lives inside a frame's uniform buffer. Every frame uses the same layout, so command
+// buffers recorded once can keep the dynamic offsets they were recorded with
+struct FrameUniformOffsets {
+	uint32_t camera{ 0 };
+	uint32_t skybox{ 0 };
+	std::array<uint32_t, SHADOW_MAP_CASCADE_COUNT> cascades{};
+	uint32_t cascadesSet{ 0 };
+	uint32_t size{ 0 };
+};
+
+struct UploadContext {
+	VkFence _uploadFence;
+	VkCommandPool _commandPool;
+	VkCommandBuffer _commandBuffer;
+};
+struct GPUCameraData {
+	alignas(16) glm::vec3 pos;
+	alignas(16) glm::mat4 viewproj;
+	alignas(16) glm::mat4 view;
+};
+
+
+struct GPUSceneData {
+	alignas(16) glm::vec3 lightColor;
+	alignas(16) glm::vec3 lightDir;
+	alignas(4) float zNear;
+	alignas(4) float zFar;
+};
+
+struct ObjectTransform {
+	uint32_t index;
+	glm::mat4 transform;
+};
+
+// state the simulation thread hands to the renderer, never changed once published
+struct SceneSnapshot {
+	Camera camera;
+	GPUSceneData sceneParameters;
+	uint64_t sceneParametersVersion{ 0 };
+	// every transform change the renderer may not have seen yet, oldest first. Applying one twice is harmless
+	std::vector<ObjectTransform> transforms;
+	// when the events behind this snapshot were polled
+	std::chrono::steady_clock::time_point inputTime{};
+};
+
+// what the simulation thread works on between snapshots, nothing else touches it once run() started
+struct SimulationState {
+	GPUSceneData sceneParameters;
+	uint64_t sceneParametersVersion{ 0 };
+	std::vector<ObjectTransform> pendingTransforms;
+	// how many of pendingTransforms went out with the last snapshot
+	size_t sentTransforms{ 0 };
+};
+
+struct GPUObjectData {
+	alignas(16) glm::mat4 modelMatrix;
+	alignas(16) glm::vec4 sphereBound;
+	alignas(4) uint32_t materialID;
+};
+
+struct GPUInstance {
+	alignas(4) uint32_t objectID;
+};
+
+struct CullConstants {
+	alignas(16) glm::mat4 view;
+	alignas(16) glm::vec4 frustum;
+	alignas(4) float distance;
+	alignas(4) float znear;
+	alignas(4) float zfar;
+	alignas(4) uint32_t count;
+};
+
+struct UpscaleConstants {
+	alignas(8) glm::vec2 uvScale;
+	alignas(8) glm::vec2 uvMax;
+};
+
+class VulkanEngine {
+public:
+
+	bool _isInitialized{ false };
+	int _frameNumber{ 0 };
+	int _selectedShader{ 0 };
+
+	VkExtent2D _windowExtent{ 1700, 900 };
+	VkExtent2D _shadowExtent{ 2048, 2048 };
+	VkExtent2D _gBufferExtent{ 512, 512};
+
+	GLFWwindow* _window{ nullptr };
+
+	glm::vec3 _lightPos = { -120.0f,140.0f,80.0f };
+	glm::vec3 _lightFoc = { 0.0f, 0.0f, 0.0f };
+	// moved by the input callbacks on the simulation thread, frames read the camera of their snapshot
+	Camera _camera;
+
+	// steps per second of the simulation thread, each one polls the window and publishes a snapshot
+	uint32_t _simulationRate{ 120 };
+	SimulationState _simulation;
+	vkutil::TripleBuffer<SceneSnapshot> _snapshots;
+	// _sceneParameters came from the snapshot with this version
+	uint64_t _sceneParametersVersion{ 0 };
+	std::atomic<bool> _rendering{ false };
+
+	VkSampleCountFlagBits _msaaSamples = VK_SAMPLE_COUNT_8_BIT;
+
+	// the main pass renders into the top left _renderExtent of _windowExtent sized targets, the upscale
+	// pass stretches that onto the swapchain. The extent shrinks when the GPU time goes over the budget
+	VkExtent2D _renderExtent{ 1700, 900 };
+	float _renderScale{ 1.0f };
+	// milliseconds, 0 keeps the scene at full resolution
+	float _gpuFrameBudget{ 1000.0f / 60.0f };
+	float _gpuFrameTime{ 0.0f };
+
+	vks::ThreadPool _threadpool;
+	// workers started next to the render thread, which is queue 0 of the pool once render_loop runs
+	uint32_t _workerThreadCount{ 1 };
+	vks::TaskGraph _frameGraph;
+	uint32_t _swapchainImageIndex{ 0 };
+	// the main pass draw batches are split into this many secondary command buffers
+	uint32_t _mainPassSliceCount{ 1 };
+	// record the shadow and main passes once per frame slot and swapchain image, again only when _sceneVersion changes
+	bool _recordOnce{ false };
+
+	VkPresentModeKHR _presentMode{ VK_PRESENT_MODE_MAILBOX_KHR };
+	// one frame queued at a time, started by the limiter as late as still lets it be submitted on time
+	bool _lowLatency{ false };
+	// frames per second the low latency limiter paces to, 0 follows the monitor refresh rate
+	uint32_t _frameRateLimit{ 0 };
+	std::chrono::steady_clock::duration _frameInterval{};
+	std::chrono::steady_clock::time_point _nextSubmitTime{};
+	std::chrono::steady_clock::time_point _inputTime{};
+	// milliseconds from reading input to submitting the frame, last frame and smoothed
+	float _inputLatency{ 0.0f };
+	float _averageInputLatency{ 0.0f };
+
+	VkInstance _instance;
+	VkDebugUtilsMessengerEXT _debug_messenger;
+	VkPhysicalDevice _chosenGPU;
+	VkDevice _device;
+
+	VkPhysicalDeviceProperties _gpuProperties;
+
+	uint32_t _frameOverlap{ DEFAULT_FRAME_OVERLAP };
+	vkutil::FrameRing<FrameData> _frames;
+
+	VkQueue _graphicsQueue;
+
+	VkQueue _computeQueue;
+	uint32_t _computeQueueFamily;
+
+	VkSemaphore _frameTimeline;
+	VkSemaphore _cullTimeline;
+	uint64_t _frameTimelineValue{ 0 };
+	uint32_t _graphicsQueueFamily;
+
+	// attachments, layouts and dependencies of the render passes below come from the graph
+	vkutil::RenderGraph _renderGraph;
+	vkutil::RenderGraph::Pass _gBufferGraphPass;
+	vkutil::RenderGraph::Pass _shadowGraphPass;
+	vkutil::RenderGraph::Pass _mainGraphPass;
+	vkutil::RenderGraph::Pass _upscaleGraphPass;
+	vkutil::RenderGraph::Resource _shadowMapResource;
+
+	VkRenderPass _renderPass;
+	VkRenderPass _upscalePass;
+	VkRenderPass _gBufferPass;
+	VkRenderPass _shadowPass;
+	VkRenderPass _depthPass;
+	VkDescriptorSet _shadowMap;
+	
+	VkDescriptorSet _gBuffer;
+
+
+	VkSurfaceKHR _surface;
+	VkSwapchainKHR _swapchain;
+	VkFormat _swachainImageFormat;
+
+	// main pass targets, the same for every swapchain image
+	VkFramebuffer _sceneFramebuffer;
+	// upscale pass, one per swapchain image
+	std::vector<VkFramebuffer> _framebuffers;
+	std::vector<VkImage> _swapchainImages;
+	std::vector<VkImageView> _swapchainImageViews;
+
+	VkFormat _shadowMapFormat;
+	VkFramebuffer _shadowFramebuffer;
+	VkSampler _shadowSampler;
+	AllocatedImage _shadowColorImage;
+	VkImageView _shadowColorImageView;
+	AllocatedImage _shadowDepthImage;
+	VkImageView _shadowDepthImageView;
+	VkImageView _depthView;
+	AllocatedImage _skyboxImage;
+	// both stay null when the cubemap failed to load, the clear colour shows instead of the skybox
+	VkImageView _skyboxImageView{ VK_NULL_HANDLE };
+	VkDescriptorSet _skyboxSet{ VK_NULL_HANDLE };
+
+	VkPipelineLayout _trianglePipelineLayout;
+
+	VkPipeline _trianglePipeline;
+	VkPipeline _redTrianglePipeline;
+
+	DeletionQueue _mainDeletionQueue;
+
+	VkPipeline _meshPipeline;
+	Mesh _triangleMesh;
+	Mesh _monkeyMesh;
+
+	VkPipelineLayout _meshPipelineLayout;
+
+	VmaAllocator _allocator;
+
+	VkImageView _colorImageView;
+
+	VkImageView _depthImageView;
+
+	VkImageView _sceneColorView;
+	VkDescriptorSet _upscaleSet;
+
+	VkFormat _depthFormat;
+
+	vkutil::DescriptorLayoutCache* _descriptorLayoutCache;
+	vkutil::DescriptorAllocator* _descriptorAllocator;
+	vkutil::SamplerCache* _samplerCache;
+
+
+	VkDescriptorSetLayout _globalSetLayout;
+	VkDescriptorSetLayout _objectSetLayout;
+	VkDescriptorSetLayout _bindlessTextureSetLayout;
+	VkDescriptorSetLayout _skyboxSetLayout;
+	VkDescriptorSetLayout _upscaleSetLayout;
+	VkDescriptorSetLayout _csmSetLayout;
+	VkDescriptorSetLayout _lightSetLayout;
+	VkDescriptorSetLayout _cascadesSetLayout;
+	VkDescriptorSetLayout _gBufferSetLayout;
+	VkDescriptorSetLayout _feedbackSetLayout;
+
+	// one draw command per renderable, the culling shader copies it into the per-frame indirect buffers
+	AllocatedBuffer _drawTemplateBuffer{};
+	GPUSceneData _sceneParameters;
+	AllocatedBuffer _sceneParameterBuffer;
+	FrameUniformOffsets _uniformOffsets;
+
+	VkDescriptorSetLayout _cullSetLayout;
+
+	UploadContext _uploadContext;
+
+	bool framebufferResized = false;
+
+	std::string _scenePath{ "scenes/city_block.scene" };
+	uint32_t _stressGridSize{ 0 };
+	// with VKE_COUNT_FRAME_ALLOCATIONS, render this many frames past warm-up and close instead of aborting on the first that allocates
+	uint32_t _allocationTestFrames{ 0 };
+	// frames of the allocation test that allocated, main exits with an error when any did
+	uint32_t _allocatingFrames{ 0 };
+
+	MeshResidency _meshResidency{ MeshResidency::Release };
+
+	size_t _textureMemoryBudget{ 256ull * 1024 * 1024 };
+	// streams started and textures swapped to a newly loaded chain since startup
+	uint32_t _startedTextureStreams{ 0 };
+	uint32_t _streamedTextureCount{ 0 };
+	std::array<TextureStream, MAX_TEXTURE_STREAMS> _textureStreams;
+	uint32_t _textureResidentExtent{ 256 };
+
+	void init();
+
+	void cleanup();
+
+	void draw();
+
+	void multithreading_draw();
+
+	void init_frame_graph();
+
+	// the calling thread polls the window and simulates, frames are rendered on a thread of their own
+	void run();
+
+	void render_loop();
+
+	void simulate();
+
+	void publish_snapshot(std::chrono::steady_clock::time_point inputTime);
+
+	// simulation side, reaches the renderer with the next snapshot
+	void move_object(uint32_t index, const glm::mat4& transform);
+
+	void set_scene_parameters(const GPUSceneData& parameters);
+
+	FrameData& get_current_frame();
+	FrameData& get_last_frame();
+	FrameData& get_next_frame();
+
+	std::vector<RenderObject> _renderables;
+	// bumped whenever _renderables is rebuilt, forcing a full upload into every frame
+	uint64_t _renderablesVersion{ 0 };
+	// bumped by anything that invalidates recorded passes: the renderables, object buffer growth or bindless writes
+	uint64_t _sceneVersion{ 1 };
+	std::vector<uint32_t> _dirtyObjects;
+	// batches of the current frame in its arena, shared by the cascade and main pass recording
+	BufferSpan<IndirectBatch> _drawBatches;
+	uint32_t _sceneParamsDirtyFrames{ 0 };
+
+	std::unordered_map<std::string, Material> _materials;
+	std::unordered_map<std::string, Mesh> _meshes;
+	std::unordered_map<std::string, Texture> _loadedTextures;
+
+	Material* create_material(VkPipeline pipeline, VkPipelineLayout layout, const std::string& name);
+
+	Material* get_material(const std::string& name);
+
+	Mesh* get_mesh(const std::string& name);
+
+	BufferSpan<IndirectBatch> compact_draws(vkutil::FrameArena& arena, RenderObject* objects, int count);
+
+	void execute_shadow_culling(VkCommandBuffer cmd, RenderObject* first, int count, int cascadesIndex);
+
+	void execute_culling(VkCommandBuffer cmd, RenderObject* first, int count);
+
+	void draw_objects(VkCommandBuffer cmd, IndirectBatch* first, int count);
+
+	void draw_gbuffer(VkCommandBuffer cmd, RenderObject* first, int count);
+
+	void draw_skybox(VkCommandBuffer cmd);
+
+	void draw_upscale(VkCommandBuffer cmd, VkExtent2D renderExtent);
+
+	void set_viewport(VkCommandBuffer cmd, VkExtent2D extent);
+
+	void update_render_scale();
+
+	void prepare_depthpass();
+
+	void wait_for_drawing();
+
+	void pace_frame();
+
+	void sample_input();
+
+	void measure_input_latency();
+
+	void submit_culling();
+
+	void submit_frame(uint32_t swapchainImageIndex);
+
+	void wait_for_timeline(uint64_t value);
+
+	void prepare_culling();
+
+	void prepare_light_culling();
+
+	void prepare_shadowmap();
+
+	VkCommandBuffer begin_secondary_command_buffer(VkRenderPass renderPass, VkFramebuffer framebuffer);
+
+	void record_cascade(uint32_t cascadeIndex);
+
+	void record_main_pass_slice(uint32_t slice);
+
+	void update_texture_streaming();
+
+	// hands the decode of texture's chain from targetMip on to a pool worker, false when every stream is busy
+	bool start_texture_stream(Texture& texture, uint32_t targetMip);
+
+	void finish_texture_stream(FrameData& frame, TextureStream& stream);
+
+	void write_bindless_texture(FrameData& frame, const Texture& texture);
+
+	size_t texture_memory_size(const Texture& texture, uint32_t baseMip);
+
+	void render_scene(uint32_t swapchainImageIndex);
+
+	void update_descriptors(RenderObject* first, int count);
+
+	void reserve_object_buffers(FrameData& frame, uint32_t count);
+
+	void set_object_transform(uint32_t index, const glm::mat4& transform);
+
+	void mark_scene_params_dirty();
+
+	void upload_object_data(FrameData& frame);
+
+	void upload_draw_templates();
+
+	void update_csm(VkCommandBuffer cmd, IndirectBatch* first, int count, int cascadesIndex);
+
+	AllocatedBuffer create_buffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, bool sharedWithCompute = false);
+
+	size_t pad_uniform_buffer_size(size_t originalSize);
+
+	void immediate_submit(std::function<void(VkCommandBuffer cmd)>&& function);
+
+private:
+
+	void init_vulkan();
+
+	void init_swapchain();
+
+
+	void init_render_graph();
+
+	void init_framebuffers();
+
+	void init_commands();
+
+	void init_sync_structures();
+
+	void init_pipelines();
+
+	void init_scene();
+
+	void init_descriptors();
+
+	bool load_shader_module(const char* filePath, VkShaderModule* outShaderModule);
+
+	void load_meshes();
+
+	void load_images();
+
+	bool load_compute_shader(const char* shaderPath);
+
+	void upload_mesh(Mesh& mesh);
+
+	static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+
+	static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
+
+	static void cursor_position_callback(GLFWwindow* window, double xpos, double ypos);
+
+	static void cursor_enter_callback(GLFWwindow* window, int entered);
+
+	static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
+}; 
+
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "vk_types.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <type_traits>
+
+namespace vkutil {
+
+	// Linear allocator for data that only lives until its frame slot comes around again. Allocating is
+	// an atomic bump, so recording threads can share it, and reset() releases everything at once.
+	// What does not fit comes from the heap for that frame and the next reset() grows the arena to cover it
+	class FrameArena {
+	public:
+
+		FrameArena() = default;
+
+		// the frame ring moves its slots while it is set up, before anything was allocated
+		FrameArena(FrameArena&& other) noexcept
+			: _storage(std::move(other._storage)), _capacity(other._capacity), _offset(other._offset.load()), _overflow(std::move(other._overflow))
+		{
+		}
+
+		void init(size_t capacity)
+		{
+			_storage.reset(new unsigned char[capacity]);
+			_capacity = capacity;
+			_offset = 0;
+		}
+
+		// only while nothing allocated from the arena is in use
+		void reset()
+		{
+			size_t needed = _offset.load(std::memory_order_relaxed);
+			if (needed > _capacity) {
+				init(needed + needed / 2);
+			}
+
+			_overflow.clear();
+			_offset.store(0, std::memory_order_relaxed);
+		}
+
+		// nothing is constructed or destroyed, so only plain data can go in
+		template<typename T>
+		BufferSpan<T> allocate(size_t count)
+		{
+			static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value, "arena memory is never destroyed");
+
+			size_t size = (count * sizeof(T) + Alignment - 1) / Alignment * Alignment;
+			size_t begin = _offset.fetch_add(size, std::memory_order_relaxed);
+
+			if (begin + size <= _capacity) {
+				return { reinterpret_cast<T*>(_storage.get() + begin), count };
+			}
+
+			std::lock_guard<std::mutex> lock(_overflowMutex);
+			_overflow.emplace_back(new unsigned char[size]);
+			return { reinterpret_cast<T*>(_overflow.back().get()), count };
+		}
+
+		size_t capacity() const { return _capacity; }
+
+	private:
+		static constexpr size_t Alignment = alignof(std::max_align_t);
+
+		std::unique_ptr<unsigned char[]> _storage;
+		size_t _capacity{ 0 };
+		std::atomic<size_t> _offset{ 0 };
+
+		std::mutex _overflowMutex;
+		std::vector<std::unique_ptr<unsigned char[]>> _overflow;
+	};
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace vkutil {
+
+	// Holds one T per frame in flight. The slot count is chosen at runtime, so anything
+	// stored in T gets a copy per frame without having to be sized against a constant.
+	template<typename T>
+	class FrameRing {
+	public:
+
+		void init(uint32_t count)
+		{
+			_slots.clear();
+			_slots.resize(count);
+		}
+
+		uint32_t size() const { return static_cast<uint32_t>(_slots.size()); }
+
+		uint32_t index(uint64_t frameNumber) const { return static_cast<uint32_t>(frameNumber % _slots.size()); }
+
+		T& current(uint64_t frameNumber) { return _slots[index(frameNumber)]; }
+
+		T& previous(uint64_t frameNumber) { return _slots[index(frameNumber + _slots.size() - 1)]; }
+
+		T& next(uint64_t frameNumber) { return _slots[index(frameNumber + 1)]; }
+
+		T& operator[](uint32_t i) { return _slots[i]; }
+		const T& operator[](uint32_t i) const { return _slots[i]; }
+
+		typename std::vector<T>::iterator begin() { return _slots.begin(); }
+		typename std::vector<T>::iterator end() { return _slots.end(); }
+
+	private:
+		std::vector<T> _slots;
+	};
+
+}
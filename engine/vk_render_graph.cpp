@@ -0,0 +1,567 @@
+#include "vk_render_graph.h"
+#include "vk_initializers.h"
+#include <algorithm>
+
+namespace vkutil {
+
+	static bool is_depth_format(VkFormat format)
+	{
+		switch (format) {
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	void RenderGraph::init(VkDevice newDevice, VmaAllocator newAllocator)
+	{
+		device = newDevice;
+		allocator = newAllocator;
+	}
+
+	void RenderGraph::cleanup()
+	{
+		for (PassNode& pass : passes) {
+			if (pass.renderPass != VK_NULL_HANDLE) {
+				vkDestroyRenderPass(device, pass.renderPass, nullptr);
+			}
+		}
+
+		for (ResourceNode& resource : resources) {
+			if (resource.imported) {
+				continue;
+			}
+			if (resource.view != VK_NULL_HANDLE) {
+				vkDestroyImageView(device, resource.view, nullptr);
+			}
+			if (resource.image != VK_NULL_HANDLE) {
+				vkDestroyImage(device, resource.image, nullptr);
+			}
+		}
+
+		for (MemoryBlock& block : blocks) {
+			vmaFreeMemory(allocator, block.allocation);
+		}
+
+		passes.clear();
+		resources.clear();
+		blocks.clear();
+	}
+
+	RenderGraph::Resource RenderGraph::create_image(const std::string& name, const ImageDesc& desc)
+	{
+		ResourceNode resource;
+		resource.name = name;
+		resource.desc = desc;
+
+		resources.push_back(resource);
+		return static_cast<Resource>(resources.size() - 1);
+	}
+
+	RenderGraph::Resource RenderGraph::import_image(const std::string& name, VkFormat format, VkSampleCountFlagBits samples, VkImageLayout finalLayout)
+	{
+		ResourceNode resource;
+		resource.name = name;
+		resource.desc.format = format;
+		resource.desc.samples = samples;
+		resource.imported = true;
+		resource.finalLayout = finalLayout;
+
+		resources.push_back(resource);
+		return static_cast<Resource>(resources.size() - 1);
+	}
+
+	void RenderGraph::mark_output(Resource resource)
+	{
+		resources[resource].output = true;
+	}
+
+	RenderGraph::Pass RenderGraph::add_pass(const std::string& name)
+	{
+		PassNode pass;
+		pass.name = name;
+
+		passes.push_back(pass);
+		return static_cast<Pass>(passes.size() - 1);
+	}
+
+	void RenderGraph::write_color(Pass pass, Resource resource, bool clear)
+	{
+		passes[pass].accesses.push_back({ resource, AccessType::Color, clear, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT });
+	}
+
+	void RenderGraph::write_depth(Pass pass, Resource resource, bool clear)
+	{
+		passes[pass].accesses.push_back({ resource, AccessType::Depth, clear, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT });
+	}
+
+	void RenderGraph::write_resolve(Pass pass, Resource resource)
+	{
+		passes[pass].accesses.push_back({ resource, AccessType::Resolve, false, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT });
+	}
+
+	void RenderGraph::read_texture(Pass pass, Resource resource, VkPipelineStageFlags stages)
+	{
+		passes[pass].accesses.push_back({ resource, AccessType::Texture, false, stages });
+	}
+
+	bool RenderGraph::compile()
+	{
+		cull_passes();
+
+		if (!create_images()) {
+			return false;
+		}
+
+		for (uint32_t i = 0; i < passes.size(); i++) {
+			if (passes[i].active && !create_render_pass(i)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool RenderGraph::is_active(Pass pass) const
+	{
+		return passes[pass].active;
+	}
+
+	VkRenderPass RenderGraph::render_pass(Pass pass) const
+	{
+		return passes[pass].renderPass;
+	}
+
+	VkImage RenderGraph::image(Resource resource) const
+	{
+		return resources[resource].image;
+	}
+
+	VkImageView RenderGraph::image_view(Resource resource) const
+	{
+		return resources[resource].view;
+	}
+
+	void RenderGraph::cull_passes()
+	{
+		std::vector<bool> needed(resources.size(), false);
+		for (Resource r = 0; r < resources.size(); r++) {
+			needed[r] = resources[r].output;
+		}
+
+		// walking backwards, a pass is kept once a kept pass after it needs something it writes
+		for (uint32_t i = static_cast<uint32_t>(passes.size()); i-- > 0;) {
+			PassNode& pass = passes[i];
+
+			pass.active = false;
+			for (const Access& access : pass.accesses) {
+				if (access.type != AccessType::Texture && needed[access.resource]) {
+					pass.active = true;
+				}
+			}
+
+			if (!pass.active) {
+				continue;
+			}
+
+			// a cleared attachment does not need whatever was written before it,
+			// sampled images and attachments that keep their contents do
+			for (const Access& access : pass.accesses) {
+				if (access.clear || access.type == AccessType::Resolve) {
+					needed[access.resource] = false;
+				}
+			}
+			for (const Access& access : pass.accesses) {
+				if (!access.clear && access.type != AccessType::Resolve) {
+					needed[access.resource] = true;
+				}
+			}
+		}
+
+		for (uint32_t i = 0; i < passes.size(); i++) {
+			if (!passes[i].active) {
+				continue;
+			}
+
+			for (const Access& access : passes[i].accesses) {
+				ResourceNode& resource = resources[access.resource];
+				resource.firstPass = std::min(resource.firstPass, i);
+				resource.lastPass = std::max(resource.lastPass, i);
+
+				switch (access.type) {
+				case AccessType::Color:
+				case AccessType::Resolve:
+					resource.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+					break;
+				case AccessType::Depth:
+					resource.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+					break;
+				case AccessType::Texture:
+					resource.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+					break;
+				}
+			}
+		}
+
+		// attachments written and thrown away within one pass are never stored, so they need no backing memory
+		for (Resource r = 0; r < resources.size(); r++) {
+			ResourceNode& resource = resources[r];
+
+			if (resource.imported || resource.output || resource.firstPass == UINT32_MAX) {
+				continue;
+			}
+
+			if (resource.firstPass == resource.lastPass && (resource.usage & VK_IMAGE_USAGE_SAMPLED_BIT) == 0 && first_use_discards(r)) {
+				resource.lazy = true;
+				resource.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+			}
+		}
+	}
+
+	bool RenderGraph::create_images()
+	{
+		std::vector<Resource> owned;
+
+		for (Resource r = 0; r < resources.size(); r++) {
+			ResourceNode& resource = resources[r];
+
+			// imported images belong to someone else, unused ones are never created
+			if (resource.imported || resource.firstPass == UINT32_MAX) {
+				continue;
+			}
+
+			VkExtent3D extent = {
+				resource.desc.extent.width,
+				resource.desc.extent.height,
+				1
+			};
+
+			VkImageCreateInfo imageInfo = vkinit::image_create_info(resource.desc.format, resource.desc.layers, resource.usage | resource.desc.usage, extent, resource.desc.samples, 1);
+
+			if (vkCreateImage(device, &imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+				return false;
+			}
+
+			vkGetImageMemoryRequirements(device, resource.image, &resource.requirements);
+			owned.push_back(r);
+		}
+
+		alias_memory(owned);
+
+		for (MemoryBlock& block : blocks) {
+			VmaAllocationCreateInfo allocInfo = {};
+			allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+			allocInfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+			VkResult result = VK_ERROR_FEATURE_NOT_PRESENT;
+			if (block.lazy) {
+				VmaAllocationCreateInfo lazyInfo = {};
+				lazyInfo.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+				lazyInfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+
+				result = vmaAllocateMemory(allocator, &block.requirements, &lazyInfo, &block.allocation, nullptr);
+			}
+
+			// desktop GPUs have no lazily allocated memory type, the transient bit is only a hint there
+			if (result != VK_SUCCESS) {
+				result = vmaAllocateMemory(allocator, &block.requirements, &allocInfo, &block.allocation, nullptr);
+			}
+
+			if (result != VK_SUCCESS) {
+				return false;
+			}
+
+			for (Resource r : block.resources) {
+				if (vmaBindImageMemory(allocator, block.allocation, resources[r].image) != VK_SUCCESS) {
+					return false;
+				}
+			}
+		}
+
+		for (Resource r : owned) {
+			ResourceNode& resource = resources[r];
+
+			VkImageAspectFlags aspect = is_depth_format(resource.desc.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+
+			VkImageViewCreateInfo viewInfo = vkinit::imageview_create_info(resource.desc.format, resource.image, aspect, 1);
+			if (resource.desc.layers > 1) {
+				viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+				viewInfo.subresourceRange.layerCount = resource.desc.layers;
+			}
+
+			if (vkCreateImageView(device, &viewInfo, nullptr, &resource.view) != VK_SUCCESS) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool RenderGraph::first_use_discards(Resource resource) const
+	{
+		for (const Access& access : passes[resources[resource].firstPass].accesses) {
+			if (access.resource == resource) {
+				return access.clear || access.type == AccessType::Resolve;
+			}
+		}
+		return false;
+	}
+
+	void RenderGraph::alias_memory(const std::vector<Resource>& owned)
+	{
+		// only images whose first use throws the old contents away can take over memory from another one
+		auto discards = [this](Resource r) {
+			return first_use_discards(r);
+		};
+
+		// biggest first, smaller images then fill the blocks they leave
+		std::vector<Resource> order = owned;
+		std::sort(order.begin(), order.end(), [this](Resource a, Resource b) {
+			return resources[a].requirements.size > resources[b].requirements.size;
+			});
+
+		for (Resource r : order) {
+			ResourceNode& resource = resources[r];
+
+			// lazily allocated images keep their own allocation, there is nothing to share
+			uint32_t chosen = UINT32_MAX;
+			for (uint32_t b = 0; b < blocks.size() && chosen == UINT32_MAX && discards(r) && !resource.lazy; b++) {
+				MemoryBlock& block = blocks[b];
+
+				if (block.lazy || (block.requirements.memoryTypeBits & resource.requirements.memoryTypeBits) == 0) {
+					continue;
+				}
+
+				bool fits = true;
+				for (Resource other : block.resources) {
+					const ResourceNode& occupant = resources[other];
+					bool overlaps = resource.firstPass <= occupant.lastPass && occupant.firstPass <= resource.lastPass;
+					if (overlaps || !discards(other)) {
+						fits = false;
+					}
+				}
+
+				if (fits) {
+					chosen = b;
+				}
+			}
+
+			if (chosen == UINT32_MAX) {
+				blocks.emplace_back();
+				chosen = static_cast<uint32_t>(blocks.size() - 1);
+				blocks[chosen].requirements = resource.requirements;
+				blocks[chosen].lazy = resource.lazy;
+			}
+
+			MemoryBlock& block = blocks[chosen];
+			block.requirements.size = std::max(block.requirements.size, resource.requirements.size);
+			block.requirements.alignment = std::max(block.requirements.alignment, resource.requirements.alignment);
+			block.requirements.memoryTypeBits &= resource.requirements.memoryTypeBits;
+			block.resources.push_back(r);
+
+			resource.memoryBlock = chosen;
+		}
+	}
+
+	bool RenderGraph::previous_use(uint32_t passIndex, Resource resource, Use& outUse) const
+	{
+		const ResourceNode& node = resources[resource];
+
+		auto sharesMemory = [&](Resource other) {
+			return other == resource || (node.memoryBlock != UINT32_MAX && resources[other].memoryBlock == node.memoryBlock);
+		};
+
+		// the last step lands on the pass itself, which is its use in the previous frame
+		uint32_t count = static_cast<uint32_t>(passes.size());
+		for (uint32_t step = 1; step <= count; step++) {
+			uint32_t i = (passIndex + count - step) % count;
+			if (!passes[i].active) {
+				continue;
+			}
+
+			for (const Access& access : passes[i].accesses) {
+				if (sharesMemory(access.resource)) {
+					outUse = { i, &access };
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	bool RenderGraph::next_use(uint32_t passIndex, Resource resource, Use& outUse) const
+	{
+		for (uint32_t i = passIndex + 1; i < passes.size(); i++) {
+			if (!passes[i].active) {
+				continue;
+			}
+
+			for (const Access& access : passes[i].accesses) {
+				if (access.resource == resource) {
+					outUse = { i, &access };
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	VkImageLayout RenderGraph::access_layout(const Access& access) const
+	{
+		switch (access.type) {
+		case AccessType::Color:
+		case AccessType::Resolve:
+			return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		case AccessType::Depth:
+			return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		case AccessType::Texture:
+		default:
+			return is_depth_format(resources[access.resource].desc.format) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		}
+	}
+
+	VkAccessFlags RenderGraph::access_mask(const Access& access) const
+	{
+		switch (access.type) {
+		case AccessType::Color:
+		case AccessType::Resolve:
+			return VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		case AccessType::Depth:
+			return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		case AccessType::Texture:
+		default:
+			return VK_ACCESS_SHADER_READ_BIT;
+		}
+	}
+
+	bool RenderGraph::create_render_pass(uint32_t passIndex)
+	{
+		PassNode& pass = passes[passIndex];
+
+		std::vector<VkAttachmentDescription> attachments;
+		std::vector<VkAttachmentReference> colorRefs;
+		std::vector<VkAttachmentReference> resolveRefs;
+		VkAttachmentReference depthRef = {};
+		bool hasDepth = false;
+
+		// one dependency on whatever used the images before, one for whatever uses the attachments next
+		VkSubpassDependency incoming = {};
+		incoming.srcSubpass = VK_SUBPASS_EXTERNAL;
+		incoming.dstSubpass = 0;
+
+		VkSubpassDependency outgoing = {};
+		outgoing.srcSubpass = 0;
+		outgoing.dstSubpass = VK_SUBPASS_EXTERNAL;
+
+		for (const Access& access : pass.accesses) {
+			const ResourceNode& resource = resources[access.resource];
+
+			Use previous;
+			Use next;
+			bool hasPrevious = previous_use(passIndex, access.resource, previous);
+			bool hasNext = next_use(passIndex, access.resource, next);
+
+			if (hasPrevious) {
+				incoming.srcStageMask |= previous.access->stages;
+				incoming.srcAccessMask |= access_mask(*previous.access);
+				incoming.dstStageMask |= access.stages;
+				incoming.dstAccessMask |= access_mask(access);
+			}
+
+			// sampled images were moved to their layout by the pass that wrote them
+			if (access.type == AccessType::Texture) {
+				continue;
+			}
+
+			bool keepsContents = !access.clear && access.type != AccessType::Resolve && hasPrevious && previous.access->resource == access.resource;
+
+			VkAttachmentDescription attachment = {};
+			attachment.format = resource.desc.format;
+			attachment.samples = resource.desc.samples;
+			attachment.loadOp = access.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : (keepsContents ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+			// nothing reads transient attachments after the pass, so they never go back to memory
+			attachment.storeOp = (hasNext || resource.imported || resource.output) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			if (keepsContents) {
+				attachment.initialLayout = access_layout(*previous.access);
+				// coming from the previous frame, an imported image is in the layout its owner expects
+				if (previous.pass >= passIndex && resource.imported && resource.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED) {
+					attachment.initialLayout = resource.finalLayout;
+				}
+			}
+
+			if (hasNext) {
+				attachment.finalLayout = access_layout(*next.access);
+
+				outgoing.srcStageMask |= access.stages;
+				outgoing.srcAccessMask |= access_mask(access);
+				outgoing.dstStageMask |= next.access->stages;
+				outgoing.dstAccessMask |= access_mask(*next.access);
+			}
+			else if (resource.imported && resource.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED) {
+				attachment.finalLayout = resource.finalLayout;
+			}
+			else {
+				attachment.finalLayout = access_layout(access);
+			}
+
+			VkAttachmentReference ref = {};
+			ref.attachment = static_cast<uint32_t>(attachments.size());
+			ref.layout = access_layout(access);
+
+			attachments.push_back(attachment);
+
+			switch (access.type) {
+			case AccessType::Color:
+				colorRefs.push_back(ref);
+				break;
+			case AccessType::Resolve:
+				resolveRefs.push_back(ref);
+				break;
+			case AccessType::Depth:
+				depthRef = ref;
+				hasDepth = true;
+				break;
+			default:
+				break;
+			}
+		}
+
+		// color attachments without a resolve target are left alone
+		if (!resolveRefs.empty()) {
+			resolveRefs.resize(colorRefs.size(), { VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED });
+		}
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+		subpass.pColorAttachments = colorRefs.data();
+		subpass.pResolveAttachments = resolveRefs.empty() ? nullptr : resolveRefs.data();
+		subpass.pDepthStencilAttachment = hasDepth ? &depthRef : nullptr;
+
+		std::vector<VkSubpassDependency> dependencies;
+		if (incoming.srcStageMask != 0) {
+			dependencies.push_back(incoming);
+		}
+		if (outgoing.srcStageMask != 0) {
+			dependencies.push_back(outgoing);
+		}
+
+		VkRenderPassCreateInfo render_pass_info = {};
+		render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		render_pass_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+		render_pass_info.pAttachments = attachments.data();
+		render_pass_info.subpassCount = 1;
+		render_pass_info.pSubpasses = &subpass;
+		render_pass_info.dependencyCount = static_cast<uint32_t>(dependencies.size());
+		render_pass_info.pDependencies = dependencies.data();
+
+		return vkCreateRenderPass(device, &render_pass_info, nullptr, &pass.renderPass) == VK_SUCCESS;
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "vk_types.h"
+#include <vector>
+#include <string>
+
+namespace vkutil {
+
+	// Passes declare the images they render to and the images they sample, in the order they are submitted.
+	// compile() drops passes whose results nobody uses, derives load/store ops, layouts and the external
+	// dependencies of every render pass from the neighbouring uses of each image, and lets graph owned
+	// images whose lifetimes do not overlap share memory. Images that live and die inside one render pass
+	// are made transient attachments in lazily allocated memory where the device has it.
+	class RenderGraph {
+	public:
+		using Resource = uint32_t;
+		using Pass = uint32_t;
+
+		struct ImageDesc {
+			VkFormat format{ VK_FORMAT_UNDEFINED };
+			VkExtent2D extent{};
+			VkSampleCountFlagBits samples{ VK_SAMPLE_COUNT_1_BIT };
+			uint32_t layers{ 1 };
+			// added to the attachment and sampled bits derived from the passes
+			VkImageUsageFlags usage{ 0 };
+		};
+
+		void init(VkDevice newDevice, VmaAllocator newAllocator);
+
+		void cleanup();
+
+		// owned by the graph, only created if a pass that survives compile() uses it
+		Resource create_image(const std::string& name, const ImageDesc& desc);
+
+		// owned elsewhere, like the swapchain images. finalLayout is the layout the owner expects after the last pass
+		Resource import_image(const std::string& name, VkFormat format, VkSampleCountFlagBits samples, VkImageLayout finalLayout);
+
+		// passes writing an output, and the passes they depend on, are kept
+		void mark_output(Resource resource);
+
+		Pass add_pass(const std::string& name);
+
+		// framebuffer attachments follow the order of the write calls
+		void write_color(Pass pass, Resource resource, bool clear);
+
+		void write_depth(Pass pass, Resource resource, bool clear);
+
+		// resolves the multisampled color attachment with the same index
+		void write_resolve(Pass pass, Resource resource);
+
+		void read_texture(Pass pass, Resource resource, VkPipelineStageFlags stages);
+
+		bool compile();
+
+		bool is_active(Pass pass) const;
+
+		// VK_NULL_HANDLE for passes compile() dropped
+		VkRenderPass render_pass(Pass pass) const;
+
+		VkImage image(Resource resource) const;
+
+		VkImageView image_view(Resource resource) const;
+
+	private:
+
+		enum class AccessType { Color, Depth, Resolve, Texture };
+
+		struct Access {
+			Resource resource;
+			AccessType type;
+			bool clear;
+			VkPipelineStageFlags stages;
+		};
+
+		struct PassNode {
+			std::string name;
+			std::vector<Access> accesses;
+			bool active{ false };
+			VkRenderPass renderPass{ VK_NULL_HANDLE };
+		};
+
+		struct ResourceNode {
+			std::string name;
+			ImageDesc desc;
+			bool imported{ false };
+			bool output{ false };
+			VkImageLayout finalLayout{ VK_IMAGE_LAYOUT_UNDEFINED };
+
+			VkImageUsageFlags usage{ 0 };
+			uint32_t firstPass{ UINT32_MAX };
+			uint32_t lastPass{ 0 };
+
+			VkImage image{ VK_NULL_HANDLE };
+			VkImageView view{ VK_NULL_HANDLE };
+			VkMemoryRequirements requirements{};
+			uint32_t memoryBlock{ UINT32_MAX };
+			// never leaves its render pass, tile memory is enough on devices that can back it lazily
+			bool lazy{ false };
+		};
+
+		struct MemoryBlock {
+			VmaAllocation allocation{ VK_NULL_HANDLE };
+			VkMemoryRequirements requirements{};
+			std::vector<Resource> resources;
+			bool lazy{ false };
+		};
+
+		struct Use {
+			uint32_t pass;
+			const Access* access;
+		};
+
+		void cull_passes();
+
+		bool create_images();
+
+		void alias_memory(const std::vector<Resource>& owned);
+
+		// whether the first use of the image in a frame clears or overwrites it
+		bool first_use_discards(Resource resource) const;
+
+		bool create_render_pass(uint32_t passIndex);
+
+		// closest use of the same memory before the pass, wrapping around to the previous frame
+		bool previous_use(uint32_t passIndex, Resource resource, Use& outUse) const;
+
+		// next use of the same image later in the frame
+		bool next_use(uint32_t passIndex, Resource resource, Use& outUse) const;
+
+		VkImageLayout access_layout(const Access& access) const;
+
+		VkAccessFlags access_mask(const Access& access) const;
+
+		VkDevice device;
+		VmaAllocator allocator;
+
+		std::vector<PassNode> passes;
+		std::vector<ResourceNode> resources;
+		std::vector<MemoryBlock> blocks;
+	};
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace vkutil {
+
+	// Hands values from one writer thread to one reader thread without either waiting on the other.
+	// The writer fills back() and publishes it, the reader picks up the newest published value and
+	// keeps reading it from front() until it acquires again. Values published in between are skipped
+	template<typename T>
+	class TripleBuffer {
+	public:
+
+		T& back() { return _slots[_back]; }
+
+		// only the writer's own slot was changed since the last publish. Returns whether the reader
+		// had taken the value published before this one, values it never took were skipped
+		bool publish()
+		{
+			uint8_t previous = _ready.exchange(_back | Fresh, std::memory_order_acq_rel);
+			_back = previous & IndexMask;
+			return (previous & Fresh) == 0;
+		}
+
+		// whether there was a newer value than front()
+		bool acquire()
+		{
+			if ((_ready.load(std::memory_order_relaxed) & Fresh) == 0) {
+				return false;
+			}
+
+			_front = _ready.exchange(_front, std::memory_order_acq_rel) & IndexMask;
+			return true;
+		}
+
+		const T& front() const { return _slots[_front]; }
+
+	private:
+		static constexpr uint8_t IndexMask = 0x3;
+		static constexpr uint8_t Fresh = 0x4;
+
+		std::array<T, 3> _slots{};
+		uint8_t _back{ 0 };
+		uint8_t _front{ 1 };
+		std::atomic<uint8_t> _ready{ 2 };
+	};
+
+}
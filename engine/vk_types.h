@@ -1,18 +1,41 @@
-#pragma once
-
-#define GLFW_INCLUDE_VULKAN
-#include <GLFW/glfw3.h>
-
-#include <vma/vk_mem_alloc.h>
-
-struct AllocatedBuffer {
-	VkBuffer _buffer;
-	VmaAllocation _allocation;
-};
-
-struct AllocatedImage {
-	VkImage _image;
-	uint32_t _mipLevels = 1;
-	VkSampler _sampler;
-	VmaAllocation _allocation;
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vma/vk_mem_alloc.h>
+
+#include <cstddef>
+
+// typed view over the mapped memory of a buffer, or over frame arena memory
+template<typename T>
+struct BufferSpan {
+	T* data{ nullptr };
+	size_t count{ 0 };
+
+	T& operator[](size_t i) const { return data[i]; }
+	T* begin() const { return data; }
+	T* end() const { return data + count; }
+	size_t size() const { return count; }
+};
+
+struct AllocatedBuffer {
+	VkBuffer _buffer;
+	VmaAllocation _allocation;
+	// set for host visible buffers, which stay mapped until they are destroyed
+	void* _mapped{ nullptr };
+	size_t _size{ 0 };
+
+	template<typename T>
+	BufferSpan<T> span(size_t offset = 0) const
+	{
+		return { reinterpret_cast<T*>(static_cast<char*>(_mapped) + offset), (_size - offset) / sizeof(T) };
+	}
+};
+
+struct AllocatedImage {
+	VkImage _image;
+	uint32_t _mipLevels = 1;
+	VkSampler _sampler;
+	VmaAllocation _allocation;
 };
\ No newline at end of file
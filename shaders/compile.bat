@@ -1,11 +1,14 @@
-C:\VulkanSDK\1.3.250.0\Bin\glslc.exe depth_shader.vert -o depth_shader.vert.spv
-
-
-C:\VulkanSDK\1.3.250.0\Bin\glslc.exe shader.vert -o shader.vert.spv
-C:\VulkanSDK\1.3.250.0\Bin\glslc.exe scene_shader.frag -o scene_shader.frag.spv
-
-C:\VulkanSDK\1.3.250.0\Bin\glslc.exe skybox_shader.frag -o skybox_shader.frag.spv
-C:\VulkanSDK\1.3.250.0\Bin\glslc.exe skybox_shader.vert -o skybox_shader.vert.spv
-
-C:\VulkanSDK\1.3.250.0\Bin\glslc.exe compute_culling.comp -o compute_culling.comp.spv
+C:\VulkanSDK\1.3.250.0\Bin\glslc.exe depth_shader.vert -o depth_shader.vert.spv
+
+
+C:\VulkanSDK\1.3.250.0\Bin\glslc.exe shader.vert -o shader.vert.spv
+C:\VulkanSDK\1.3.250.0\Bin\glslc.exe scene_shader.frag -o scene_shader.frag.spv
+
+C:\VulkanSDK\1.3.250.0\Bin\glslc.exe skybox_shader.frag -o skybox_shader.frag.spv
+C:\VulkanSDK\1.3.250.0\Bin\glslc.exe skybox_shader.vert -o skybox_shader.vert.spv
+
+C:\VulkanSDK\1.3.250.0\Bin\glslc.exe upscale.frag -o upscale.frag.spv
+C:\VulkanSDK\1.3.250.0\Bin\glslc.exe upscale.vert -o upscale.vert.spv
+
+C:\VulkanSDK\1.3.250.0\Bin\glslc.exe compute_culling.comp -o compute_culling.comp.spv
 pause
\ No newline at end of file
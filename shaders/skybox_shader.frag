@@ -1,14 +1,13 @@
-#version 450
-
-layout(location = 0) in vec2 fragTexCoord;
-
-layout(location = 0) out vec4 outColor;
-
-layout(set = 4, binding = 0) uniform sampler2D tex1;
-
-void main() {
-    vec3 color = texture(tex1, fragTexCoord).xyz;
-
-    outColor = vec4(color, 1.0);
-    //outColor = vec4(1.0);
+#version 450
+
+layout(location = 0) in vec3 fragDirection;
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 1, binding = 0) uniform samplerCube skybox;
+
+void main() {
+    vec3 color = texture(skybox, fragDirection).xyz;
+
+    outColor = vec4(color, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,19 @@
+#version 450
+
+layout(location = 0) in vec2 inUV;
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D sceneColor;
+
+layout(push_constant) uniform constants {
+    // rendered part of the scene color in uv, and the last uv a bilinear tap may use
+    vec2 uvScale;
+    vec2 uvMax;
+} upscale;
+
+void main() {
+    vec2 uv = min(inUV * upscale.uvScale, upscale.uvMax);
+
+    outColor = vec4(texture(sceneColor, uv).rgb, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#version 450
+
+layout(location = 0) out vec2 outUV;
+
+void main() {
+    // one triangle covering the screen, uv runs 0..1 over the visible part
+    vec2 uv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+
+    outUV = uv;
+}
\ No newline at end of file